@@ -24,6 +24,7 @@ struct VideoConfig
 	uint32_t bitrate = 4000000;
 	uint32_t framerate = 25;
 	uint32_t gop = 25;
+	uint32_t vbv_buffer_size = 0; // bits, 0: one second of bitrate
 	AVPixelFormat format = AV_PIX_FMT_BGRA;
 };
 
@@ -37,23 +37,15 @@ bool H264Encoder::Init(AVConfig& video_config)
 	
 	codec_context_->width = av_config_.video.width;
 	codec_context_->height = av_config_.video.height;
-	codec_context_->time_base = { 1,  (int)av_config_.video.framerate };
+	// millisecond timestamps, the rate control follows the real frame durations when the framerate changes
+	codec_context_->time_base = { 1, 1000 };
 	codec_context_->framerate = { (int)av_config_.video.framerate, 1 };
 	codec_context_->gop_size = av_config_.video.gop;
 	codec_context_->max_b_frames = 0;
 	codec_context_->pix_fmt = AV_PIX_FMT_YUV420P;
 
-	// rc control mode: abr
-	codec_context_->bit_rate = av_config_.video.bitrate;
-	
-	// cbr mode config
-	codec_context_->rc_min_rate = av_config_.video.bitrate;
-	codec_context_->rc_max_rate = av_config_.video.bitrate;
-	codec_context_->rc_buffer_size = (int)av_config_.video.bitrate;
-	codec_context_->rc_initial_buffer_occupancy = codec_context_->rc_buffer_size * 0.9;
-
-	av_opt_set(codec_context_->priv_data, "vbv_maxrate", std::to_string(av_config_.video.bitrate).c_str(), 0);
-	av_opt_set(codec_context_->priv_data, "vbv_bufsize", std::to_string(av_config_.video.bitrate).c_str(), 0);
+	// rc control mode: abr, cbr mode config
+	SetRateControl(av_config_.video.bitrate, av_config_.video.vbv_buffer_size);
 
 	//av_opt_set(codec_context_->priv_data, "aq-mode", "0", 0);
 	//av_opt_set(codec_context_->priv_data, "scenechange", "0", 0);
@@ -77,6 +69,9 @@ bool H264Encoder::Init(AVConfig& video_config)
 
 	in_width_ = av_config_.video.width;
 	in_height_ = av_config_.video.height;
+	frame_duration_ = 1000 / (av_config_.video.framerate > 0 ? av_config_.video.framerate : 1);
+	frames_since_idr_ = 0;
+	has_pending_config_ = false;
 	is_initialized_ = true;
 	return true;
 }
@@ -106,7 +101,16 @@ AVPacketPtr H264Encoder::Encode(const uint8_t *image, uint32_t width, uint32_t h
 		return nullptr;
 	}
 
-	if (width != in_width_ || height != av_config_.video.height || !video_converter_) {
+	// the next frame starts a new gop anyway, reopen with the new resolution there
+	if (has_pending_config_ && (force_idr_ || frames_since_idr_ + 1 >= av_config_.video.gop)) {
+		AVConfig av_config = av_config_;
+		av_config.video = pending_config_;
+		if (!Init(av_config)) {
+			return nullptr;
+		}
+	}
+
+	if (width != in_width_ || height != in_height_ || !video_converter_) {
 		in_width_ = width;
 		in_height_ = height;
 
@@ -151,11 +155,12 @@ AVPacketPtr H264Encoder::Encode(const uint8_t *image, uint32_t width, uint32_t h
 	}
 //#endif
 
-	if (pts >= 0) {
+	if (pts > 0) {
 		yuv_frame->pts = pts;
 	}
 	else {
-		yuv_frame->pts = pts_++;
+		yuv_frame->pts = pts_;
+		pts_ += frame_duration_;
 	}
 
 	yuv_frame->pict_type = AV_PICTURE_TYPE_NONE;
@@ -183,6 +188,13 @@ AVPacketPtr H264Encoder::Encode(const uint8_t *image, uint32_t width, uint32_t h
 		return nullptr;
 	}
 
+	if (av_packet->flags & AV_PKT_FLAG_KEY) {
+		frames_since_idr_ = 0;
+	}
+	else {
+		frames_since_idr_++;
+	}
+
 	return av_packet;
 }
 
@@ -195,14 +207,48 @@ void H264Encoder::ForceIDR()
 
 void H264Encoder::SetBitrate(uint32_t bitrate_kbps)
 {
-	if (codec_context_) {
-		int64_t out_val = 0;
-		av_opt_get_int(codec_context_->priv_data, "avcintra-class", 0, &out_val);
-		if (out_val < 0) {
-			codec_context_->bit_rate = bitrate_kbps * 1000;
-			codec_context_->rc_min_rate = codec_context_->bit_rate;
-			codec_context_->rc_max_rate = codec_context_->bit_rate;
-			codec_context_->rc_buffer_size = (int)codec_context_->bit_rate;
-		}
+	VideoConfig video_config = av_config_.video;
+	video_config.bitrate = bitrate_kbps * 1000;
+	Reconfigure(video_config);
+}
+
+bool H264Encoder::Reconfigure(const VideoConfig& video_config)
+{
+	if (!codec_context_ || video_config.bitrate == 0 || video_config.framerate == 0) {
+		return false;
+	}
+
+	if (video_config.width != av_config_.video.width || video_config.height != av_config_.video.height ||
+		video_config.gop != av_config_.video.gop || video_config.format != av_config_.video.format) {
+		pending_config_ = video_config;
+		has_pending_config_ = true;
+	}
+
+	// libx264 compares these with its params before every frame
+	int64_t avcintra_class = 0;
+	av_opt_get_int(codec_context_->priv_data, "avcintra-class", 0, &avcintra_class);
+	if (avcintra_class < 0) {
+		SetRateControl(video_config.bitrate, video_config.vbv_buffer_size);
+		av_config_.video.bitrate = video_config.bitrate;
+		av_config_.video.vbv_buffer_size = video_config.vbv_buffer_size;
+	}
+
+	av_config_.video.framerate = video_config.framerate;
+	frame_duration_ = 1000 / video_config.framerate;
+	return true;
+}
+
+void H264Encoder::SetRateControl(uint32_t bitrate, uint32_t vbv_buffer_size)
+{
+	if (vbv_buffer_size == 0) {
+		vbv_buffer_size = bitrate;
 	}
-}
\ No newline at end of file
+
+	codec_context_->bit_rate = bitrate;
+	codec_context_->rc_min_rate = bitrate;
+	codec_context_->rc_max_rate = bitrate;
+	codec_context_->rc_buffer_size = (int)vbv_buffer_size;
+	// only read when the encoder is opened, x264_encoder_reconfig rescales the current fill to the new
+	// buffer size instead. kept in step for the reopen at the next gop boundary
+	codec_context_->rc_initial_buffer_occupancy = (int)(vbv_buffer_size * 0.9);
+}
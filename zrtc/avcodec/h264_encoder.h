@@ -18,8 +18,19 @@ public:
 	virtual void ForceIDR();
 	virtual void SetBitrate(uint32_t bitrate_kbps);
 
+	// Bitrate, vbv size and framerate apply to the next frame, libx264 passes
+	// them to x264_encoder_reconfig and the stream goes on without a new sps or idr.
+	// A new resolution or gop waits for the next gop boundary and reopens the encoder there.
+	virtual bool Reconfigure(const VideoConfig& video_config);
+
 private:
+	void SetRateControl(uint32_t bitrate, uint32_t vbv_buffer_size);
+
 	int64_t pts_ = 0;
+	int64_t frame_duration_ = 0;
+	uint32_t frames_since_idr_ = 0;
+	bool has_pending_config_ = false;
+	VideoConfig pending_config_;
 	std::unique_ptr<VideoConverter> video_converter_;
 	uint32_t in_width_  = 0;
 	uint32_t in_height_ = 0;
@@ -13,6 +13,7 @@ int main(int argc, char** argv)
 #endif
 	SignalingConfig signaling_config;
 	signaling_config.port = 19080;
+	signaling_config.rtc_port = 10000; // all rtc connections share this udp port
 	signaling_config.host = host;
 	//signaling_config.cert_path = "localhost.pem";
 	//signaling_config.key_path = "localhost-key.pem";
@@ -37,8 +38,21 @@ int main(int argc, char** argv)
 	}
 	RTC_LOG_INFO("start rtc live succeed.");
 
+	// closed loop: the encoder follows what the viewers can receive,
+	// keyframe requests are checked more often than the bitrate
+	uint32_t loop_count = 0;
 	while (1) {
-		xop::Timer::Sleep(10);
+		xop::Timer::Sleep(20);
+		if (signaling_handler->UpdateKeyFrameRequest()) {
+			rtc_live_stream->ForceIDR();
+		}
+
+		if (++loop_count % 10 == 0) {
+			uint32_t video_bitrate = signaling_handler->UpdateVideoBitrate();
+			if (video_bitrate > 0) {
+				rtc_live_stream->SetVideoBitrate(video_bitrate);
+			}
+		}
 	}
 
 	return 0;
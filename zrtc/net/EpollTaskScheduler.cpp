@@ -17,6 +17,9 @@ EpollTaskScheduler::EpollTaskScheduler(int id)
     epollfd_ = epoll_create(1024);
  #endif
     this->UpdateChannel(wakeup_channel_);
+	if (timer_channel_) {
+		this->UpdateChannel(timer_channel_);
+	}
 }
 
 EpollTaskScheduler::~EpollTaskScheduler()
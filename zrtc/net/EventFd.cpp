@@ -0,0 +1,65 @@
+#include "EventFd.h"
+
+#if defined(__linux) || defined(__linux__) 
+#include <sys/eventfd.h>
+#endif
+
+using namespace xop;
+
+EventFd::EventFd()
+{
+
+}
+
+EventFd::~EventFd()
+{
+#if defined(__linux) || defined(__linux__) 
+	if (event_fd_ >= 0) {
+		::close(event_fd_);
+		event_fd_ = -1;
+	}
+#endif
+}
+
+bool EventFd::Create()
+{
+#if defined(__linux) || defined(__linux__) 
+	event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	return event_fd_ >= 0;
+#else
+	return pipe_.Create();
+#endif
+}
+
+void EventFd::Notify()
+{
+#if defined(__linux) || defined(__linux__) 
+	uint64_t one = 1;
+	ssize_t ret = ::write(event_fd_, &one, sizeof(one));
+	(void)ret;
+#else
+	char event = 1;
+	pipe_.Write(&event, 1);
+#endif
+}
+
+void EventFd::Clear()
+{
+#if defined(__linux) || defined(__linux__) 
+	uint64_t count = 0;
+	ssize_t ret = ::read(event_fd_, &count, sizeof(count));
+	(void)ret;
+#else
+	char event[10] = { 0 };
+	while (pipe_.Read(event, 10) > 0);
+#endif
+}
+
+SOCKET EventFd::GetFd() const
+{
+#if defined(__linux) || defined(__linux__) 
+	return event_fd_;
+#else
+	return pipe_.Read();
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef XOP_EVENT_FD_H
+#define XOP_EVENT_FD_H
+
+#include "Pipe.h"
+
+namespace xop
+{
+
+// Wakeup handle of a task scheduler: eventfd on linux, a socket pair elsewhere.
+class EventFd
+{
+public:
+	EventFd();
+	virtual ~EventFd();
+
+	bool   Create();
+	void   Notify();
+	void   Clear();
+
+	SOCKET GetFd() const;
+
+private:
+#if defined(__linux) || defined(__linux__) 
+	int event_fd_ = -1;
+#else
+	Pipe pipe_;
+#endif
+};
+
+}
+
+#endif
@@ -48,6 +48,16 @@ std::shared_ptr<TaskScheduler> EventLoop::GetTaskScheduler()
 	return nullptr;
 }
 
+std::vector<std::shared_ptr<TaskScheduler>> EventLoop::GetTaskSchedulers()
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	if (task_schedulers_.size() <= 1) {
+		return task_schedulers_;
+	}
+
+	return std::vector<std::shared_ptr<TaskScheduler>>(task_schedulers_.begin() + 1, task_schedulers_.end());
+}
+
 void EventLoop::Loop()
 {
 	std::lock_guard<std::mutex> locker(mutex_);
@@ -59,7 +69,13 @@ void EventLoop::Loop()
 	for (uint32_t n = 0; n < num_threads_; n++) 
 	{
 #if defined(__linux) || defined(__linux__) 
-		std::shared_ptr<TaskScheduler> task_scheduler_ptr(new EpollTaskScheduler(n));
+		std::shared_ptr<TaskScheduler> task_scheduler_ptr;
+		if (IoUringTaskScheduler::IsSupported()) {
+			task_scheduler_ptr.reset(new IoUringTaskScheduler(n));
+		}
+		else {
+			task_scheduler_ptr.reset(new EpollTaskScheduler(n));
+		}
 #elif defined(WIN32) || defined(_WIN32) 
 		std::shared_ptr<TaskScheduler> task_scheduler_ptr(new SelectTaskScheduler(n));
 #endif
@@ -151,7 +167,7 @@ bool EventLoop::AddTriggerEvent(TriggerEvent callback)
 {   
 	std::lock_guard<std::mutex> locker(mutex_);
 	if (task_schedulers_.size() > 0) {
-		return task_schedulers_[0]->AddTriggerEvent(callback);
+		return task_schedulers_[0]->AddTriggerEvent(std::move(callback));
 	}
 	return false;
 }
@@ -14,6 +14,7 @@
 
 #include "SelectTaskScheduler.h"
 #include "EpollTaskScheduler.h"
+#include "IoUringTaskScheduler.h"
 #include "Pipe.h"
 #include "Timer.h"
 #include "RingBuffer.h"
@@ -36,6 +37,8 @@ public:
 	virtual ~EventLoop();
 
 	std::shared_ptr<TaskScheduler> GetTaskScheduler();
+	// the schedulers GetTaskScheduler() hands out
+	std::vector<std::shared_ptr<TaskScheduler>> GetTaskSchedulers();
 
 	bool AddTriggerEvent(TriggerEvent callback);
 	TimerId AddTimer(TimerEvent timerEvent, uint32_t msec);
@@ -0,0 +1,817 @@
+#include "IoUringTaskScheduler.h"
+#include <algorithm>
+
+#if defined(__linux) || defined(__linux__)
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <netinet/udp.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+// multishot recvmsg and provided buffer rings came with linux 6.0 headers
+#if defined(IORING_RECV_MULTISHOT)
+#define XOP_IO_URING_DATAGRAM 1
+#endif
+#endif
+
+using namespace xop;
+
+// the top bits of user_data tell the requests apart, poll requests leave them 0
+static const uint64_t kRecvRequest = 1ULL << 62;
+static const uint64_t kSendRequest = 2ULL << 62;
+static const uint64_t kRequestMask = 3ULL << 62;
+static const uint32_t kGenerationMask = 0x3fffffff;
+
+// per datagram socket: 256 buffers of 2 KB, a payload of up to 2016 bytes after the
+// io_uring_recvmsg_out header and the peer address, larger datagrams are dropped
+static const uint32_t kDatagramBuffers = 256;
+static const size_t kDatagramBufferSize = 2048;
+static const uint32_t kMaxSendSlots = 1024;
+// a sendmsg gathers at most this many buffers in place, a GSO run of the udp demuxer fits
+static const size_t kMaxSendIovecs = 64;
+
+struct IoUringTaskScheduler::DatagramSocket
+{
+	~DatagramSocket()
+	{
+#if defined(__linux) || defined(__linux__)
+		if (buf_ring) {
+			munmap(buf_ring, buf_ring_size);
+		}
+#endif
+	}
+
+	SOCKET sockfd = 0;
+	uint64_t user_data = 0;
+	uint16_t group_id = 0;
+	bool is_armed = false;
+	DatagramCallback recv_callback;
+	DatagramErrorCallback error_callback;
+
+	// io_uring_buf_ring, the tail is only moved by the loop thread
+	void* buf_ring = nullptr;
+	size_t buf_ring_size = 0;
+	uint16_t buf_tail = 0;
+	std::unique_ptr<uint8_t[]> buffers;
+#if defined(__linux) || defined(__linux__)
+	struct msghdr recv_msg;
+#endif
+};
+
+struct IoUringTaskScheduler::SendSlot
+{
+	uint32_t index = 0;
+	SOCKET sockfd = 0;
+	// the buffers sent in place, released by the completion
+	std::vector<RefPtr<DatagramBuffer>> owners;
+	// the copy of buffers sent without owners
+	std::unique_ptr<uint8_t[]> data;
+	size_t capacity = 0;
+	sockaddr_in peer_addr;
+#if defined(__linux) || defined(__linux__)
+	struct msghdr msg;
+	struct iovec iovs[kMaxSendIovecs];
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} control;
+#endif
+};
+
+#if defined(__linux) || defined(__linux__)
+static int IoUringSetup(uint32_t entries, struct io_uring_params* params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoUringEnter(int ring_fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags, void* arg, size_t arg_size)
+{
+	return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int IoUringRegister(int ring_fd, uint32_t opcode, void* arg, uint32_t nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+#endif
+
+IoUringTaskScheduler::IoUringTaskScheduler(int id)
+	: TaskScheduler(id)
+{
+	Setup(1024);
+
+	this->UpdateChannel(wakeup_channel_);
+	if (timer_channel_) {
+		this->UpdateChannel(timer_channel_);
+	}
+}
+
+IoUringTaskScheduler::~IoUringTaskScheduler()
+{
+	Release();
+}
+
+bool IoUringTaskScheduler::IsSupported()
+{
+#if defined(__linux) || defined(__linux__)
+	static int is_supported = -1;
+	static std::once_flag flag;
+	std::call_once(flag, [] {
+		struct io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		int ring_fd = IoUringSetup(4, &params);
+		is_supported = ring_fd >= 0 && (params.features & IORING_FEAT_EXT_ARG);
+		if (ring_fd >= 0) {
+			close(ring_fd);
+		}
+	});
+	return is_supported == 1;
+#else
+	return false;
+#endif
+}
+
+bool IoUringTaskScheduler::IsDatagramSupported()
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	static int is_supported = -1;
+	static std::once_flag flag;
+	std::call_once(flag, [] {
+		is_supported = 0;
+		if (!IsSupported()) {
+			return;
+		}
+
+		SOCKET sockfd = ::socket(AF_INET, SOCK_DGRAM, 0);
+		if (sockfd < 0) {
+			return;
+		}
+
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t addr_len = sizeof(addr);
+		if (::bind(sockfd, (struct sockaddr*)&addr, sizeof(addr)) == 0
+			&& getsockname(sockfd, (struct sockaddr*)&addr, &addr_len) == 0) {
+			// the kernel has to take the multishot recvmsg and hand over a datagram with its address
+			IoUringTaskScheduler probe(0);
+			bool is_received = false;
+			auto recv_callback = [&is_received, &addr](uint8_t* data, size_t size, const sockaddr_in& peer_addr) {
+				is_received = size == 5 && peer_addr.sin_port == addr.sin_port;
+			};
+
+			if (probe.RegisterDatagramSocket(sockfd, recv_callback, nullptr)) {
+				::sendto(sockfd, "probe", 5, 0, (struct sockaddr*)&addr, sizeof(addr));
+				for (int n = 0; n < 10 && !is_received; n++) {
+					probe.HandleEvent(10);
+				}
+				probe.RemoveDatagramSocket(sockfd);
+			}
+			is_supported = is_received ? 1 : 0;
+		}
+		::close(sockfd);
+	});
+	return is_supported == 1;
+#else
+	return false;
+#endif
+}
+
+bool IoUringTaskScheduler::Setup(uint32_t entries)
+{
+#if defined(__linux) || defined(__linux__)
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring_fd_ = IoUringSetup(entries, &params);
+	if (ring_fd_ < 0) {
+		return false;
+	}
+
+	sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+	}
+
+	sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+	if (sq_ring_ == MAP_FAILED) {
+		sq_ring_ = nullptr;
+		Release();
+		return false;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		cq_ring_ = sq_ring_;
+	}
+	else {
+		cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+		if (cq_ring_ == MAP_FAILED) {
+			cq_ring_ = nullptr;
+			Release();
+			return false;
+		}
+	}
+
+	sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		Release();
+		return false;
+	}
+	sqes_ = (struct io_uring_sqe*)sqes;
+
+	uint8_t* sq_ring = (uint8_t*)sq_ring_;
+	sq_head_ = (uint32_t*)(sq_ring + params.sq_off.head);
+	sq_tail_ = (uint32_t*)(sq_ring + params.sq_off.tail);
+	sq_array_ = (uint32_t*)(sq_ring + params.sq_off.array);
+	sq_mask_ = *(uint32_t*)(sq_ring + params.sq_off.ring_mask);
+	sq_entries_ = params.sq_entries;
+
+	uint8_t* cq_ring = (uint8_t*)cq_ring_;
+	cq_head_ = (uint32_t*)(cq_ring + params.cq_off.head);
+	cq_tail_ = (uint32_t*)(cq_ring + params.cq_off.tail);
+	cq_mask_ = *(uint32_t*)(cq_ring + params.cq_off.ring_mask);
+	cqes_ = (struct io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void IoUringTaskScheduler::Release()
+{
+#if defined(__linux) || defined(__linux__)
+	if (sqes_) {
+		munmap(sqes_, sqes_size_);
+		sqes_ = nullptr;
+	}
+
+	if (cq_ring_ && cq_ring_ != sq_ring_) {
+		munmap(cq_ring_, cq_ring_size_);
+	}
+	cq_ring_ = nullptr;
+
+	if (sq_ring_) {
+		munmap(sq_ring_, sq_ring_size_);
+		sq_ring_ = nullptr;
+	}
+
+	if (ring_fd_ >= 0) {
+		close(ring_fd_);
+		ring_fd_ = -1;
+	}
+#endif
+}
+
+void IoUringTaskScheduler::UpdateChannel(ChannelPtr channel)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+#if defined(__linux) || defined(__linux__)
+	if (ring_fd_ < 0) {
+		return;
+	}
+
+	int fd = channel->GetSocket();
+	auto iter = channels_.find(fd);
+	if (iter != channels_.end()) {
+		RemovePoll(iter->second.user_data);
+		if (channel->IsNoneEvent()) {
+			channels_.erase(iter);
+		}
+		else {
+			iter->second.channel = channel;
+			iter->second.user_data = NextUserData(fd);
+			AddPoll(fd, channel->GetEvents(), iter->second.user_data);
+		}
+	}
+	else {
+		if (!channel->IsNoneEvent()) {
+			PollRequest request;
+			request.channel = channel;
+			request.user_data = NextUserData(fd);
+			AddPoll(fd, channel->GetEvents(), request.user_data);
+			channels_.emplace(fd, request);
+		}
+	}
+
+	// the loop thread submits with its next wait
+	if (loop_thread_id_ != std::this_thread::get_id()) {
+		Submit();
+	}
+#endif
+}
+
+void IoUringTaskScheduler::RemoveChannel(ChannelPtr& channel)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+#if defined(__linux) || defined(__linux__)
+	int fd = channel->GetSocket();
+
+	auto iter = channels_.find(fd);
+	if (iter != channels_.end()) {
+		RemovePoll(iter->second.user_data);
+		channels_.erase(iter);
+
+		if (loop_thread_id_ != std::this_thread::get_id()) {
+			Submit();
+		}
+	}
+#endif
+}
+
+bool IoUringTaskScheduler::HandleEvent(int timeout)
+{
+#if defined(__linux) || defined(__linux__)
+	if (ring_fd_ < 0) {
+		return false;
+	}
+
+	uint32_t to_submit = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		loop_thread_id_ = std::this_thread::get_id();
+		to_submit = pending_sqes_;
+		pending_sqes_ = 0;
+	}
+
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+
+	if (timeout != 0) {
+		if (timeout > 0) {
+			ts.tv_sec = timeout / 1000;
+			ts.tv_nsec = (timeout % 1000) * 1000000LL;
+			arg.ts = (uint64_t)(uintptr_t)&ts;
+		}
+
+		int ret = IoUringEnter(ring_fd_, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+		if (ret < 0 && errno != EINTR && errno != ETIME) {
+			return false;
+		}
+	}
+	else if (to_submit > 0) {
+		IoUringEnter(ring_fd_, to_submit, 0, 0, nullptr, 0);
+	}
+
+	uint32_t head = *cq_head_;
+	uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+	while (head != tail) {
+		struct io_uring_cqe cqe = cqes_[head & cq_mask_];
+		head++;
+		__atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+		HandleCompletion(&cqe);
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool IoUringTaskScheduler::PushSqe(const io_uring_sqe* sqe)
+{
+#if defined(__linux) || defined(__linux__)
+	uint32_t tail = *sq_tail_;
+	if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+		Submit();
+		if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+			return false;
+		}
+	}
+
+	uint32_t index = tail & sq_mask_;
+	sqes_[index] = *sqe;
+	sq_array_[index] = index;
+	__atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+	pending_sqes_++;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void IoUringTaskScheduler::AddPoll(int fd, int events, uint64_t user_data)
+{
+#if defined(__linux) || defined(__linux__)
+	// channel events use the same bits as poll(2). a one shot request checks the
+	// readiness when it is armed, so channels stay level triggered like with epoll:
+	// a read callback may leave data queued and is called again.
+	// multishot poll only fires on new wakeups and the kernel rejects IORING_POLL_ADD_LEVEL for it
+	struct io_uring_sqe sqe;
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_POLL_ADD;
+	sqe.fd = fd;
+	sqe.poll32_events = (uint32_t)events;
+	sqe.user_data = user_data;
+	PushSqe(&sqe);
+#endif
+}
+
+void IoUringTaskScheduler::RemovePoll(uint64_t user_data)
+{
+#if defined(__linux) || defined(__linux__)
+	struct io_uring_sqe sqe;
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_POLL_REMOVE;
+	sqe.fd = -1;
+	sqe.addr = user_data;
+	sqe.user_data = 0;
+	PushSqe(&sqe);
+#endif
+}
+
+uint64_t IoUringTaskScheduler::NextUserData(int fd)
+{
+	// the generation tells a stale completion from the current request,
+	// user_data 0 is left for requests whose completion is ignored
+	generation_ = (generation_ + 1) & kGenerationMask;
+	if (generation_ == 0) {
+		++generation_;
+	}
+	return ((uint64_t)generation_ << 32) | (uint32_t)fd;
+}
+
+void IoUringTaskScheduler::Submit()
+{
+#if defined(__linux) || defined(__linux__)
+	if (pending_sqes_ > 0) {
+		IoUringEnter(ring_fd_, pending_sqes_, 0, 0, nullptr, 0);
+		pending_sqes_ = 0;
+	}
+#endif
+}
+
+void IoUringTaskScheduler::HandleCompletion(io_uring_cqe* cqe)
+{
+#if defined(__linux) || defined(__linux__)
+	if (cqe->user_data == 0) {
+		return;
+	}
+
+	if ((cqe->user_data & kRequestMask) == kRecvRequest) {
+		HandleRecvCompletion(cqe);
+		return;
+	}
+	else if ((cqe->user_data & kRequestMask) == kSendRequest) {
+		HandleSendCompletion(cqe);
+		return;
+	}
+
+	ChannelPtr channel;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		int fd = (int)(uint32_t)cqe->user_data;
+		auto iter = channels_.find(fd);
+		if (iter == channels_.end() || iter->second.user_data != cqe->user_data) {
+			return;
+		}
+
+		if (cqe->res == -EINVAL) {
+			channels_.erase(iter);
+			return;
+		}
+
+		// re-armed before the callback, the request goes out with the next wait
+		iter->second.user_data = NextUserData(fd);
+		AddPoll(fd, iter->second.channel->GetEvents(), iter->second.user_data);
+
+		if (cqe->res <= 0) {
+			return;
+		}
+		channel = iter->second.channel;
+	}
+
+	channel->HandleEvent(cqe->res);
+#endif
+}
+
+bool IoUringTaskScheduler::AddDatagramSocket(SOCKET sockfd, DatagramCallback recv_callback, DatagramErrorCallback error_callback)
+{
+	if (!IsDatagramSupported()) {
+		return false;
+	}
+
+	return RegisterDatagramSocket(sockfd, recv_callback, error_callback);
+}
+
+bool IoUringTaskScheduler::RegisterDatagramSocket(SOCKET sockfd, DatagramCallback recv_callback, DatagramErrorCallback error_callback)
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (ring_fd_ < 0 || datagram_sockets_.count(sockfd)) {
+		return false;
+	}
+
+	auto datagram_socket = std::make_shared<DatagramSocket>();
+	DatagramSocket* sock = datagram_socket.get();
+	sock->sockfd = sockfd;
+	sock->group_id = next_group_id_++;
+	sock->recv_callback = recv_callback;
+	sock->error_callback = error_callback;
+
+	// the ring is shared with the kernel and must be page aligned
+	sock->buf_ring_size = kDatagramBuffers * sizeof(struct io_uring_buf);
+	void* buf_ring = mmap(nullptr, sock->buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf_ring == MAP_FAILED) {
+		return false;
+	}
+	sock->buf_ring = buf_ring;
+	sock->buffers.reset(new uint8_t[kDatagramBuffers * kDatagramBufferSize]);
+	for (uint32_t n = 0; n < kDatagramBuffers; n++) {
+		RecycleBuffer(sock, (uint16_t)n);
+	}
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+	reg.ring_entries = kDatagramBuffers;
+	reg.bgid = sock->group_id;
+	if (IoUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		return false;
+	}
+
+	// the name space reserved in each buffer receives the peer address, no control messages
+	memset(&sock->recv_msg, 0, sizeof(sock->recv_msg));
+	sock->recv_msg.msg_namelen = sizeof(struct sockaddr_in);
+	sock->user_data = kRecvRequest | NextUserData(sockfd);
+	AddRecv(sock);
+	datagram_sockets_.emplace(sockfd, datagram_socket);
+
+	if (loop_thread_id_ != std::this_thread::get_id()) {
+		Submit();
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void IoUringTaskScheduler::RemoveDatagramSocket(SOCKET sockfd)
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto iter = datagram_sockets_.find(sockfd);
+	if (iter == datagram_sockets_.end()) {
+		return;
+	}
+
+	auto datagram_socket = iter->second;
+	datagram_sockets_.erase(iter);
+
+	if (!datagram_socket->is_armed) {
+		UnregisterBuffers(datagram_socket.get());
+		return;
+	}
+
+	// the kernel may still fill a buffer until the request has ended
+	struct io_uring_sqe sqe;
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_ASYNC_CANCEL;
+	sqe.fd = -1;
+	sqe.addr = datagram_socket->user_data;
+	sqe.user_data = 0;
+	PushSqe(&sqe);
+	closing_sockets_.push_back(datagram_socket);
+
+	if (loop_thread_id_ != std::this_thread::get_id()) {
+		Submit();
+	}
+#endif
+}
+
+bool IoUringTaskScheduler::SendDatagram(SOCKET sockfd, uint8_t** bufs, const size_t* sizes, size_t count,
+	const sockaddr_in& peer_addr, uint16_t segment_size, DatagramBuffer* const* owners)
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (ring_fd_ < 0 || loop_thread_id_ != std::this_thread::get_id() || !datagram_sockets_.count(sockfd)) {
+		return false;
+	}
+
+	SendSlot* slot = AllocSendSlot();
+	if (!slot) {
+		return false;
+	}
+
+	size_t num_iovs = 0;
+	if (owners && count <= kMaxSendIovecs) {
+		// the kernel reads the buffers themselves, their owners keep them until the completion
+		for (size_t n = 0; n < count; n++) {
+			slot->owners.emplace_back(owners[n]);
+			slot->iovs[n].iov_base = bufs[n];
+			slot->iovs[n].iov_len = sizes[n];
+		}
+		num_iovs = count;
+	}
+	else {
+		size_t size = 0;
+		for (size_t n = 0; n < count; n++) {
+			size += sizes[n];
+		}
+
+		// a slot keeps its buffer, after a few loops no send allocates
+		if (slot->capacity < size) {
+			slot->capacity = std::max(size, kDatagramBufferSize);
+			slot->data.reset(new uint8_t[slot->capacity]);
+		}
+
+		size_t offset = 0;
+		for (size_t n = 0; n < count; n++) {
+			memcpy(slot->data.get() + offset, bufs[n], sizes[n]);
+			offset += sizes[n];
+		}
+		slot->iovs[0].iov_base = slot->data.get();
+		slot->iovs[0].iov_len = size;
+		num_iovs = 1;
+	}
+
+	slot->sockfd = sockfd;
+	slot->peer_addr = peer_addr;
+	memset(&slot->msg, 0, sizeof(slot->msg));
+	slot->msg.msg_name = &slot->peer_addr;
+	slot->msg.msg_namelen = sizeof(struct sockaddr_in);
+	slot->msg.msg_iov = slot->iovs;
+	slot->msg.msg_iovlen = num_iovs;
+
+	if (segment_size > 0 && count > 1) {
+		slot->msg.msg_control = slot->control.buf;
+		slot->msg.msg_controllen = sizeof(slot->control.buf);
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&slot->msg);
+		cmsg->cmsg_level = SOL_UDP;
+		cmsg->cmsg_type = UDP_SEGMENT;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+		memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+	}
+
+	struct io_uring_sqe sqe;
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_SENDMSG;
+	sqe.fd = sockfd;
+	sqe.addr = (uint64_t)(uintptr_t)&slot->msg;
+	sqe.len = 1;
+	sqe.user_data = kSendRequest | slot->index;
+	if (!PushSqe(&sqe)) {
+		slot->owners.clear();
+		free_send_slots_.push_back(slot->index);
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void IoUringTaskScheduler::AddRecv(DatagramSocket* datagram_socket)
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	struct io_uring_sqe sqe;
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_RECVMSG;
+	sqe.fd = datagram_socket->sockfd;
+	sqe.addr = (uint64_t)(uintptr_t)&datagram_socket->recv_msg;
+	sqe.ioprio = IORING_RECV_MULTISHOT;
+	sqe.flags = IOSQE_BUFFER_SELECT;
+	sqe.buf_group = datagram_socket->group_id;
+	sqe.user_data = datagram_socket->user_data;
+	datagram_socket->is_armed = PushSqe(&sqe);
+#endif
+}
+
+void IoUringTaskScheduler::RecycleBuffer(DatagramSocket* datagram_socket, uint16_t buffer_id)
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	// io_uring_buf_ring declares its entries as a flexible array that c++ places after a padding byte,
+	// the entries are addressed directly, the tail is the reserved field of the first one
+	struct io_uring_buf* bufs = (struct io_uring_buf*)datagram_socket->buf_ring;
+	struct io_uring_buf* buf = &bufs[datagram_socket->buf_tail & (kDatagramBuffers - 1)];
+	buf->addr = (uint64_t)(uintptr_t)(datagram_socket->buffers.get() + buffer_id * kDatagramBufferSize);
+	buf->len = (uint32_t)kDatagramBufferSize;
+	buf->bid = buffer_id;
+	datagram_socket->buf_tail++;
+	__atomic_store_n(&bufs[0].resv, datagram_socket->buf_tail, __ATOMIC_RELEASE);
+#endif
+}
+
+void IoUringTaskScheduler::UnregisterBuffers(DatagramSocket* datagram_socket)
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.bgid = datagram_socket->group_id;
+	IoUringRegister(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+#endif
+}
+
+void IoUringTaskScheduler::HandleRecvCompletion(io_uring_cqe* cqe)
+{
+#if defined(XOP_IO_URING_DATAGRAM)
+	std::shared_ptr<DatagramSocket> datagram_socket;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		int fd = (int)(uint32_t)cqe->user_data;
+		auto iter = datagram_sockets_.find(fd);
+		if (iter == datagram_sockets_.end() || iter->second->user_data != cqe->user_data) {
+			// a removed socket, its buffers are freed once its request has ended
+			if (!(cqe->flags & IORING_CQE_F_MORE)) {
+				for (auto closing = closing_sockets_.begin(); closing != closing_sockets_.end(); closing++) {
+					if ((*closing)->user_data == cqe->user_data) {
+						UnregisterBuffers(closing->get());
+						closing_sockets_.erase(closing);
+						break;
+					}
+				}
+			}
+			return;
+		}
+		datagram_socket = iter->second;
+
+		// the request ends when the buffer ring ran dry (ENOBUFS) or the kernel cut it short,
+		// it is re-armed before the buffers of this batch are given back
+		if (!(cqe->flags & IORING_CQE_F_MORE)) {
+			datagram_socket->is_armed = false;
+			if (cqe->res != -EINVAL && cqe->res != -EBADF && cqe->res != -ENOTSOCK) {
+				datagram_socket->user_data = kRecvRequest | NextUserData(fd);
+				AddRecv(datagram_socket.get());
+			}
+		}
+	}
+
+	if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+		return;
+	}
+
+	// io_uring_recvmsg_out, the peer address in the name space reserved by recv_msg, then the payload
+	uint16_t buffer_id = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+	uint8_t* buffer = datagram_socket->buffers.get() + buffer_id * kDatagramBufferSize;
+	struct io_uring_recvmsg_out* recvmsg_out = (struct io_uring_recvmsg_out*)buffer;
+	size_t payload_offset = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in);
+
+	if (cqe->res > 0 && (size_t)cqe->res >= payload_offset + recvmsg_out->payloadlen && recvmsg_out->payloadlen > 0
+		&& recvmsg_out->namelen >= sizeof(struct sockaddr_in) && !(recvmsg_out->flags & MSG_TRUNC)) {
+		struct sockaddr_in peer_addr;
+		memcpy(&peer_addr, buffer + sizeof(struct io_uring_recvmsg_out), sizeof(peer_addr));
+		datagram_socket->recv_callback(buffer + payload_offset, recvmsg_out->payloadlen, peer_addr);
+	}
+
+	RecycleBuffer(datagram_socket.get(), buffer_id);
+#endif
+}
+
+void IoUringTaskScheduler::HandleSendCompletion(io_uring_cqe* cqe)
+{
+	uint32_t index = (uint32_t)cqe->user_data;
+	if (index >= send_slots_.size()) {
+		return;
+	}
+
+	// the buffers sent in place go back to their owners
+	SOCKET sockfd = send_slots_[index]->sockfd;
+	send_slots_[index]->owners.clear();
+	free_send_slots_.push_back(index);
+	if (cqe->res >= 0) {
+		return;
+	}
+
+	DatagramErrorCallback error_callback;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto iter = datagram_sockets_.find(sockfd);
+		if (iter != datagram_sockets_.end()) {
+			error_callback = iter->second->error_callback;
+		}
+	}
+
+	if (error_callback) {
+		error_callback(-cqe->res);
+	}
+}
+
+IoUringTaskScheduler::SendSlot* IoUringTaskScheduler::AllocSendSlot()
+{
+	uint32_t index = 0;
+	if (!free_send_slots_.empty()) {
+		index = free_send_slots_.back();
+		free_send_slots_.pop_back();
+	}
+	else if (send_slots_.size() < kMaxSendSlots) {
+		index = (uint32_t)send_slots_.size();
+		send_slots_.emplace_back(new SendSlot);
+		send_slots_.back()->index = index;
+		send_slots_.back()->owners.reserve(kMaxSendIovecs);
+	}
+	else {
+		return nullptr;
+	}
+
+	return send_slots_[index].get();
+}
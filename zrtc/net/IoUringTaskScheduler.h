@@ -0,0 +1,110 @@
+#ifndef XOP_IO_URING_TASK_SCHEDULER_H
+#define XOP_IO_URING_TASK_SCHEDULER_H
+
+#include "TaskScheduler.h"
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace xop
+{
+
+// Channels are watched with one shot poll requests on an io_uring, re-armed after each event.
+// Updates made on the loop thread are submitted together with the next wait,
+// so registering, re-arming and waiting costs one io_uring_enter per loop.
+// Datagram sockets are read by a multishot recvmsg into a provided buffer ring registered
+// per socket (linux 6.0+), and written by sendmsg requests queued on the loop thread,
+// so receiving and sending share that io_uring_enter too. A send gathers the caller's
+// buffers in place and holds their owners until its completion, or copies them when there are none.
+class IoUringTaskScheduler : public TaskScheduler
+{
+public:
+	IoUringTaskScheduler(int id = 0);
+	virtual ~IoUringTaskScheduler();
+
+	// io_uring with timed waits (linux 5.11+), checked once per process
+	static bool IsSupported();
+	// multishot recvmsg with provided buffer rings, checked once per process on a loopback socket
+	static bool IsDatagramSupported();
+
+	void UpdateChannel(ChannelPtr channel);
+	void RemoveChannel(ChannelPtr& channel);
+
+	// timeout: ms
+	bool HandleEvent(int timeout);
+
+	bool AddDatagramSocket(SOCKET sockfd, DatagramCallback recv_callback, DatagramErrorCallback error_callback);
+	void RemoveDatagramSocket(SOCKET sockfd);
+	bool SendDatagram(SOCKET sockfd, uint8_t** bufs, const size_t* sizes, size_t count,
+		const sockaddr_in& peer_addr, uint16_t segment_size, DatagramBuffer* const* owners);
+
+private:
+	struct PollRequest
+	{
+		ChannelPtr channel;
+		uint64_t user_data = 0;
+	};
+
+	struct DatagramSocket;
+	struct SendSlot;
+
+	bool Setup(uint32_t entries);
+	void Release();
+
+	bool PushSqe(const io_uring_sqe* sqe);
+	void AddPoll(int fd, int events, uint64_t user_data);
+	void RemovePoll(uint64_t user_data);
+	uint64_t NextUserData(int fd);
+	void Submit();
+	void HandleCompletion(io_uring_cqe* cqe);
+
+	bool RegisterDatagramSocket(SOCKET sockfd, DatagramCallback recv_callback, DatagramErrorCallback error_callback);
+	void AddRecv(DatagramSocket* datagram_socket);
+	void RecycleBuffer(DatagramSocket* datagram_socket, uint16_t buffer_id);
+	void UnregisterBuffers(DatagramSocket* datagram_socket);
+	void HandleRecvCompletion(io_uring_cqe* cqe);
+	void HandleSendCompletion(io_uring_cqe* cqe);
+	SendSlot* AllocSendSlot();
+
+	int ring_fd_ = -1;
+	void* sq_ring_ = nullptr;
+	void* cq_ring_ = nullptr;
+	size_t sq_ring_size_ = 0;
+	size_t cq_ring_size_ = 0;
+	size_t sqes_size_ = 0;
+
+	uint32_t* sq_head_ = nullptr;
+	uint32_t* sq_tail_ = nullptr;
+	uint32_t* sq_array_ = nullptr;
+	uint32_t sq_mask_ = 0;
+	uint32_t sq_entries_ = 0;
+	io_uring_sqe* sqes_ = nullptr;
+
+	uint32_t* cq_head_ = nullptr;
+	uint32_t* cq_tail_ = nullptr;
+	uint32_t cq_mask_ = 0;
+	io_uring_cqe* cqes_ = nullptr;
+
+	uint32_t pending_sqes_ = 0;
+	uint32_t generation_ = 0;
+	std::thread::id loop_thread_id_;
+
+	std::mutex mutex_;
+	std::unordered_map<int, PollRequest> channels_;
+	std::unordered_map<int, std::shared_ptr<DatagramSocket>> datagram_sockets_;
+	// removed sockets wait for the end of their recv request before the buffers are freed
+	std::vector<std::shared_ptr<DatagramSocket>> closing_sockets_;
+	uint16_t next_group_id_ = 0;
+
+	// loop thread only, a slot is busy from its sendmsg until the completion
+	std::vector<std::unique_ptr<SendSlot>> send_slots_;
+	std::vector<uint32_t> free_send_slots_;
+};
+
+}
+
+#endif
@@ -1,4 +1,9 @@
 #include "MemoryManager.h"
+#include <vector>
+
+#if defined(__linux) || defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 using namespace xop;
 
@@ -124,3 +129,153 @@ void MemoryManager::Free(void* ptr)
 		::free(block);
 	}
 }
+
+namespace
+{
+
+class PacketSlabPool;
+
+struct PacketBlock
+{
+	PacketBlock* next;
+	PacketSlabPool* pool;
+};
+
+static const uint32_t kPacketBlockSize = PacketPool::kBufferSize + sizeof(PacketBlock);
+static const uint32_t kPacketSlabSize = 256 * 1024;
+static const uint32_t kPacketHugeSlabSize = 2 * 1024 * 1024;
+
+static std::atomic<bool> s_use_huge_pages(false);
+
+class PacketSlabPool
+{
+public:
+	void* Alloc()
+	{
+		if (!free_list_) {
+			free_list_ = remote_free_list_.exchange(nullptr, std::memory_order_acquire);
+			if (!free_list_) {
+				AllocSlab();
+			}
+		}
+
+		PacketBlock* block = free_list_;
+		free_list_ = block->next;
+		Increase(alloc_count_);
+		return block + 1;
+	}
+
+	void Free(PacketBlock* block, bool is_owner)
+	{
+		if (is_owner) {
+			block->next = free_list_;
+			free_list_ = block;
+			return;
+		}
+
+		// the owner takes the whole list at once, so there is no ABA on pop
+		PacketBlock* head = remote_free_list_.load(std::memory_order_relaxed);
+		do {
+			block->next = head;
+		} while (!remote_free_list_.compare_exchange_weak(head, block,
+			std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	// counters are only written by the thread that owns them
+	static void Increase(std::atomic<uint64_t>& counter, uint64_t value = 1)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t> alloc_count_{0};
+	std::atomic<uint64_t> free_count_{0};
+	std::atomic<uint64_t> slab_count_{0};
+	std::atomic<uint64_t> slab_bytes_{0};
+
+private:
+	void AllocSlab()
+	{
+		char* slab = nullptr;
+		uint32_t slab_size = kPacketSlabSize;
+
+#if defined(__linux) || defined(__linux__)
+		if (s_use_huge_pages) {
+			void* ptr = mmap(nullptr, kPacketHugeSlabSize, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (ptr != MAP_FAILED) {
+				slab = (char*)ptr;
+				slab_size = kPacketHugeSlabSize;
+			}
+		}
+#endif
+		if (!slab) {
+			slab = (char*)malloc(slab_size);
+		}
+
+		for (uint32_t offset = 0; offset + kPacketBlockSize <= slab_size; offset += kPacketBlockSize) {
+			PacketBlock* block = (PacketBlock*)(slab + offset);
+			block->pool = this;
+			block->next = free_list_;
+			free_list_ = block;
+		}
+
+		Increase(slab_count_);
+		Increase(slab_bytes_, slab_size);
+	}
+
+	PacketBlock* free_list_ = nullptr;
+	std::atomic<PacketBlock*> remote_free_list_{nullptr};
+};
+
+// pools outlive their thread, buffers still in flight may be freed later
+static std::mutex s_pools_mutex;
+static std::vector<PacketSlabPool*> s_pools;
+static thread_local PacketSlabPool* s_thread_pool = nullptr;
+
+static PacketSlabPool* GetThreadPool()
+{
+	if (!s_thread_pool) {
+		s_thread_pool = new PacketSlabPool;
+		std::lock_guard<std::mutex> locker(s_pools_mutex);
+		s_pools.push_back(s_thread_pool);
+	}
+	return s_thread_pool;
+}
+
+}
+
+void* PacketPool::Alloc()
+{
+	return GetThreadPool()->Alloc();
+}
+
+void PacketPool::Free(void* ptr)
+{
+	if (!ptr) {
+		return;
+	}
+
+	PacketSlabPool* thread_pool = GetThreadPool();
+	PacketSlabPool::Increase(thread_pool->free_count_);
+
+	PacketBlock* block = (PacketBlock*)ptr - 1;
+	block->pool->Free(block, block->pool == thread_pool);
+}
+
+void PacketPool::EnableHugePages(bool enable)
+{
+	s_use_huge_pages = enable;
+}
+
+PacketPool::Stats PacketPool::GetStats()
+{
+	Stats stats;
+	std::lock_guard<std::mutex> locker(s_pools_mutex);
+	for (auto pool : s_pools) {
+		stats.alloc_count += pool->alloc_count_.load(std::memory_order_relaxed);
+		stats.free_count += pool->free_count_.load(std::memory_order_relaxed);
+		stats.slab_count += pool->slab_count_.load(std::memory_order_relaxed);
+		stats.slab_bytes += pool->slab_bytes_.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <mutex>
+#include <atomic>
+#include <utility>
 
 namespace xop
 {
@@ -58,5 +60,101 @@ private:
 	MemoryPool memory_pools_[kMaxMemoryPool];
 };
 
+// Fixed size packet buffers carved from slabs, each thread allocates from its own pool
+// without locking. A buffer freed on another thread is handed back to its owner
+// through a lock-free list. Buffers are not zeroed.
+// Once warmed up, packetizing a frame and stamping it for each viewer allocates nothing,
+// the packets come from here and the frames and vectors that carry them are recycled.
+// Slabs are kept until the process exits, a pool holds the buffers of its busiest moment.
+class PacketPool
+{
+public:
+	static const uint32_t kBufferSize = 2032;
+
+	struct Stats
+	{
+		uint64_t alloc_count = 0;
+		uint64_t free_count = 0;
+		uint64_t slab_count = 0;
+		uint64_t slab_bytes = 0;
+	};
+
+	static void* Alloc();
+	static void  Free(void* ptr);
+
+	// back new slabs with 2MB huge pages when the system has them reserved (linux)
+	static void  EnableHugePages(bool enable);
+
+	// slab_count only grows when the pools run dry, it stays flat in steady state
+	static Stats GetStats();
+};
+
+// A buffer a scheduler sends without a copy, referenced until the kernel is done with it.
+class DatagramBuffer
+{
+public:
+	virtual void AddRef() = 0;
+	virtual void Release() = 0;
+
+protected:
+	~DatagramBuffer() = default;
+};
+
+// Intrusive reference counted pointer, T provides AddRef() and Release().
+template <typename T>
+class RefPtr
+{
+public:
+	RefPtr() = default;
+
+	RefPtr(std::nullptr_t) {}
+
+	explicit RefPtr(T* ptr)
+		: ptr_(ptr)
+	{
+		if (ptr_) {
+			ptr_->AddRef();
+		}
+	}
+
+	RefPtr(const RefPtr& other)
+		: RefPtr(other.ptr_)
+	{}
+
+	RefPtr(RefPtr&& other) noexcept
+		: ptr_(other.ptr_)
+	{ other.ptr_ = nullptr; }
+
+	~RefPtr()
+	{ reset(); }
+
+	RefPtr& operator=(RefPtr other) noexcept
+	{
+		std::swap(ptr_, other.ptr_);
+		return *this;
+	}
+
+	void reset()
+	{
+		if (ptr_) {
+			ptr_->Release();
+			ptr_ = nullptr;
+		}
+	}
+
+	T* get() const { return ptr_; }
+	T* operator->() const { return ptr_; }
+	T& operator*() const { return *ptr_; }
+	explicit operator bool() const { return ptr_ != nullptr; }
+
+	bool operator==(const RefPtr& other) const { return ptr_ == other.ptr_; }
+	bool operator!=(const RefPtr& other) const { return ptr_ != other.ptr_; }
+	bool operator==(std::nullptr_t) const { return ptr_ == nullptr; }
+	bool operator!=(std::nullptr_t) const { return ptr_ != nullptr; }
+
+private:
+	T* ptr_ = nullptr;
+};
+
 }
 #endif
@@ -21,6 +21,9 @@ SelectTaskScheduler::SelectTaskScheduler(int id)
 	FD_ZERO(&fd_exp_backup_);
 
 	this->UpdateChannel(wakeup_channel_);
+	if (timer_channel_) {
+		this->UpdateChannel(timer_channel_);
+	}
 }
 
 SelectTaskScheduler::~SelectTaskScheduler()
@@ -151,7 +154,7 @@ bool SelectTaskScheduler::HandleEvent(int timeout)
 		memcpy(&fd_exp, &fd_exp_backup_, sizeof(fd_set));
 	}
 
-	if(timeout <= 0) {
+	if(timeout < 0) {
 		timeout = 10;
 	}
 
@@ -0,0 +1,220 @@
+#ifndef XOP_TASK_QUEUE_H
+#define XOP_TASK_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace xop
+{
+
+// Move-only callable, small captures are stored inline without a heap allocation.
+class Task
+{
+public:
+	Task() = default;
+
+	template <typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+	Task(F&& f)
+	{
+		using T = typename std::decay<F>::type;
+		Construct<T>(std::forward<F>(f), std::integral_constant<bool,
+			sizeof(T) <= kInlineSize && alignof(T) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible<T>::value>());
+	}
+
+	Task(Task&& other) noexcept
+	{ MoveFrom(other); }
+
+	Task& operator=(Task&& other) noexcept
+	{
+		if (this != &other) {
+			Reset();
+			MoveFrom(other);
+		}
+		return *this;
+	}
+
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	~Task()
+	{ Reset(); }
+
+	explicit operator bool() const
+	{ return ops_ != nullptr; }
+
+	void operator()()
+	{
+		if (ops_) {
+			ops_->invoke(storage_);
+		}
+	}
+
+	void Reset()
+	{
+		if (ops_) {
+			ops_->destroy(storage_);
+			ops_ = nullptr;
+		}
+	}
+
+	static const size_t kInlineSize = 64;
+
+private:
+	struct Ops
+	{
+		void (*invoke)(void* storage);
+		void (*move)(void* dst, void* src);
+		void (*destroy)(void* storage);
+	};
+
+	template <typename T, typename F>
+	void Construct(F&& f, std::true_type)
+	{
+		new (storage_) T(std::forward<F>(f));
+		ops_ = InlineOps<T>();
+	}
+
+	template <typename T, typename F>
+	void Construct(F&& f, std::false_type)
+	{
+		*reinterpret_cast<T**>(storage_) = new T(std::forward<F>(f));
+		ops_ = HeapOps<T>();
+	}
+
+	template <typename T>
+	static const Ops* InlineOps()
+	{
+		static const Ops ops = {
+			[](void* storage) { (*static_cast<T*>(storage))(); },
+			[](void* dst, void* src) {
+				new (dst) T(std::move(*static_cast<T*>(src)));
+				static_cast<T*>(src)->~T();
+			},
+			[](void* storage) { static_cast<T*>(storage)->~T(); },
+		};
+		return &ops;
+	}
+
+	template <typename T>
+	static const Ops* HeapOps()
+	{
+		static const Ops ops = {
+			[](void* storage) { (**static_cast<T**>(storage))(); },
+			[](void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+			[](void* storage) { delete *static_cast<T**>(storage); },
+		};
+		return &ops;
+	}
+
+	void MoveFrom(Task& other)
+	{
+		if (other.ops_) {
+			other.ops_->move(storage_, other.storage_);
+			ops_ = other.ops_;
+			other.ops_ = nullptr;
+		}
+	}
+
+	alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+	const Ops* ops_ = nullptr;
+};
+
+// Bounded lock-free queue, any thread may push, only the owner thread pops.
+template <typename T>
+class MpscQueue
+{
+public:
+	MpscQueue(uint32_t capacity = 1024)
+	{
+		capacity_ = 1;
+		while (capacity_ < capacity) {
+			capacity_ <<= 1;
+		}
+		mask_ = capacity_ - 1;
+
+		slots_.reset(new Slot[capacity_]);
+		for (size_t n = 0; n < capacity_; n++) {
+			slots_[n].sequence.store(n, std::memory_order_relaxed);
+		}
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// returns false when the queue is full
+	bool Push(T&& data)
+	{
+		Slot* slot = nullptr;
+		size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+
+		for (;;) {
+			slot = &slots_[pos & mask_];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+			if (diff == 0) {
+				if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->data = std::move(data);
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(T& data)
+	{
+		Slot* slot = &slots_[dequeue_pos_ & mask_];
+		size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		if (sequence != dequeue_pos_ + 1) {
+			return false;
+		}
+
+		data = std::move(slot->data);
+		slot->sequence.store(dequeue_pos_ + capacity_, std::memory_order_release);
+		dequeue_pos_++;
+		return true;
+	}
+
+	// consumer side only
+	bool IsEmpty() const
+	{
+		const Slot* slot = &slots_[dequeue_pos_ & mask_];
+		return slot->sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1;
+	}
+
+	size_t Capacity() const
+	{ return capacity_; }
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	size_t capacity_ = 0;
+	size_t mask_ = 0;
+	std::unique_ptr<Slot[]> slots_;
+
+	alignas(64) std::atomic<size_t> enqueue_pos_{0};
+	alignas(64) size_t dequeue_pos_ = 0;
+};
+
+}
+
+#endif
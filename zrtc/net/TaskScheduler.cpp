@@ -8,8 +8,10 @@ using namespace xop;
 TaskScheduler::TaskScheduler(int id)
 	: id_(id)
 	, is_shutdown_(false) 
-	, wakeup_pipe_(new Pipe())
-	, trigger_events_(new xop::RingBuffer<TriggerEvent>(kMaxTriggetEvents))
+	, is_sleeping_(false)
+	, dropped_trigger_events_(0)
+	, wakeup_event_(new EventFd())
+	, trigger_events_(new xop::MpscQueue<TriggerEvent>(kMaxTriggetEvents))
 {
 	static std::once_flag flag;
 	std::call_once(flag, [] {
@@ -21,11 +23,17 @@ TaskScheduler::TaskScheduler(int id)
 #endif
 	});
 
-	if (wakeup_pipe_->Create()) {
-		wakeup_channel_.reset(new Channel(wakeup_pipe_->Read()));
+	if (wakeup_event_->Create()) {
+		wakeup_channel_.reset(new Channel(wakeup_event_->GetFd()));
 		wakeup_channel_->EnableReading();
 		wakeup_channel_->SetReadCallback([this]() { this->Wake(); });		
 	}        
+
+	if (timer_queue_.GetTimerFd() >= 0) {
+		timer_channel_.reset(new Channel(timer_queue_.GetTimerFd()));
+		timer_channel_->EnableReading();
+		timer_channel_->SetReadCallback([this]() { this->timer_queue_.ClearTimerFd(); });
+	}
 }
 
 TaskScheduler::~TaskScheduler()
@@ -47,15 +55,22 @@ void TaskScheduler::Start()
 		this->HandleTriggerEvent();
 		this->timer_queue_.HandleTimerEvent();
 		int64_t timeout = this->timer_queue_.GetTimeRemaining();
+
+		// producers only signal the wakeup event while we are asleep
+		is_sleeping_.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!trigger_events_->IsEmpty()) {
+			timeout = 0;
+		}
 		this->HandleEvent((int)timeout);
+		is_sleeping_.store(false, std::memory_order_relaxed);
 	}
 }
 
 void TaskScheduler::Stop()
 {
 	is_shutdown_ = true;
-	char event = kTriggetEvent;
-	wakeup_pipe_->Write(&event, 1);
+	wakeup_event_->Notify();
 }
 
 TimerId TaskScheduler::AddTimer(TimerEvent timerEvent, uint32_t msec)
@@ -71,30 +86,32 @@ void TaskScheduler::RemoveTimer(TimerId timerId)
 
 bool TaskScheduler::AddTriggerEvent(TriggerEvent callback)
 {
-	if (trigger_events_->Size() < kMaxTriggetEvents) {
-		std::lock_guard<std::mutex> lock(mutex_);
-		char event = kTriggetEvent;
-		trigger_events_->Push(std::move(callback));
-		wakeup_pipe_->Write(&event, 1);
-		return true;
+	if (!trigger_events_->Push(std::move(callback))) {
+		dropped_trigger_events_++;
+		return false;
 	}
 
-	return false;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (is_sleeping_.load(std::memory_order_relaxed) && is_sleeping_.exchange(false)) {
+		wakeup_event_->Notify();
+	}
+
+	return true;
 }
 
 void TaskScheduler::Wake()
 {
-	char event[10] = { 0 };
-	while (wakeup_pipe_->Read(event, 10) > 0);
+	wakeup_event_->Clear();
 }
 
 void TaskScheduler::HandleTriggerEvent()
 {
-	do 
-	{
-		TriggerEvent callback;
-		if (trigger_events_->Pop(callback)) {
-			callback();
+	TriggerEvent callback;
+	for (int n = 0; n < kMaxTriggetEvents; n++) {
+		if (!trigger_events_->Pop(callback)) {
+			break;
 		}
-	} while (trigger_events_->Size() > 0);
+		callback();
+		callback.Reset();
+	}
 }
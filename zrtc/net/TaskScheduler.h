@@ -5,14 +5,20 @@
 #define XOP_TASK_SCHEDULER_H
 
 #include "Channel.h"
-#include "Pipe.h"
+#include "EventFd.h"
 #include "Timer.h"
-#include "RingBuffer.h"
+#include "TaskQueue.h"
+#include "MemoryManager.h"
 
 namespace xop
 {
 
-typedef std::function<void(void)> TriggerEvent;
+typedef Task TriggerEvent;
+
+// a datagram read by the scheduler itself, the data is only valid during the call
+typedef std::function<void(uint8_t* data, size_t size, const sockaddr_in& peer_addr)> DatagramCallback;
+// the errno of a datagram the scheduler failed to send
+typedef std::function<void(int error)> DatagramErrorCallback;
 
 class TaskScheduler 
 {
@@ -24,12 +30,30 @@ public:
 	void Stop();
 	TimerId AddTimer(TimerEvent timerEvent, uint32_t msec);
 	void RemoveTimer(TimerId timerId);
+
+	// returns false when the queue is full, the event is not run
 	bool AddTriggerEvent(TriggerEvent callback);
+	uint64_t GetDroppedTriggerEvents() const
+	{ return dropped_trigger_events_; }
 
 	virtual void UpdateChannel(ChannelPtr channel) { };
 	virtual void RemoveChannel(ChannelPtr& channel) { };
 	virtual bool HandleEvent(int timeout) { return false; };
 
+	// a datagram socket may be read and written by the scheduler itself instead of through a channel,
+	// returns false when the scheduler has no such path, the socket is left to the caller
+	virtual bool AddDatagramSocket(SOCKET sockfd, DatagramCallback recv_callback, DatagramErrorCallback error_callback)
+	{ return false; }
+	virtual void RemoveDatagramSocket(SOCKET sockfd) { };
+
+	// queues one message gathered from bufs on a socket added above, a UDP_SEGMENT (GSO) run
+	// of segment_size when it is not 0. it goes out with the next wait of the loop, when owners holds
+	// the buffer of each of bufs they are referenced until then, otherwise the data is copied.
+	// returns false when the caller has to send it itself: no such path, not the loop thread or no free slot
+	virtual bool SendDatagram(SOCKET sockfd, uint8_t** bufs, const size_t* sizes, size_t count,
+		const sockaddr_in& peer_addr, uint16_t segment_size, DatagramBuffer* const* owners)
+	{ return false; }
+
 	int GetId() const 
 	{ return id_; }
 
@@ -39,14 +63,15 @@ protected:
 
 	int id_ = 0;
 	std::atomic_bool is_shutdown_;
-	std::unique_ptr<Pipe> wakeup_pipe_;
+	std::atomic_bool is_sleeping_;
+	std::atomic<uint64_t> dropped_trigger_events_;
+	std::unique_ptr<EventFd> wakeup_event_;
 	std::shared_ptr<Channel> wakeup_channel_;
-	std::unique_ptr<xop::RingBuffer<TriggerEvent>> trigger_events_;
+	std::shared_ptr<Channel> timer_channel_;
+	std::unique_ptr<xop::MpscQueue<TriggerEvent>> trigger_events_;
 
-	std::mutex mutex_;
 	TimerQueue timer_queue_;
 
-	static const char kTriggetEvent = 1;
 	static const char kTimerEvent = 2;
 	static const int  kMaxTriggetEvents = 10000;
 };
@@ -1,82 +1,333 @@
 #include "Timer.h"
 #include <iostream>
+#include <cstring>
 
-#if defined(WIN32) || defined(_WIN32) 
+#if defined(WIN32) || defined(_WIN32)
 #pragma comment(lib, "winmm.lib") // mmsystem.h
 #endif
 
+#if defined(__linux) || defined(__linux__)
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
 using namespace xop;
 using namespace std;
 using namespace std::chrono;
 
+TimerQueue::TimerQueue()
+{
+	memset(wheel_, 0, sizeof(wheel_));
+	memset(level0_bitmap_, 0, sizeof(level0_bitmap_));
+	current_tick_ = GetTickNow();
+
+#if defined(__linux) || defined(__linux__)
+	timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#endif
+}
+
+TimerQueue::~TimerQueue()
+{
+#if defined(__linux) || defined(__linux__)
+	if (timer_fd_ >= 0) {
+		::close(timer_fd_);
+		timer_fd_ = -1;
+	}
+#endif
+}
+
 TimerId TimerQueue::AddTimer(const TimerEvent& event, uint32_t ms)
-{    
+{
 	std::lock_guard<std::mutex> locker(mutex_);
 
-	int64_t timeout = GetTimeNow();
+	if (ms == 0) {
+		ms = 1;
+	}
+
 	TimerId timer_id = ++last_timer_id_;
 
-	auto timer = make_shared<Timer>(event, ms);	
-	timer->SetNextTimeout(timeout);
-	timers_.emplace(timer_id, timer);
-	events_.emplace(std::pair<int64_t, TimerId>(timeout + ms, timer_id), std::move(timer));
+	std::unique_ptr<TimerNode> node(new TimerNode);
+	node->id = timer_id;
+	node->interval_ticks = (int64_t)ms * 1000 / kTickUs;
+	node->expire_tick = GetTickNow() + node->interval_ticks;
+	node->event = std::make_shared<TimerEvent>(event);
+	AddNode(node.get());
+
+	// a timer added from another thread may expire before the armed one
+	if (timer_fd_ >= 0 && (armed_tick_ < 0 || node->expire_tick < armed_tick_)) {
+		ArmTimerFd(node->expire_tick);
+	}
+
+	timers_.emplace(timer_id, std::move(node));
 	return timer_id;
 }
 
 void TimerQueue::RemoveTimer(TimerId timerId)
 {
-	std::lock_guard<std::mutex> locker(mutex_);
+	std::unique_lock<std::mutex> locker(mutex_);
+
+	// keep the guarantee that the callback is not running once this returns,
+	// unless the timer removes itself from its own callback
+	if (timerId != 0 && running_timer_id_ == timerId && running_thread_id_ != std::this_thread::get_id()) {
+		running_cond_.wait(locker, [this, timerId] { return running_timer_id_ != timerId; });
+	}
 
 	auto iter = timers_.find(timerId);
 	if (iter != timers_.end()) {
-		int64_t timeout = iter->second->getNextTimeout();
-		events_.erase(std::pair<int64_t, TimerId>(timeout, timerId));
-		timers_.erase(timerId);
+		RemoveNode(iter->second.get());
+		timers_.erase(iter);
 	}
 }
 
-int64_t TimerQueue::GetTimeNow()
-{	
-	auto time_point = steady_clock::now();	
-	return duration_cast<milliseconds>(time_point.time_since_epoch()).count();
+int64_t TimerQueue::GetTimeNowUs()
+{
+	auto time_point = steady_clock::now();
+	return duration_cast<microseconds>(time_point.time_since_epoch()).count();
+}
+
+int64_t TimerQueue::GetTickNow()
+{
+	return GetTimeNowUs() / kTickUs;
 }
 
 int64_t TimerQueue::GetTimeRemaining()
-{	
+{
 	std::lock_guard<std::mutex> locker(mutex_);
 
-	if (timers_.empty()) {
+	int64_t expire_tick = GetNextExpireTick();
+
+	if (timer_fd_ >= 0) {
+		if (expire_tick != armed_tick_) {
+			ArmTimerFd(expire_tick);
+		}
 		return -1;
 	}
 
-	int64_t msec = events_.begin()->first.first - GetTimeNow();
-	if (msec < 0) {
-		msec = 0;
+	if (expire_tick < 0) {
+		return -1;
 	}
 
-	return msec;
+	int64_t usec = expire_tick * kTickUs - GetTimeNowUs();
+	if (usec < 0) {
+		usec = 0;
+	}
+
+	return (usec + 999) / 1000;
 }
 
 void TimerQueue::HandleTimerEvent()
 {
-	if(!timers_.empty()) {
-		std::lock_guard<std::mutex> locker(mutex_);
-		int64_t time_point = GetTimeNow();
-		while(!timers_.empty() && events_.begin()->first.first <= time_point)
-		{	
-			TimerId timer_id = events_.begin()->first.second;
-			bool flag = events_.begin()->second->event_callback_();
-			if(flag == true) {
-				events_.begin()->second->SetNextTimeout(time_point);
-				auto timer = std::move(events_.begin()->second);
-				events_.erase(events_.begin());
-				events_.emplace(std::pair<int64_t, TimerId>(timer->getNextTimeout(), timer_id), timer);
+	std::unique_lock<std::mutex> locker(mutex_);
+
+	int64_t tick_now = GetTickNow();
+	if (timers_.empty()) {
+		current_tick_ = tick_now + 1;
+		return;
+	}
+
+	expired_.clear();
+
+	while (current_tick_ <= tick_now) {
+		int index = (int)(current_tick_ & (kLevel0Size - 1));
+		if (index == 0) {
+			for (int level = 1; level < kLevels; level++) {
+				int level_index = (int)((current_tick_ >> (kLevel0Bits + kLevelBits * (level - 1))) & (kLevelSize - 1));
+				Cascade(level, level_index);
+				if (level_index != 0) {
+					break;
+				}
 			}
-			else {		
-				events_.erase(events_.begin());
-				timers_.erase(timer_id);
+		}
+
+		TimerNode* node = wheel_[0][index];
+		while (node) {
+			TimerNode* next = node->next;
+			RemoveNode(node);
+			expired_.push_back(node->id);
+			node = next;
+		}
+
+		// skip the empty slots up to the next cascade or now
+		int next_index = FindLevel0Slot(index + 1);
+		int64_t next_tick = (current_tick_ & ~(int64_t)(kLevel0Size - 1)) + (next_index >= 0 ? next_index : kLevel0Size);
+		current_tick_ = next_tick < tick_now + 1 ? next_tick : tick_now + 1;
+	}
+
+	for (size_t n = 0; n < expired_.size(); n++) {
+		TimerId timer_id = expired_[n];
+		auto iter = timers_.find(timer_id);
+		if (iter == timers_.end()) {
+			continue;
+		}
+
+		std::shared_ptr<TimerEvent> event = iter->second->event;
+		running_timer_id_ = timer_id;
+		running_thread_id_ = std::this_thread::get_id();
+
+		locker.unlock();
+		bool flag = (*event)();
+		locker.lock();
+
+		running_timer_id_ = 0;
+		running_cond_.notify_all();
+
+		iter = timers_.find(timer_id);
+		if (iter == timers_.end()) {
+			continue;
+		}
+
+		if (flag == true) {
+			TimerNode* timer = iter->second.get();
+			timer->expire_tick = tick_now + timer->interval_ticks;
+			AddNode(timer);
+		}
+		else {
+			timers_.erase(iter);
+		}
+	}
+
+	expired_.clear();
+}
+
+void TimerQueue::ClearTimerFd()
+{
+#if defined(__linux) || defined(__linux__)
+	uint64_t expirations = 0;
+	ssize_t ret = ::read(timer_fd_, &expirations, sizeof(expirations));
+	(void)ret;
+#endif
+}
+
+void TimerQueue::AddNode(TimerNode* node)
+{
+	int64_t expire_tick = node->expire_tick;
+	if (expire_tick < current_tick_) {
+		expire_tick = current_tick_;
+	}
+
+	// timers beyond the wheel span wait in the last level and are placed again on cascade
+	int64_t delta = expire_tick - current_tick_;
+	if (delta >= kMaxTicks) {
+		expire_tick = current_tick_ + kMaxTicks - 1;
+		delta = kMaxTicks - 1;
+	}
+
+	int level = 0;
+	int slot = 0;
+	if (delta < kLevel0Size) {
+		slot = (int)(expire_tick & (kLevel0Size - 1));
+	}
+	else {
+		for (level = 1; level < kLevels; level++) {
+			int shift = kLevel0Bits + kLevelBits * level;
+			if (level == kLevels - 1 || delta < ((int64_t)1 << shift)) {
+				slot = (int)((expire_tick >> (shift - kLevelBits)) & (kLevelSize - 1));
+				break;
 			}
-		}	
+		}
+	}
+
+	node->level = level;
+	node->slot = slot;
+	node->prev = nullptr;
+	node->next = wheel_[level][slot];
+	if (node->next) {
+		node->next->prev = node;
+	}
+	wheel_[level][slot] = node;
+
+	if (level == 0) {
+		level0_bitmap_[slot >> 6] |= (uint64_t)1 << (slot & 63);
 	}
 }
 
+void TimerQueue::RemoveNode(TimerNode* node)
+{
+	if (node->level < 0) {
+		return;
+	}
+
+	if (node->prev) {
+		node->prev->next = node->next;
+	}
+	else {
+		wheel_[node->level][node->slot] = node->next;
+	}
+
+	if (node->next) {
+		node->next->prev = node->prev;
+	}
+
+	if (node->level == 0 && !wheel_[0][node->slot]) {
+		level0_bitmap_[node->slot >> 6] &= ~((uint64_t)1 << (node->slot & 63));
+	}
+
+	node->prev = nullptr;
+	node->next = nullptr;
+	node->level = -1;
+}
+
+void TimerQueue::Cascade(int level, int index)
+{
+	TimerNode* node = wheel_[level][index];
+	wheel_[level][index] = nullptr;
+
+	while (node) {
+		TimerNode* next = node->next;
+		node->level = -1;
+		AddNode(node);
+		node = next;
+	}
+}
+
+int TimerQueue::FindLevel0Slot(int index)
+{
+	while (index < kLevel0Size) {
+		uint64_t bits = level0_bitmap_[index >> 6] & (~(uint64_t)0 << (index & 63));
+		if (bits) {
+			int bit = 0;
+			while (!(bits & 1)) {
+				bits >>= 1;
+				bit++;
+			}
+			return (index & ~63) + bit;
+		}
+		index = (index & ~63) + 64;
+	}
+
+	return -1;
+}
+
+int64_t TimerQueue::GetNextExpireTick()
+{
+	if (timers_.empty()) {
+		return -1;
+	}
+
+	// only level 0 is exact, otherwise wake up at the next cascade
+	int64_t base_tick = current_tick_ & ~(int64_t)(kLevel0Size - 1);
+	int index = FindLevel0Slot((int)(current_tick_ & (kLevel0Size - 1)));
+	if (index >= 0) {
+		return base_tick + index;
+	}
+
+	return base_tick + kLevel0Size;
+}
+
+void TimerQueue::ArmTimerFd(int64_t expire_tick)
+{
+#if defined(__linux) || defined(__linux__)
+	struct itimerspec timeout;
+	memset(&timeout, 0, sizeof(timeout));
+	if (expire_tick >= 0) {
+		int64_t usec = expire_tick * kTickUs;
+		timeout.it_value.tv_sec = usec / 1000000;
+		timeout.it_value.tv_nsec = (usec % 1000000) * 1000;
+		if (timeout.it_value.tv_sec == 0 && timeout.it_value.tv_nsec == 0) {
+			timeout.it_value.tv_nsec = 1;
+		}
+	}
+	::timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &timeout, nullptr);
+#endif
+	armed_tick_ = expire_tick;
+}
@@ -4,14 +4,14 @@
 #ifndef _XOP_TIMER_H
 #define _XOP_TIMER_H
 
-#include <map>
 #include <unordered_map>
+#include <vector>
 #include <chrono>
 #include <functional>
 #include <cstdint>
-#include <chrono>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 
 #if defined(WIN32) || defined(_WIN32)
@@ -80,40 +80,77 @@ public:
 	}	
 
 private:
-	friend class TimerQueue;
-
-	void SetNextTimeout(int64_t time_point)
-	{
-		next_timeout_ = time_point + interval_;
-	}
-
-	int64_t getNextTimeout() const
-	{
-		return next_timeout_;
-	}
-
 	bool is_repeat_ = false;
 	TimerEvent event_callback_ = [] { return false; };
 	uint32_t interval_ = 0;
-	int64_t  next_timeout_ = 0;
 };
 
+// Hierarchical timing wheel with a 100us tick, add/remove/expire are O(1).
+// Callbacks run without the lock held, so they may add or remove timers.
+// On linux the next expiry is armed on a timerfd that wakes the event loop.
 class TimerQueue
 {
 public:
+	TimerQueue();
+	~TimerQueue();
+
 	TimerId AddTimer(const TimerEvent& event, uint32_t msec);
 	void RemoveTimer(TimerId timerId);
 
+	// returns -1 when no timer is pending or the timerfd is armed instead
 	int64_t GetTimeRemaining();
 	void HandleTimerEvent();
 
+	// -1 if the platform has no timerfd
+	int GetTimerFd() const
+	{ return timer_fd_; }
+	void ClearTimerFd();
+
 private:
-	int64_t GetTimeNow();
+	struct TimerNode
+	{
+		TimerId id = 0;
+		int64_t expire_tick = 0;
+		int64_t interval_ticks = 0;
+		std::shared_ptr<TimerEvent> event;
+		TimerNode* prev = nullptr;
+		TimerNode* next = nullptr;
+		int level = -1;
+		int slot = 0;
+	};
+
+	static int64_t GetTickNow();
+	static int64_t GetTimeNowUs();
+
+	void AddNode(TimerNode* node);
+	void RemoveNode(TimerNode* node);
+	void Cascade(int level, int index);
+	int64_t GetNextExpireTick();
+	int FindLevel0Slot(int index);
+	void ArmTimerFd(int64_t expire_tick);
+
+	static const int64_t kTickUs = 100;
+	static const int kLevels = 4;
+	static const int kLevel0Bits = 8;
+	static const int kLevelBits = 6;
+	static const int kLevel0Size = 1 << kLevel0Bits;
+	static const int kLevelSize = 1 << kLevelBits;
+	static const int64_t kMaxTicks = (int64_t)1 << (kLevel0Bits + kLevelBits * (kLevels - 1));
 
 	std::mutex mutex_;
-	std::unordered_map<TimerId, std::shared_ptr<Timer>> timers_;
-	std::map<std::pair<int64_t, TimerId>, std::shared_ptr<Timer>> events_;
+	std::condition_variable running_cond_;
+	std::unordered_map<TimerId, std::unique_ptr<TimerNode>> timers_;
+	TimerNode* wheel_[kLevels][kLevel0Size];
+	uint64_t level0_bitmap_[kLevel0Size / 64];
+	int64_t current_tick_ = 0;
 	uint32_t last_timer_id_ = 0;
+
+	std::vector<TimerId> expired_;
+	TimerId running_timer_id_ = 0;
+	std::thread::id running_thread_id_;
+
+	int timer_fd_ = -1;
+	int64_t armed_tick_ = -1;
 };
 
 }
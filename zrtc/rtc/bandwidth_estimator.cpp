@@ -0,0 +1,377 @@
+#include "bandwidth_estimator.h"
+#include "rtc_common.h"
+#include <chrono>
+#include <cmath>
+
+static const uint32_t kHistorySize = 4096;
+static const int64_t  kGroupTimeUs = 5000;
+static const int64_t  kAckedWindowUs = 500000;
+
+static const size_t   kTrendlineWindowSize = 20;
+static const double   kTrendlineSmoothing = 0.9;
+static const double   kTrendlineGain = 4.0;
+static const double   kOverusingTimeMs = 10.0;
+static const double   kThresholdUp = 0.0087;
+static const double   kThresholdDown = 0.039;
+
+static const double   kBetaDecrease = 0.85;
+static const double   kResponseTimeMs = 200.0;
+static const double   kPacketSizeBits = 1200 * 8;
+
+static const uint32_t kLossMinPackets = 20;
+static const int64_t  kLossIncreaseIntervalUs = 1000000;
+static const int64_t  kLossDecreaseIntervalUs = 300000;
+
+BandwidthEstimator::BandwidthEstimator()
+	: history_(kHistorySize)
+{
+	SetBitrates(RTC_BWE_MIN_BITRATE, RTC_BWE_START_BITRATE, RTC_BWE_MAX_BITRATE);
+}
+
+BandwidthEstimator::~BandwidthEstimator()
+{
+
+}
+
+int64_t BandwidthEstimator::GetTimeNowUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void BandwidthEstimator::SetBitrates(uint32_t min_bitrate_bps, uint32_t start_bitrate_bps, uint32_t max_bitrate_bps)
+{
+	min_bitrate_ = min_bitrate_bps;
+	max_bitrate_ = max_bitrate_bps > min_bitrate_bps ? max_bitrate_bps : min_bitrate_bps;
+
+	uint32_t bitrate = start_bitrate_bps;
+	if (bitrate < min_bitrate_) {
+		bitrate = min_bitrate_;
+	}
+	if (bitrate > max_bitrate_) {
+		bitrate = max_bitrate_;
+	}
+
+	delay_based_bitrate_ = bitrate;
+	loss_based_bitrate_ = bitrate;
+	target_bitrate_ = bitrate;
+}
+
+void BandwidthEstimator::OnPacketSent(uint16_t transport_seq, uint32_t size)
+{
+	SentPacket& sent_pkt = history_[transport_seq % kHistorySize];
+	sent_pkt.sequence = transport_seq;
+	sent_pkt.is_valid = true;
+	sent_pkt.send_time_us = GetTimeNowUs();
+	sent_pkt.size = size;
+}
+
+bool BandwidthEstimator::OnTransportFeedback(const std::vector<TransportFeedbackPacket>& feedback)
+{
+	int64_t now_us = GetTimeNowUs();
+	uint32_t lost_packets = 0;
+	uint32_t total_packets = 0;
+
+	for (auto& fb : feedback) {
+		SentPacket& sent_pkt = history_[fb.sequence % kHistorySize];
+		if (!sent_pkt.is_valid || sent_pkt.sequence != fb.sequence) {
+			continue;
+		}
+
+		total_packets++;
+		if (!fb.received) {
+			// may still be reported by a later feedback
+			lost_packets++;
+			continue;
+		}
+		sent_pkt.is_valid = false;
+
+		UpdateAckedBitrate(fb.recv_time_us, sent_pkt.size);
+
+		// packets sent within kGroupTimeUs form one group, the delay variation is measured between groups
+		if (!current_group_.is_valid) {
+			current_group_.is_valid = true;
+			current_group_.first_send_time_us = sent_pkt.send_time_us;
+			current_group_.last_send_time_us = sent_pkt.send_time_us;
+			current_group_.last_arrival_time_us = fb.recv_time_us;
+		}
+		else if (sent_pkt.send_time_us - current_group_.first_send_time_us > kGroupTimeUs) {
+			if (prev_group_.is_valid) {
+				int64_t send_delta_us = current_group_.last_send_time_us - prev_group_.last_send_time_us;
+				int64_t arrival_delta_us = current_group_.last_arrival_time_us - prev_group_.last_arrival_time_us;
+				UpdateTrendline((arrival_delta_us - send_delta_us) / 1000.0, send_delta_us / 1000.0,
+					current_group_.last_arrival_time_us);
+			}
+
+			prev_group_ = current_group_;
+			current_group_.first_send_time_us = sent_pkt.send_time_us;
+			current_group_.last_send_time_us = sent_pkt.send_time_us;
+			current_group_.last_arrival_time_us = fb.recv_time_us;
+		}
+		else {
+			if (sent_pkt.send_time_us > current_group_.last_send_time_us) {
+				current_group_.last_send_time_us = sent_pkt.send_time_us;
+			}
+			if (fb.recv_time_us > current_group_.last_arrival_time_us) {
+				current_group_.last_arrival_time_us = fb.recv_time_us;
+			}
+		}
+	}
+
+	if (total_packets == 0) {
+		return false;
+	}
+
+	UpdateDelayBasedBitrate(now_us);
+	UpdateLossBasedBitrate(lost_packets, total_packets, now_us);
+
+	uint32_t target_bitrate = delay_based_bitrate_ < loss_based_bitrate_ ? delay_based_bitrate_ : loss_based_bitrate_;
+	if (target_bitrate == target_bitrate_) {
+		return false;
+	}
+
+	target_bitrate_ = target_bitrate;
+	return true;
+}
+
+uint32_t BandwidthEstimator::GetTargetBitrate()
+{
+	return target_bitrate_;
+}
+
+uint32_t BandwidthEstimator::GetAckedBitrate()
+{
+	return acked_bitrate_;
+}
+
+void BandwidthEstimator::UpdateAckedBitrate(int64_t arrival_time_us, uint32_t size)
+{
+	acked_packets_.emplace_back(arrival_time_us, size);
+	acked_bytes_ += size;
+
+	int64_t window_us = arrival_time_us - acked_packets_.front().first;
+	while (!acked_packets_.empty() && arrival_time_us - acked_packets_.front().first > kAckedWindowUs) {
+		acked_bytes_ -= acked_packets_.front().second;
+		acked_packets_.pop_front();
+		window_us = kAckedWindowUs;
+	}
+
+	// wait for a full window before the first estimate
+	if (window_us >= kAckedWindowUs) {
+		acked_bitrate_ = static_cast<uint32_t>(acked_bytes_ * 8 * 1000000 / kAckedWindowUs);
+	}
+}
+
+void BandwidthEstimator::UpdateTrendline(double delay_variation_ms, double send_delta_ms, int64_t arrival_time_us)
+{
+	if (first_arrival_time_us_ < 0) {
+		first_arrival_time_us_ = arrival_time_us;
+	}
+
+	if (num_deltas_ < 1000) {
+		num_deltas_++;
+	}
+
+	accumulated_delay_ms_ += delay_variation_ms;
+	smoothed_delay_ms_ = kTrendlineSmoothing * smoothed_delay_ms_ + (1 - kTrendlineSmoothing) * accumulated_delay_ms_;
+	delay_history_.emplace_back((arrival_time_us - first_arrival_time_us_) / 1000.0, smoothed_delay_ms_);
+	if (delay_history_.size() > kTrendlineWindowSize) {
+		delay_history_.pop_front();
+	}
+
+	if (delay_history_.size() < kTrendlineWindowSize) {
+		return;
+	}
+
+	// slope of the smoothed delay over the window, least squares
+	double sum_x = 0, sum_y = 0;
+	for (auto& point : delay_history_) {
+		sum_x += point.first;
+		sum_y += point.second;
+	}
+	double avg_x = sum_x / delay_history_.size();
+	double avg_y = sum_y / delay_history_.size();
+	double numerator = 0, denominator = 0;
+	for (auto& point : delay_history_) {
+		numerator += (point.first - avg_x) * (point.second - avg_y);
+		denominator += (point.first - avg_x) * (point.first - avg_x);
+	}
+	double trend = denominator != 0 ? numerator / denominator : prev_trend_;
+
+	// overuse detector with an adaptive threshold
+	int64_t now_us = GetTimeNowUs();
+	double modified_trend = (num_deltas_ < 60 ? num_deltas_ : 60) * trend * kTrendlineGain;
+	if (modified_trend > threshold_) {
+		if (time_over_using_ms_ < 0) {
+			time_over_using_ms_ = send_delta_ms / 2;
+		}
+		else {
+			time_over_using_ms_ += send_delta_ms;
+		}
+		overuse_counter_++;
+
+		if (time_over_using_ms_ > kOverusingTimeMs && overuse_counter_ > 1 && trend >= prev_trend_) {
+			time_over_using_ms_ = 0;
+			overuse_counter_ = 0;
+			usage_ = BW_OVERUSING;
+		}
+	}
+	else if (modified_trend < -threshold_) {
+		time_over_using_ms_ = -1;
+		overuse_counter_ = 0;
+		usage_ = BW_UNDERUSING;
+	}
+	else {
+		time_over_using_ms_ = -1;
+		overuse_counter_ = 0;
+		usage_ = BW_NORMAL;
+	}
+
+	prev_trend_ = trend;
+	UpdateThreshold(modified_trend, now_us);
+}
+
+void BandwidthEstimator::UpdateThreshold(double modified_trend, int64_t now_us)
+{
+	if (last_threshold_update_us_ < 0) {
+		last_threshold_update_us_ = now_us;
+	}
+
+	// a single spike must not move the threshold
+	double abs_trend = std::fabs(modified_trend);
+	if (abs_trend > threshold_ + 15.0) {
+		last_threshold_update_us_ = now_us;
+		return;
+	}
+
+	double k = abs_trend < threshold_ ? kThresholdDown : kThresholdUp;
+	double time_delta_ms = (now_us - last_threshold_update_us_) / 1000.0;
+	if (time_delta_ms > 100.0) {
+		time_delta_ms = 100.0;
+	}
+
+	threshold_ += k * (abs_trend - threshold_) * time_delta_ms;
+	if (threshold_ < 6.0) {
+		threshold_ = 6.0;
+	}
+	if (threshold_ > 600.0) {
+		threshold_ = 600.0;
+	}
+	last_threshold_update_us_ = now_us;
+}
+
+void BandwidthEstimator::UpdateDelayBasedBitrate(int64_t now_us)
+{
+	if (last_rate_change_us_ < 0) {
+		last_rate_change_us_ = now_us;
+	}
+
+	switch (usage_)
+	{
+	case BW_OVERUSING:
+		rate_control_state_ = RC_DECREASE;
+		break;
+	case BW_UNDERUSING:
+		rate_control_state_ = RC_HOLD;
+		break;
+	case BW_NORMAL:
+		if (rate_control_state_ == RC_HOLD) {
+			rate_control_state_ = RC_INCREASE;
+		}
+		break;
+	default:
+		break;
+	}
+
+	double bitrate = delay_based_bitrate_;
+	double elapsed_ms = (now_us - last_rate_change_us_) / 1000.0;
+	if (elapsed_ms > 1000.0) {
+		elapsed_ms = 1000.0;
+	}
+
+	switch (rate_control_state_)
+	{
+	case RC_INCREASE:
+		// do not run away from what the receiver actually gets
+		if (acked_bitrate_ > 0 && bitrate > 1.5 * acked_bitrate_ + 10000) {
+			break;
+		}
+
+		if (link_capacity_bps_ > 0 && bitrate > link_capacity_bps_ * 0.9) {
+			// close to the last known capacity, about one packet per response time
+			bitrate += kPacketSizeBits * (1000.0 / kResponseTimeMs) * elapsed_ms / 1000.0;
+		}
+		else {
+			bitrate *= std::pow(1.08, elapsed_ms / 1000.0);
+		}
+		break;
+	case RC_DECREASE:
+		// the overuse stays signaled until the next trend, reduce once per response time
+		if (last_decrease_us_ >= 0 && now_us - last_decrease_us_ < kResponseTimeMs * 1000) {
+			break;
+		}
+		last_decrease_us_ = now_us;
+
+		if (acked_bitrate_ > 0) {
+			double decreased_bitrate = kBetaDecrease * acked_bitrate_;
+			if (decreased_bitrate < bitrate) {
+				bitrate = decreased_bitrate;
+			}
+			link_capacity_bps_ = link_capacity_bps_ > 0 ? 0.95 * link_capacity_bps_ + 0.05 * acked_bitrate_ : acked_bitrate_;
+		}
+		else {
+			bitrate *= kBetaDecrease;
+		}
+		rate_control_state_ = RC_HOLD;
+		break;
+	default:
+		break;
+	}
+
+	if (bitrate < min_bitrate_) {
+		bitrate = min_bitrate_;
+	}
+	if (bitrate > max_bitrate_) {
+		bitrate = max_bitrate_;
+	}
+
+	delay_based_bitrate_ = static_cast<uint32_t>(bitrate);
+	last_rate_change_us_ = now_us;
+}
+
+void BandwidthEstimator::UpdateLossBasedBitrate(uint32_t lost_packets, uint32_t total_packets, int64_t now_us)
+{
+	lost_packets_ += lost_packets;
+	total_packets_ += total_packets;
+	if (total_packets_ < kLossMinPackets) {
+		return;
+	}
+
+	double loss = static_cast<double>(lost_packets_) / total_packets_;
+	lost_packets_ = 0;
+	total_packets_ = 0;
+
+	// start from the current target, so the loss based bitrate never runs far above the delay based one
+	double bitrate = loss_based_bitrate_;
+	if (loss <= 0.02) {
+		if (last_loss_increase_us_ < 0 || now_us - last_loss_increase_us_ >= kLossIncreaseIntervalUs) {
+			bitrate = target_bitrate_ * 1.08 + 1000;
+			last_loss_increase_us_ = now_us;
+		}
+	}
+	else if (loss > 0.1) {
+		if (last_loss_decrease_us_ < 0 || now_us - last_loss_decrease_us_ >= kLossDecreaseIntervalUs) {
+			bitrate = target_bitrate_ * (1 - 0.5 * loss);
+			last_loss_decrease_us_ = now_us;
+		}
+	}
+
+	if (bitrate < min_bitrate_) {
+		bitrate = min_bitrate_;
+	}
+	if (bitrate > max_bitrate_) {
+		bitrate = max_bitrate_;
+	}
+
+	loss_based_bitrate_ = static_cast<uint32_t>(bitrate);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "rtcp_sink.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Send-side bandwidth estimation in the spirit of GCC (draft-ietf-rmcat-gcc).
+// A trendline filter over the inter-group delay variation feeds an overuse
+// detector that drives an AIMD controller, the loss reported by the same
+// transport feedback caps the result.
+class BandwidthEstimator
+{
+public:
+	BandwidthEstimator();
+	virtual ~BandwidthEstimator();
+
+	void SetBitrates(uint32_t min_bitrate_bps, uint32_t start_bitrate_bps, uint32_t max_bitrate_bps);
+
+	void OnPacketSent(uint16_t transport_seq, uint32_t size);
+
+	// returns true when the target bitrate changed
+	bool OnTransportFeedback(const std::vector<TransportFeedbackPacket>& feedback);
+
+	uint32_t GetTargetBitrate();
+	uint32_t GetAckedBitrate();
+
+private:
+	enum BandwidthUsage
+	{
+		BW_NORMAL,
+		BW_UNDERUSING,
+		BW_OVERUSING,
+	};
+
+	enum RateControlState
+	{
+		RC_HOLD,
+		RC_INCREASE,
+		RC_DECREASE,
+	};
+
+	struct SentPacket
+	{
+		uint16_t sequence = 0;
+		bool     is_valid = false;
+		int64_t  send_time_us = 0;
+		uint32_t size = 0;
+	};
+
+	struct PacketGroup
+	{
+		bool     is_valid = false;
+		int64_t  first_send_time_us = 0;
+		int64_t  last_send_time_us = 0;
+		int64_t  last_arrival_time_us = 0;
+	};
+
+	static int64_t GetTimeNowUs();
+
+	void UpdateAckedBitrate(int64_t arrival_time_us, uint32_t size);
+	void UpdateTrendline(double delay_variation_ms, double send_delta_ms, int64_t arrival_time_us);
+	void UpdateThreshold(double modified_trend, int64_t now_us);
+	void UpdateDelayBasedBitrate(int64_t now_us);
+	void UpdateLossBasedBitrate(uint32_t lost_packets, uint32_t total_packets, int64_t now_us);
+
+	uint32_t min_bitrate_ = 0;
+	uint32_t max_bitrate_ = 0;
+	uint32_t target_bitrate_ = 0;
+
+	std::vector<SentPacket> history_;
+
+	// acked bitrate over a window of receive times
+	std::deque<std::pair<int64_t, uint32_t>> acked_packets_;
+	uint64_t acked_bytes_ = 0;
+	uint32_t acked_bitrate_ = 0;
+
+	// trendline filter and overuse detector
+	PacketGroup current_group_;
+	PacketGroup prev_group_;
+	std::deque<std::pair<double, double>> delay_history_;
+	int64_t first_arrival_time_us_ = -1;
+	double accumulated_delay_ms_ = 0;
+	double smoothed_delay_ms_ = 0;
+	double prev_trend_ = 0;
+	double threshold_ = 12.5;
+	int64_t last_threshold_update_us_ = -1;
+	double time_over_using_ms_ = -1;
+	uint32_t overuse_counter_ = 0;
+	uint32_t num_deltas_ = 0;
+	BandwidthUsage usage_ = BW_NORMAL;
+
+	// aimd
+	RateControlState rate_control_state_ = RC_HOLD;
+	uint32_t delay_based_bitrate_ = 0;
+	double link_capacity_bps_ = 0;
+	int64_t last_rate_change_us_ = -1;
+	int64_t last_decrease_us_ = -1;
+
+	// loss based
+	uint32_t loss_based_bitrate_ = 0;
+	uint32_t lost_packets_ = 0;
+	uint32_t total_packets_ = 0;
+	int64_t last_loss_increase_us_ = -1;
+	int64_t last_loss_decrease_us_ = -1;
+};
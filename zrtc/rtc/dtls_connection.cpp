@@ -1,6 +1,11 @@
 #include "dtls_connection.h"
 #include "rtc_utils.h"
 #include "rtc_log.h"
+#include "srtp_session.h"
+
+// aes-gcm first, one aes-ni/pclmul pass per packet instead of aes-ctr and a separate hmac-sha1
+static const char* kSrtpProfiles = "SRTP_AES128_CM_SHA1_80";
+static const char* kSrtpGcmProfiles = "SRTP_AEAD_AES_128_GCM:SRTP_AEAD_AES_256_GCM:SRTP_AES128_CM_SHA1_80";
 
 DtlsCert::DtlsCert()
 {
@@ -174,6 +179,11 @@ std::string DtlsConnection::GetSrtpRecvKey()
 	return recv_key_;
 }
 
+RtcSrtpProfile DtlsConnection::GetSrtpProfile()
+{
+	return srtp_profile_;
+}
+
 static int ssl_verify_callback(int ok, X509_STORE_CTX* ctx)
 {
 	return 1;
@@ -249,7 +259,7 @@ bool DtlsConnection::InitSSL()
 	SSL_set_ex_data(ssl_, 0, this);
 	SSL_CTX_set_info_callback(ssl_ctx_, ssl_info_callback);
 
-	ret = SSL_CTX_set_tlsext_use_srtp(ssl_ctx_, "SRTP_AES128_CM_SHA1_80");
+	ret = SSL_CTX_set_tlsext_use_srtp(ssl_ctx_, SrtpSession::IsGcmSupported() ? kSrtpGcmProfiles : kSrtpProfiles);
 	if (ret != 0) {
 		RTC_LOG_ERROR("SSL_CTX_set_tlsext_use_srtp failed.");
 		goto failed;
@@ -325,22 +335,38 @@ void DtlsConnection::OnHandshakeDone()
 	RTC_LOG_INFO("ssl handshake done, role:{}", (int)role_);
 	is_handshake_done_ = true;
 
-	uint8_t out[(RTC_SRTP_KEY_LEN + RTC_SRTP_SALT_LEN) * 2] = { 0 };
+	const SRTP_PROTECTION_PROFILE* srtp_profile = SSL_get_selected_srtp_profile(ssl_);
+	if (srtp_profile == nullptr) {
+		RTC_LOG_ERROR("SSL_get_selected_srtp_profile failed.");
+		return;
+	}
+
+	srtp_profile_ = static_cast<RtcSrtpProfile>(srtp_profile->id);
+	uint32_t key_len = SrtpSession::GetKeyLength(srtp_profile_);
+	uint32_t salt_len = SrtpSession::GetSaltLength(srtp_profile_);
+	if (key_len == 0) {
+		RTC_LOG_ERROR("srtp profile not supported:{}", srtp_profile->name);
+		return;
+	}
+	RTC_LOG_INFO("srtp profile:{}", srtp_profile->name);
+
+	// client key, server key, client salt, server salt
+	uint8_t out[(RTC_SRTP_AES256_KEY_LEN + RTC_SRTP_SALT_LEN) * 2] = { 0 };
 	const char* label = "EXTRACTOR-dtls_srtp";
-	int ret = SSL_export_keying_material(ssl_, out, sizeof(out), label, strlen(label), NULL, 0, 0);
+	int ret = SSL_export_keying_material(ssl_, out, (key_len + salt_len) * 2, label, strlen(label), NULL, 0, 0);
 	if (ret == 0) {
 		RTC_LOG_ERROR("SSL_export_keying_material failed.");
 		return;
 	}
 
 	size_t offset = 0;
-	std::string client_key(reinterpret_cast<char*>(out), RTC_SRTP_KEY_LEN);
-	offset += RTC_SRTP_KEY_LEN;
-	std::string server_key(reinterpret_cast<char*>(out + offset), RTC_SRTP_KEY_LEN);
-	offset += RTC_SRTP_KEY_LEN;
-	std::string client_salt(reinterpret_cast<char*>(out + offset), RTC_SRTP_SALT_LEN);
-	offset += RTC_SRTP_SALT_LEN;
-	std::string server_salt(reinterpret_cast<char*>(out + offset), RTC_SRTP_SALT_LEN);
+	std::string client_key(reinterpret_cast<char*>(out), key_len);
+	offset += key_len;
+	std::string server_key(reinterpret_cast<char*>(out + offset), key_len);
+	offset += key_len;
+	std::string client_salt(reinterpret_cast<char*>(out + offset), salt_len);
+	offset += salt_len;
+	std::string server_salt(reinterpret_cast<char*>(out + offset), salt_len);
 
 	if (role_ == RTC_ROLE_SERVER) {
 		recv_key_ = client_key + client_salt;
@@ -44,6 +44,7 @@ public:
 	std::string GetFingerprint();
 	std::string GetSrtpSendKey();
 	std::string GetSrtpRecvKey();
+	RtcSrtpProfile GetSrtpProfile();
 
 	void Listen();
 	std::vector<uint8_t> Connect();
@@ -66,4 +67,5 @@ private:
 	bool is_handshake_done_ = false;
 	std::string send_key_;
 	std::string recv_key_;
+	RtcSrtpProfile srtp_profile_ = RTC_SRTP_PROFILE_NONE;
 };
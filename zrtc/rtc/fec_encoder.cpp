@@ -1,11 +1,80 @@
 #include "fec_encoder.h"
+#include "fec_xor.h"
+#include <cstring>
+
+// base header up to the ssrc count, reserved bits, protected ssrc and sequence number base
+static const uint32_t kFlexfecHeaderSize = 18;
+static const uint32_t kMaxMaskBits = 64;
+
+// random loss is best met by small groups, interleaving needs long ones
+static const uint32_t kMaxRandomGroupPackets = 16;
+static const uint32_t kMaxBurstyGroupPackets = 48;
+static const uint32_t kBurstyLossThreshold = 50;
+
+// a retransmission on a long rtt may miss the frame, lean on fec
+static const uint32_t kHighRtt = 100;
+
+// share of a frame's first group covered by the extra fec packets
+static const uint32_t kImportantPacketsDivisor = 4;
+
+static const FecXorFunc XorPayload = GetFecXorKernel().xor_func;
+
+// k-bit then the mask msb first, in 15, 15+31 or 15+31+63 bits
+static uint32_t GetPacketMaskSize(uint32_t max_offset)
+{
+	if (max_offset < 15) {
+		return 2;
+	}
+	else if (max_offset < 46) {
+		return 6;
+	}
+	return 14;
+}
+
+static void WritePacketMask(uint8_t* data, uint64_t mask, uint32_t mask_size)
+{
+	uint16_t part0 = 0;
+	for (uint32_t offset = 0; offset < 15; offset++) {
+		if (mask & (1ULL << offset)) {
+			part0 |= 1 << (14 - offset);
+		}
+	}
+
+	if (mask_size == 2) {
+		WriteUint16BE(data, part0 | 0x8000);
+		return;
+	}
+	WriteUint16BE(data, part0);
+
+	uint32_t part1 = 0;
+	for (uint32_t offset = 15; offset < 46; offset++) {
+		if (mask & (1ULL << offset)) {
+			part1 |= 1U << (30 - (offset - 15));
+		}
+	}
+
+	if (mask_size == 6) {
+		WriteUint32BE(data + 2, part1 | 0x80000000);
+		return;
+	}
+	WriteUint32BE(data + 2, part1);
+
+	uint64_t part2 = 1ULL << 63;
+	for (uint32_t offset = 46; offset < kMaxMaskBits; offset++) {
+		if (mask & (1ULL << offset)) {
+			part2 |= 1ULL << (62 - (offset - 46));
+		}
+	}
+	WriteUint32BE(data + 6, static_cast<uint32_t>(part2 >> 32));
+	WriteUint32BE(data + 10, static_cast<uint32_t>(part2));
+}
 
 FecEncoder::FecEncoder(uint32_t media_ssrc, uint32_t fec_ssrc, uint32_t fec_payload_type)
 	: media_ssrc_(media_ssrc)
 	, fec_ssrc_(fec_ssrc)
 	, fec_payload_type_(fec_payload_type)
 {
-	fec_ = webrtc::ForwardErrorCorrection::CreateFlexfec(fec_ssrc, media_ssrc);
+	media_packets_.reserve(kMaxMediaPackets);
 }
 
 FecEncoder::~FecEncoder()
@@ -13,45 +82,219 @@ FecEncoder::~FecEncoder()
 
 }
 
-void FecEncoder::UpdateLossRate(uint32_t loss_rate)
+void FecEncoder::UpdateNetworkState(uint32_t loss_rate, uint32_t loss_burst, uint32_t rtt)
 {
 	float alpha = 0.1f;
 	loss_rate_ = loss_rate;
 	smoothed_loss_rate_ = static_cast<uint32_t>(alpha * loss_rate + (1 - alpha) * smoothed_loss_rate_);
+	loss_burst_ = loss_burst;
+	rtt_ = rtt;
+	mask_type_ = loss_burst_ >= kBurstyLossThreshold ? FEC_MASK_BURSTY : FEC_MASK_RANDOM;
 }
 
-void FecEncoder::AddRtpPacket(std::shared_ptr<RtpPacket> rtp_packet)
+uint32_t FecEncoder::GetProtectionFactor(bool is_keyframe)
 {
-	// 单帧最大支持的包数, 超过则不生成冗余
-	if (media_packets_.size() < webrtc::kUlpfecMaxMediaPackets) {
-		auto fec_packet = std::make_unique<webrtc::ForwardErrorCorrection::Packet>();
-		rtc::CopyOnWriteBuffer packet(rtp_packet->data.get(), rtp_packet->data_size);
-		fec_packet->data = std::move(packet);
-		media_packets_.push_back(std::move(fec_packet));
+	// q8, 255: one fec packet per media packet
+	uint32_t protection_factor = smoothed_loss_rate_ * 255 / 100;
+	if (rtt_ >= kHighRtt) {
+		protection_factor = protection_factor * 3 / 2;
+	}
+
+	// a lost key frame costs a new one, and every viewer waits for it
+	if (is_keyframe) {
+		protection_factor *= 2;
+	}
+
+	return protection_factor < 255 ? protection_factor : 255;
+}
+
+void FecEncoder::EncodeFrame(const std::vector<RtpPacketPtr>& media_packets, bool is_keyframe,
+	uint32_t header_size, std::vector<RtpPacketPtr>& fec_packets)
+{
+	uint32_t protection_factor = GetProtectionFactor(is_keyframe);
+	if (protection_factor == 0 || media_packets.empty()) {
+		return;
+	}
+
+	// 不支持跨帧打冗余, a large frame is split into groups of similar size
+	uint32_t max_group_packets = mask_type_ == FEC_MASK_BURSTY ? kMaxBurstyGroupPackets : kMaxRandomGroupPackets;
+	uint32_t num_packets = static_cast<uint32_t>(media_packets.size());
+	uint32_t num_groups = (num_packets + max_group_packets - 1) / max_group_packets;
+	uint32_t group_packets = (num_packets + num_groups - 1) / num_groups;
+
+	auto iter = media_packets.begin();
+	for (uint32_t group = 0; group < num_groups; group++) {
+		media_packets_.clear();
+		while (iter != media_packets.end() && media_packets_.size() < group_packets) {
+			if ((*iter)->data_size > RTP_HEADER_SIZE) {
+				media_packets_.push_back(*iter);
+			}
+			++iter;
+		}
+
+		if (media_packets_.empty()) {
+			continue;
+		}
+
+		// same count as webrtc for a protection factor in q8
+		uint32_t num_media_packets = static_cast<uint32_t>(media_packets_.size());
+		uint32_t num_fec_packets = (num_media_packets * protection_factor + (1 << 7)) >> 8;
+		if (num_fec_packets == 0) {
+			num_fec_packets = 1;
+		}
+
+		// the start of a frame carries the slice header, and the sps and pps of a key frame
+		uint32_t num_important_packets = 0;
+		if (group == 0) {
+			num_important_packets = num_media_packets / kImportantPacketsDivisor;
+			num_important_packets = num_important_packets > 0 ? num_important_packets : 1;
+		}
+
+		EncodeFec(num_fec_packets, num_important_packets, header_size, fec_packets);
 	}
 
-	const size_t min_media_packets = 8;
-	const int num_important_packets = 0;
-	const bool use_unequal_protection = false;
-	const bool complete_frame = rtp_packet->marker == 1 ? true : false;
+	media_packets_.clear();
+}
+
+void FecEncoder::FillMasks(uint32_t first_row, uint32_t num_rows, uint32_t num_media_packets)
+{
+	// interleaved, as webrtc builds its masks above 12 media packets,
+	// a burst of up to num_rows losses hits as many fec packets
+	if (mask_type_ == FEC_MASK_BURSTY) {
+		for (uint32_t n = 0; n < num_media_packets; n++) {
+			packet_masks_[first_row + n % num_rows] |= 1ULL << n;
+		}
+		return;
+	}
 
-	// 不支持跨帧打冗余
-	if (complete_frame || media_packets_.size() >= min_media_packets) {
-		uint8_t protection_factor = smoothed_loss_rate_ * 255 / 100;
-		fec_->EncodeFec(media_packets_, protection_factor, num_important_packets,
-			use_unequal_protection, webrtc::FecMaskType::kFecMaskRandom, &fec_packets_);
+	// each media packet gets its own nonzero column, lowest weight first, so two losses
+	// differ in some fec packet and both are recovered while the group has less than
+	// 2^num_rows packets, the columns repeat in larger groups
+	uint32_t n = 0;
+	while (n < num_media_packets) {
+		for (uint32_t weight = 1; weight <= num_rows && n < num_media_packets; weight++) {
+			uint64_t column = (1ULL << weight) - 1;
+			while (column < (1ULL << num_rows) && n < num_media_packets) {
+				for (uint32_t row = 0; row < num_rows; row++) {
+					if (column & (1ULL << row)) {
+						packet_masks_[first_row + row] |= 1ULL << n;
+					}
+				}
+				n++;
 
-		if (fec_packets_.empty()) {
-			media_packets_.clear();
+				// next column with the same weight
+				uint64_t lowest_bit = column & (~column + 1);
+				uint64_t ripple = column + lowest_bit;
+				column = (((ripple ^ column) >> 2) / lowest_bit) | ripple;
+			}
 		}
 	}
 }
 
-void FecEncoder::GetFecPackets(std::list<webrtc::ForwardErrorCorrection::Packet*>& fec_packets)
+void FecEncoder::GenerateMasks(uint32_t num_media_packets, uint32_t num_fec_packets, uint32_t num_important_packets)
 {
-	fec_packets.swap(fec_packets_);
-	if (!fec_packets.empty()) {
-		fec_packets_.clear();
-		media_packets_.clear();
+	memset(packet_masks_, 0, sizeof(packet_masks_));
+
+	if (num_fec_packets < 2 || num_important_packets == 0 || num_important_packets >= num_media_packets) {
+		FillMasks(0, num_fec_packets, num_media_packets);
+		return;
+	}
+
+	// unequal protection: a third of the fec packets cover only the important packets,
+	// the others cover the whole group, important ones included
+	uint32_t num_important_rows = (num_fec_packets + 2) / 3;
+	if (num_important_rows > num_important_packets) {
+		num_important_rows = num_important_packets;
+	}
+
+	FillMasks(0, num_important_rows, num_important_packets);
+	FillMasks(num_important_rows, num_fec_packets - num_important_rows, num_media_packets);
+}
+
+bool FecEncoder::EncodeFec(uint32_t num_fec_packets, uint32_t num_important_packets,
+	uint32_t header_size, std::vector<RtpPacketPtr>& fec_packets)
+{
+	uint32_t num_media_packets = static_cast<uint32_t>(media_packets_.size());
+	if (num_media_packets == 0 || num_fec_packets == 0) {
+		return false;
 	}
+
+	if (num_fec_packets > num_media_packets) {
+		num_fec_packets = num_media_packets;
+	}
+
+	// the mask follows the sequence numbers, a gap keeps its bit clear
+	uint8_t* first_packet = media_packets_[0]->data;
+	uint16_t seq_base = ReadU16BE(first_packet + 2, 2);
+	uint32_t protected_ssrc = ReadU32BE(first_packet + 8, 4);
+	uint32_t seq_offsets[kMaxMediaPackets];
+	for (uint32_t n = 0; n < num_media_packets; n++) {
+		seq_offsets[n] = static_cast<uint16_t>(ReadU16BE(media_packets_[n]->data + 2, 2) - seq_base);
+		if (seq_offsets[n] >= kMaxMaskBits) {
+			return false;
+		}
+	}
+
+	GenerateMasks(num_media_packets, num_fec_packets, num_important_packets);
+
+	for (uint32_t row = 0; row < num_fec_packets; row++) {
+		uint64_t offset_mask = 0;
+		uint32_t max_offset = 0;
+		size_t max_payload_size = 0;
+		for (uint32_t n = 0; n < num_media_packets; n++) {
+			if (packet_masks_[row] & (1ULL << n)) {
+				offset_mask |= 1ULL << seq_offsets[n];
+				max_offset = seq_offsets[n] > max_offset ? seq_offsets[n] : max_offset;
+				size_t payload_size = media_packets_[n]->data_size - RTP_HEADER_SIZE;
+				max_payload_size = payload_size > max_payload_size ? payload_size : max_payload_size;
+			}
+		}
+
+		if (offset_mask == 0) {
+			continue;
+		}
+
+		uint32_t mask_size = GetPacketMaskSize(max_offset);
+		uint32_t fec_header_size = kFlexfecHeaderSize + mask_size;
+		size_t fec_packet_size = header_size + fec_header_size + max_payload_size;
+		if (fec_packet_size + SRTP_MAX_TRAILER_LEN > RtpPacket::kCapacity) {
+			continue;
+		}
+
+		// the pooled buffer is not zeroed, xor starts from zero
+		auto fec_packet = RtpPacket::Create();
+		uint8_t* fec_header = fec_packet->data + header_size;
+		memset(fec_header, 0, fec_header_size + max_payload_size);
+
+		for (uint32_t n = 0; n < num_media_packets; n++) {
+			if (!(packet_masks_[row] & (1ULL << n))) {
+				continue;
+			}
+
+			// p, x, cc, m, pt, length and timestamp recovery, then everything after the fixed header
+			const uint8_t* media_data = media_packets_[n]->data;
+			uint32_t payload_size = media_packets_[n]->data_size - RTP_HEADER_SIZE;
+			fec_header[0] ^= media_data[0];
+			fec_header[1] ^= media_data[1];
+			fec_header[2] ^= static_cast<uint8_t>(payload_size >> 8);
+			fec_header[3] ^= static_cast<uint8_t>(payload_size);
+			fec_header[4] ^= media_data[4];
+			fec_header[5] ^= media_data[5];
+			fec_header[6] ^= media_data[6];
+			fec_header[7] ^= media_data[7];
+			XorPayload(fec_header + fec_header_size, media_data + RTP_HEADER_SIZE, payload_size);
+		}
+
+		// clear the r and f bits, one protected ssrc
+		fec_header[0] &= 0x3f;
+		fec_header[8] = 1;
+		WriteUint32BE(&fec_header[12], protected_ssrc);
+		WriteUint16BE(&fec_header[16], seq_base);
+		WritePacketMask(&fec_header[kFlexfecHeaderSize], offset_mask, mask_size);
+
+		fec_packet->data_size = static_cast<uint32_t>(fec_packet_size);
+		fec_packets.push_back(fec_packet);
+	}
+
+	return true;
 }
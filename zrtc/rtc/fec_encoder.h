@@ -1,27 +1,55 @@
 #pragma once
 
 #include "rtc_common.h"
-#include "modules/rtp_rtcp/source/forward_error_correction.h"
-#include "modules/include/module_fec_types.h"
+#include <vector>
 
+enum FecMaskType
+{
+	FEC_MASK_RANDOM = 0, // any two losses in a small group can be recovered
+	FEC_MASK_BURSTY = 1, // consecutive losses fall into different fec packets
+};
+
+// FlexFEC (draft-ietf-payload-flexible-fec-scheme-03, as sent by webrtc) over our own packet buffers.
+// Media packets are referenced while their frame is protected, the fec payload is
+// xored straight into pooled packets, the rtp header in front of it is left to the caller.
+// As in webrtc, everything after the fixed 12 byte rtp header is protected, extensions included.
+//
+// Protection follows the network: the loss rate sets the overhead, a long rtt raises it,
+// bursty loss switches to interleaved masks with longer groups. Key frames get a higher
+// overhead and the first packets of a frame are covered by extra fec packets.
 class FecEncoder
-{ 
+{
 public:
 	FecEncoder(uint32_t media_ssrc, uint32_t fec_ssrc, uint32_t fec_payload_type);
 	virtual ~FecEncoder();
 
-	void UpdateLossRate(uint32_t loss_rate);
-	void AddRtpPacket(std::shared_ptr<RtpPacket> rtp_packet);
-	
-	void GetFecPackets(std::list<webrtc::ForwardErrorCorrection::Packet*>& fec_packets);
+	// loss_rate: percent, loss_burst: percent of the lost packets next to another lost one, rtt: ms
+	void UpdateNetworkState(uint32_t loss_rate, uint32_t loss_burst, uint32_t rtt);
+
+	// protects one frame, a large frame is split into groups of similar size,
+	// the flexfec header starts at header_size, data_size covers the whole packet
+	void EncodeFrame(const std::vector<RtpPacketPtr>& media_packets, bool is_keyframe,
+		uint32_t header_size, std::vector<RtpPacketPtr>& fec_packets);
+
+	static const uint32_t kMaxMediaPackets = 48;
 
 private:
+	uint32_t GetProtectionFactor(bool is_keyframe);
+	void FillMasks(uint32_t first_row, uint32_t num_rows, uint32_t num_media_packets);
+	void GenerateMasks(uint32_t num_media_packets, uint32_t num_fec_packets, uint32_t num_important_packets);
+	bool EncodeFec(uint32_t num_fec_packets, uint32_t num_important_packets,
+		uint32_t header_size, std::vector<RtpPacketPtr>& fec_packets);
+
 	uint32_t media_ssrc_ = 0;
 	uint32_t fec_ssrc_ = 0;
 	uint32_t fec_payload_type_ = 0;
 	uint32_t loss_rate_ = 0;
 	uint32_t smoothed_loss_rate_ = 0;
-	std::unique_ptr<webrtc::ForwardErrorCorrection> fec_;
-	webrtc::ForwardErrorCorrection::PacketList media_packets_;
-	std::list<webrtc::ForwardErrorCorrection::Packet*> fec_packets_;
-};
\ No newline at end of file
+	uint32_t loss_burst_ = 0;
+	uint32_t rtt_ = 0;
+	FecMaskType mask_type_ = FEC_MASK_RANDOM;
+
+	std::vector<RtpPacketPtr> media_packets_;
+	// bit n: the fec packet protects the n-th media packet of the group
+	uint64_t packet_masks_[kMaxMediaPackets] = {};
+};
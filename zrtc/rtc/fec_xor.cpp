@@ -0,0 +1,111 @@
+#include "fec_xor.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FEC_XOR_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FEC_TARGET_AVX2
+#else
+#define FEC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define FEC_XOR_NEON 1
+#include <arm_neon.h>
+#endif
+
+void FecXorScalar(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	size_t n = 0;
+	for (; n + 8 <= size; n += 8) {
+		uint64_t dst_word, src_word;
+		memcpy(&dst_word, dst + n, 8);
+		memcpy(&src_word, src + n, 8);
+		dst_word ^= src_word;
+		memcpy(dst + n, &dst_word, 8);
+	}
+
+	for (; n < size; n++) {
+		dst[n] ^= src[n];
+	}
+}
+
+#if FEC_XOR_AVX2
+FEC_TARGET_AVX2
+static void XorAvx2(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	size_t n = 0;
+	for (; n + 64 <= size; n += 64) {
+		__m256i dst0 = _mm256_loadu_si256((const __m256i*)(dst + n));
+		__m256i dst1 = _mm256_loadu_si256((const __m256i*)(dst + n + 32));
+		__m256i src0 = _mm256_loadu_si256((const __m256i*)(src + n));
+		__m256i src1 = _mm256_loadu_si256((const __m256i*)(src + n + 32));
+		_mm256_storeu_si256((__m256i*)(dst + n), _mm256_xor_si256(dst0, src0));
+		_mm256_storeu_si256((__m256i*)(dst + n + 32), _mm256_xor_si256(dst1, src1));
+	}
+
+	for (; n + 32 <= size; n += 32) {
+		__m256i dst0 = _mm256_loadu_si256((const __m256i*)(dst + n));
+		__m256i src0 = _mm256_loadu_si256((const __m256i*)(src + n));
+		_mm256_storeu_si256((__m256i*)(dst + n), _mm256_xor_si256(dst0, src0));
+	}
+
+	FecXorScalar(dst + n, src + n, size - n);
+}
+
+static bool IsAvx2Supported()
+{
+#if defined(_MSC_VER)
+	int info[4] = { 0 };
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+
+	// the os must save the ymm registers too
+	__cpuid(info, 1);
+	bool has_osxsave = (info[2] & (1 << 27)) != 0;
+	bool has_avx = (info[2] & (1 << 28)) != 0;
+	if (!has_osxsave || !has_avx || (_xgetbv(0) & 0x6) != 0x6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+#if FEC_XOR_NEON
+static void XorNeon(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	size_t n = 0;
+	for (; n + 16 <= size; n += 16) {
+		vst1q_u8(dst + n, veorq_u8(vld1q_u8(dst + n), vld1q_u8(src + n)));
+	}
+
+	FecXorScalar(dst + n, src + n, size - n);
+}
+#endif
+
+static FecXorKernel SelectXorKernel()
+{
+	FecXorKernel kernel = { "scalar", FecXorScalar };
+#if FEC_XOR_AVX2
+	if (IsAvx2Supported()) {
+		kernel = { "avx2", XorAvx2 };
+	}
+#elif FEC_XOR_NEON
+	kernel = { "neon", XorNeon };
+#endif
+	return kernel;
+}
+
+FecXorKernel GetFecXorKernel()
+{
+	static const FecXorKernel kernel = SelectXorKernel();
+	return kernel;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// dst ^= src over size bytes, the payload kernels of the fec encoder
+using FecXorFunc = void (*)(uint8_t* dst, const uint8_t* src, size_t size);
+
+struct FecXorKernel
+{
+	const char* name;
+	FecXorFunc xor_func;
+};
+
+// the portable 64 bit loop, every other kernel ends with it
+void FecXorScalar(uint8_t* dst, const uint8_t* src, size_t size);
+
+// the fastest kernel this cpu runs: avx2 when the cpu and os support it, neon on arm, else scalar.
+// checked once per process
+FecXorKernel GetFecXorKernel();
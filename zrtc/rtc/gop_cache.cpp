@@ -0,0 +1,61 @@
+#include "gop_cache.h"
+#include "rtc_common.h"
+
+GopCache::GopCache()
+{
+	SetMaxSize(RTC_GOP_CACHE_MAX_FRAMES, RTC_GOP_CACHE_MAX_BYTES);
+}
+
+GopCache::~GopCache()
+{
+
+}
+
+void GopCache::SetMaxSize(uint32_t max_frames, size_t max_bytes)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	max_frames_ = max_frames;
+	max_bytes_ = max_bytes;
+}
+
+void GopCache::InputFrame(RtpFramePtr frame, bool is_keyframe)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	if (is_keyframe) {
+		frames_.clear();
+		frames_bytes_ = 0;
+	}
+	else if (frames_.empty()) {
+		return;
+	}
+
+	size_t frame_bytes = 0;
+	for (auto& rtp_pkt : frame->packets) {
+		frame_bytes += rtp_pkt->data_size;
+	}
+
+	// a partial gop can not be decoded, wait for the next idr
+	if (frames_.size() >= max_frames_ || frames_bytes_ + frame_bytes > max_bytes_) {
+		frames_.clear();
+		frames_bytes_ = 0;
+		return;
+	}
+
+	frames_.push_back(frame);
+	frames_bytes_ += frame_bytes;
+}
+
+bool GopCache::GetFrames(std::vector<RtpFramePtr>& frames)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	frames = frames_;
+	return frames.size() > 0;
+}
+
+void GopCache::Clear()
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	frames_.clear();
+	frames_bytes_ = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "rtp_frame.h"
+#include <mutex>
+#include <vector>
+
+// Keeps the packets of the last idr and of the frames after it.
+// A viewer that joins late starts with them instead of waiting for the next idr.
+// A gop that outgrows the limits is dropped until the next idr.
+class GopCache
+{
+public:
+	GopCache();
+	virtual ~GopCache();
+
+	void SetMaxSize(uint32_t max_frames, size_t max_bytes);
+
+	void InputFrame(RtpFramePtr frame, bool is_keyframe);
+
+	// returns false when there is no complete gop
+	bool GetFrames(std::vector<RtpFramePtr>& frames);
+
+	void Clear();
+
+private:
+	std::mutex mutex_;
+	std::vector<RtpFramePtr> frames_;
+	size_t frames_bytes_ = 0;
+	uint32_t max_frames_ = 0;
+	size_t max_bytes_ = 0;
+};
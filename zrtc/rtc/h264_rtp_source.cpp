@@ -47,102 +47,122 @@ void H264RtpSource::InputFrame(uint8_t* frame_data, size_t frame_size)
     }
 }
 
+uint8_t H264RtpSource::GetFrameType(uint8_t* frame_data, size_t frame_size)
+{
+    size_t start_code_size = 0;
+    if (frame_size > 3 && frame_data[0] == 0x00 && frame_data[1] == 0x00 && frame_data[2] == 0x01) {
+        start_code_size = 3;
+    }
+    if (frame_size > 4 && frame_data[0] == 0x00 && frame_data[1] == 0x00 && frame_data[2] == 0x00 && frame_data[3] == 0x01) {
+        start_code_size = 4;
+    }
+
+    if (frame_size <= start_code_size) {
+        return 0;
+    }
+    return frame_data[start_code_size] & 0x1f;
+}
+
 void H264RtpSource::HandleSPSFrame(uint8_t* frame_data, size_t frame_size)
 {
-    sps_.reset(new uint8_t[frame_size], std::default_delete<uint8_t[]>());
+    sps_.assign(frame_data, frame_data + frame_size);
     sps_size_ = static_cast<uint32_t>(frame_size);
-    memcpy(sps_.get(), frame_data, sps_size_);
 }
 
 void H264RtpSource::HandlePPSFrame(uint8_t* frame_data, size_t frame_size)
 {
-    pps_.reset(new uint8_t[frame_size], std::default_delete<uint8_t[]>());
+    pps_.assign(frame_data, frame_data + frame_size);
     pps_size_ = static_cast<uint32_t>(frame_size);
-    memcpy(pps_.get(), frame_data, pps_size_);
 }
 
 void H264RtpSource::HandleIDRFrame(uint8_t* frame_data, size_t frame_size)
 {
-    std::list<RtpPacketPtr> rtp_pkts;
+    rtp_pkts_.clear();
     max_rtp_payload_size_ = RTC_MAX_RTP_PACKET_LENGTH - header_size_;
     timestamp_ = GetH264Timestamp();
     SetTimestamp(timestamp_);
 
     // STAP-A sps pps
-    BuildRtpSTAPA(frame_data, frame_size, rtp_pkts);
+    BuildRtpSTAPA(frame_data, frame_size, rtp_pkts_);
 
     if (frame_size < max_rtp_payload_size_) {
-        BuildRtp(frame_data, frame_size, rtp_pkts);
+        BuildRtp(frame_data, frame_size, rtp_pkts_);
     }
     else {
-        BuildRtpFUA(frame_data, frame_size, rtp_pkts);
+        BuildRtpFUA(frame_data, frame_size, rtp_pkts_);
     }
 
-    if (rtp_pkts.size() > 0 && send_pkt_callback_) {
-        UpdateRtpCache(rtp_pkts);
-        GeneratedFecPacket(rtp_pkts);
-        send_pkt_callback_(rtp_pkts);
+    if (rtp_pkts_.size() > 0 && send_pkt_callback_) {
+        for (auto& rtp_pkt : rtp_pkts_) {
+            rtp_pkt->frame_type = RTC_H264_FRAME_TYPE_IDR;
+        }
+        UpdateRtpCache(rtp_pkts_);
+        GeneratedFecPacket(rtp_pkts_);
     }
+    SendRtpPackets(rtp_pkts_);
 }
 
 void H264RtpSource::HandleRefFrame(uint8_t* frame_data, size_t frame_size)
 {
-    std::list<RtpPacketPtr> rtp_pkts;
+    rtp_pkts_.clear();
     max_rtp_payload_size_ = RTC_MAX_RTP_PACKET_LENGTH - header_size_;
     timestamp_ = GetH264Timestamp();
     SetTimestamp(timestamp_);
 
     if (frame_size < max_rtp_payload_size_) {
-        BuildRtp(frame_data, frame_size, rtp_pkts);
+        BuildRtp(frame_data, frame_size, rtp_pkts_);
     }
     else {
-        BuildRtpFUA(frame_data, frame_size, rtp_pkts);
+        BuildRtpFUA(frame_data, frame_size, rtp_pkts_);
     }
 
-    if (rtp_pkts.size() > 0 && send_pkt_callback_) {
-        UpdateRtpCache(rtp_pkts);
-        GeneratedFecPacket(rtp_pkts);
-        send_pkt_callback_(rtp_pkts);
+    if (rtp_pkts_.size() > 0 && send_pkt_callback_) {
+        for (auto& rtp_pkt : rtp_pkts_) {
+            rtp_pkt->frame_type = RTC_H264_FRAME_TYPE_REF;
+        }
+        UpdateRtpCache(rtp_pkts_);
+        GeneratedFecPacket(rtp_pkts_);
     }
+    SendRtpPackets(rtp_pkts_);
 }
 
-void H264RtpSource::BuildRtp(uint8_t* frame_data, size_t frame_size, std::list<RtpPacketPtr>& rtp_pkts)
+void H264RtpSource::BuildRtp(uint8_t* frame_data, size_t frame_size, std::vector<RtpPacketPtr>& rtp_pkts)
 {
-    std::shared_ptr<RtpPacket> rtp_pkt(new RtpPacket());
+    RtpPacketPtr rtp_pkt = RtpPacket::Create();
     SetMarker(1);
     SetSequence(sequence_++);
     BuildHeader(rtp_pkt);
-    memcpy(rtp_pkt->data.get() + header_size_, frame_data, frame_size);
+    memcpy(rtp_pkt->data + header_size_, frame_data, frame_size);
     rtp_pkt->data_size = header_size_ + static_cast<uint32_t>(frame_size);
-    rtp_pkts.push_back(rtp_pkt);
+    rtp_pkts.push_back(std::move(rtp_pkt));
 }
 
-void H264RtpSource::BuildRtpSTAPA(uint8_t* frame_data, size_t frame_size, std::list<RtpPacketPtr>& rtp_pkts)
+void H264RtpSource::BuildRtpSTAPA(uint8_t* frame_data, size_t frame_size, std::vector<RtpPacketPtr>& rtp_pkts)
 {
-    std::shared_ptr<RtpPacket> rtp_pkt(new RtpPacket());
-    uint8_t* rtp_data_ = rtp_pkt->data.get();
+    RtpPacketPtr rtp_pkt = RtpPacket::Create();
+    uint8_t* rtp_data_ = rtp_pkt->data;
 
     SetMarker(0);
     SetSequence(sequence_++);
     BuildHeader(rtp_pkt);
     rtp_data_ += header_size_;
-    rtp_data_[0] = sps_.get()[0] & (~0x1f) | 24;
+    rtp_data_[0] = sps_[0] & (~0x1f) | 24;
     rtp_data_ += 1;
     WriteUint16BE(rtp_data_, sps_size_);
     rtp_data_ += 2;
-    memcpy(rtp_data_, sps_.get(), sps_size_);
+    memcpy(rtp_data_, sps_.data(), sps_size_);
     rtp_data_ += sps_size_;
 
     WriteUint16BE(rtp_data_, pps_size_);
     rtp_data_ += 2;
-    memcpy(rtp_data_, pps_.get(), pps_size_);
+    memcpy(rtp_data_, pps_.data(), pps_size_);
     rtp_data_ += pps_size_;
 
     rtp_pkt->data_size = header_size_ + sps_size_ + pps_size_ + 5;
-    rtp_pkts.push_back(rtp_pkt);
+    rtp_pkts.push_back(std::move(rtp_pkt));
 }
 
-void H264RtpSource::BuildRtpFUA(uint8_t* frame_data, size_t frame_size, std::list<RtpPacketPtr>& rtp_pkts)
+void H264RtpSource::BuildRtpFUA(uint8_t* frame_data, size_t frame_size, std::vector<RtpPacketPtr>& rtp_pkts)
 {
     uint8_t type = frame_data[0] & 0x1f;
     uint8_t nri = (frame_data[0] & 0x60) >> 5;
@@ -155,15 +175,15 @@ void H264RtpSource::BuildRtpFUA(uint8_t* frame_data, size_t frame_size, std::lis
     frame_size -= 1;
 
     while (frame_size + fu_a_size > max_rtp_payload_size_) {
-        std::shared_ptr<RtpPacket> rtp_pkt(new RtpPacket());
+        RtpPacketPtr rtp_pkt = RtpPacket::Create();
         SetMarker(0);
         SetSequence(sequence_++);
         BuildHeader(rtp_pkt);
-        rtp_pkt->data.get()[header_size_ + 0] = fu_a[0];
-        rtp_pkt->data.get()[header_size_ + 1] = fu_a[1];
-        memcpy(rtp_pkt->data.get() + header_size_ + fu_a_size, frame_data, max_rtp_payload_size_ - fu_a_size);
+        rtp_pkt->data[header_size_ + 0] = fu_a[0];
+        rtp_pkt->data[header_size_ + 1] = fu_a[1];
+        memcpy(rtp_pkt->data + header_size_ + fu_a_size, frame_data, max_rtp_payload_size_ - fu_a_size);
         rtp_pkt->data_size = header_size_ + max_rtp_payload_size_;
-        rtp_pkts.push_back(rtp_pkt);
+        rtp_pkts.push_back(std::move(rtp_pkt));
 
         frame_data += max_rtp_payload_size_ - fu_a_size;
         frame_size -= max_rtp_payload_size_ - fu_a_size;
@@ -171,15 +191,15 @@ void H264RtpSource::BuildRtpFUA(uint8_t* frame_data, size_t frame_size, std::lis
     }
 
     {
-        std::shared_ptr<RtpPacket> rtp_pkt(new RtpPacket());
+        RtpPacketPtr rtp_pkt = RtpPacket::Create();
         SetMarker(1);
         SetSequence(sequence_++);
         BuildHeader(rtp_pkt);
         fu_a[1] |= 0x40;
-        rtp_pkt->data.get()[header_size_ + 0] = fu_a[0];
-        rtp_pkt->data.get()[header_size_ + 1] = fu_a[1];
-        memcpy(rtp_pkt->data.get() + header_size_ + fu_a_size, frame_data, frame_size);
+        rtp_pkt->data[header_size_ + 0] = fu_a[0];
+        rtp_pkt->data[header_size_ + 1] = fu_a[1];
+        memcpy(rtp_pkt->data + header_size_ + fu_a_size, frame_data, frame_size);
         rtp_pkt->data_size = header_size_ + fu_a_size + static_cast<uint32_t>(frame_size);
-        rtp_pkts.push_back(rtp_pkt);
+        rtp_pkts.push_back(std::move(rtp_pkt));
     }
 }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "rtp_source.h"
-#include <list>
+#include <vector>
 
 class H264RtpSource : public RtpSource
 {
@@ -11,17 +11,21 @@ public:
 
 	void InputFrame(uint8_t* frame_data, size_t frame_size);
 
+	// nalu type of an annex-b frame, 0 when it is too short
+	static uint8_t GetFrameType(uint8_t* frame_data, size_t frame_size);
+
 private:
 	void HandleSPSFrame(uint8_t* frame_data, size_t frame_size);
 	void HandlePPSFrame(uint8_t* frame_data, size_t frame_size);
 	void HandleIDRFrame(uint8_t* frame_data, size_t frame_size);
 	void HandleRefFrame(uint8_t* frame_data, size_t frame_size);
-	void BuildRtp(uint8_t* frame_data, size_t frame_size, std::list<RtpPacketPtr>& rtp_pkts);
-	void BuildRtpSTAPA(uint8_t* frame_data, size_t frame_size, std::list<RtpPacketPtr>& rtp_pkts);
-	void BuildRtpFUA(uint8_t* frame_data, size_t frame_size, std::list<RtpPacketPtr>& rtp_pkts);
+	void BuildRtp(uint8_t* frame_data, size_t frame_size, std::vector<RtpPacketPtr>& rtp_pkts);
+	void BuildRtpSTAPA(uint8_t* frame_data, size_t frame_size, std::vector<RtpPacketPtr>& rtp_pkts);
+	void BuildRtpFUA(uint8_t* frame_data, size_t frame_size, std::vector<RtpPacketPtr>& rtp_pkts);
 
-	std::shared_ptr<uint8_t> sps_;
-	std::shared_ptr<uint8_t> pps_;
+	// copied before every idr, the capacity is kept
+	std::vector<uint8_t> sps_;
+	std::vector<uint8_t> pps_;
 	uint32_t sps_size_ = 0;
 	uint32_t pps_size_ = 0;
 	uint32_t max_rtp_payload_size_ = 0;
@@ -0,0 +1,50 @@
+#include "keyframe_requester.h"
+#include "rtc_common.h"
+#include <chrono>
+
+KeyFrameRequester::KeyFrameRequester()
+{
+	SetMinInterval(RTC_KEYFRAME_MIN_INTERVAL_MS);
+}
+
+KeyFrameRequester::~KeyFrameRequester()
+{
+
+}
+
+int64_t KeyFrameRequester::GetTimeNowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void KeyFrameRequester::SetMinInterval(uint32_t interval_ms)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	min_interval_ms_ = interval_ms;
+}
+
+bool KeyFrameRequester::Update(bool is_requested)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	if (!is_requested) {
+		return false;
+	}
+
+	// a forced idr not out yet is counted as sent, the requests wait for it
+	int64_t now = GetTimeNowMs();
+	int64_t last_time = last_keyframe_time_ > last_force_time_ ? last_keyframe_time_ : last_force_time_;
+	if (last_time > 0 && now - last_time < min_interval_ms_) {
+		return false;
+	}
+
+	last_force_time_ = now;
+	return true;
+}
+
+void KeyFrameRequester::OnKeyFrame()
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	last_keyframe_time_ = GetTimeNowMs();
+}
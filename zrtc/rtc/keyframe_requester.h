@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// Coalesces the pli/fir of all viewers of a shared encoder.
+// Any number of requests gives at most one forced idr per interval,
+// an idr sent in the meantime, scheduled or forced, serves them all.
+// Update and OnKeyFrame may be called from different threads.
+class KeyFrameRequester
+{
+public:
+	KeyFrameRequester();
+	virtual ~KeyFrameRequester();
+
+	void SetMinInterval(uint32_t interval_ms);
+
+	// is_requested: a viewer is waiting for an idr, returns true when the encoder should send one now
+	bool Update(bool is_requested);
+
+	// an idr left the encoder
+	void OnKeyFrame();
+
+private:
+	static int64_t GetTimeNowMs();
+
+	std::mutex mutex_;
+	uint32_t min_interval_ms_ = 0;
+	int64_t last_keyframe_time_ = 0;
+	int64_t last_force_time_ = 0;
+};
@@ -14,19 +14,16 @@ OpusRtpSource::~OpusRtpSource()
 
 void OpusRtpSource::InputFrame(uint8_t* frame_data, size_t frame_size)
 {
-    std::list<RtpPacketPtr> rtp_pkts;
+    rtp_pkts_.clear();
     timestamp_ += 480;
 
-    std::shared_ptr<RtpPacket> rtp_pkt(new RtpPacket());
+    RtpPacketPtr rtp_pkt = RtpPacket::Create();
     SetTimestamp(timestamp_);
     SetMarker(1);
     SetSequence(sequence_++);
     BuildHeader(rtp_pkt);
-    memcpy(rtp_pkt->data.get() + header_size_, frame_data, frame_size);
+    memcpy(rtp_pkt->data + header_size_, frame_data, frame_size);
     rtp_pkt->data_size = header_size_ + static_cast<uint32_t>(frame_size);
-    rtp_pkts.push_back(rtp_pkt);
-
-    if (rtp_pkts.size() > 0 && send_pkt_callback_) {
-        send_pkt_callback_(rtp_pkts);
-    }
+    rtp_pkts_.push_back(std::move(rtp_pkt));
+    SendRtpPackets(rtp_pkts_);
 }
\ No newline at end of file
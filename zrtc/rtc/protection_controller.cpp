@@ -0,0 +1,72 @@
+#include "protection_controller.h"
+#include "rtc_common.h"
+
+// nack delay at the receiver and pacing, on top of the rtt
+static const uint32_t kRtxProcessingMs = 20;
+
+// fec is turned on again only for a clear share, the rtt jitters around the threshold
+static const uint32_t kMinFecShare = 10;
+
+ProtectionController::ProtectionController()
+{
+	SetPlayoutDelay(RTC_TARGET_PLAYOUT_DELAY_MS);
+}
+
+ProtectionController::~ProtectionController()
+{
+
+}
+
+void ProtectionController::SetPlayoutDelay(uint32_t delay_ms)
+{
+	playout_delay_ms_ = delay_ms > 0 ? delay_ms : 1;
+}
+
+bool ProtectionController::Update(uint32_t rtt, uint32_t loss_rate)
+{
+	rtt_ = rtt_ == 0 ? rtt : (rtt_ * 3 + rtt * 1) >> 2; // 3/4 + 1/4
+
+	// retransmissions fitting in the playout delay: 2 or more -> 0%, 1 or less -> 100%
+	uint32_t rtx_time = rtt_ + kRtxProcessingMs;
+	int64_t fec_share = 200 - (int64_t)playout_delay_ms_ * 100 / rtx_time;
+	if (fec_share < 0) {
+		fec_share = 0;
+	}
+	else if (fec_share > 100) {
+		fec_share = 100;
+	}
+
+	if (mode_ == PROTECTION_NACK && fec_share < kMinFecShare) {
+		fec_share = 0;
+	}
+
+	fec_share_ = static_cast<uint32_t>(fec_share);
+	fec_loss_rate_ = loss_rate * fec_share_ / 100;
+
+	ProtectionMode mode = PROTECTION_HYBRID;
+	if (fec_share_ == 0) {
+		mode = PROTECTION_NACK;
+	}
+	else if (fec_share_ == 100) {
+		mode = PROTECTION_FEC;
+	}
+
+	bool is_changed = mode != mode_;
+	mode_ = mode;
+	return is_changed;
+}
+
+ProtectionMode ProtectionController::GetMode()
+{
+	return mode_;
+}
+
+uint32_t ProtectionController::GetFecShare()
+{
+	return fec_share_;
+}
+
+uint32_t ProtectionController::GetFecLossRate()
+{
+	return fec_loss_rate_;
+}
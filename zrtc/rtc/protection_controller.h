@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+enum ProtectionMode
+{
+	PROTECTION_NACK   = 0, // retransmissions arrive in time, no fec
+	PROTECTION_HYBRID = 1, // one retransmission fits, fec covers part of the loss
+	PROTECTION_FEC    = 2, // retransmissions arrive too late, fec covers all the loss
+};
+
+// Splits the loss protection of one viewer between nack and fec.
+// A retransmission takes a round trip, while two of them fit in the target
+// playout delay nack alone repairs the loss and fec is not sent. Above that
+// the share of the loss given to fec grows with the rtt, up to all of it once
+// a single retransmission no longer fits.
+// Not thread safe, call it from the connection's scheduler.
+class ProtectionController
+{
+public:
+	ProtectionController();
+	virtual ~ProtectionController();
+
+	void SetPlayoutDelay(uint32_t delay_ms);
+
+	// rtt: ms, loss_rate: percent, returns true when the mode changed
+	bool Update(uint32_t rtt, uint32_t loss_rate);
+
+	ProtectionMode GetMode();
+
+	// percent of the loss fec is sized for
+	uint32_t GetFecShare();
+
+	// the loss rate the fec encoder should protect against, percent
+	uint32_t GetFecLossRate();
+
+private:
+	uint32_t playout_delay_ms_ = 0;
+	uint32_t rtt_ = 0;
+	uint32_t fec_share_ = 0;
+	uint32_t fec_loss_rate_ = 0;
+	ProtectionMode mode_ = PROTECTION_NACK;
+};
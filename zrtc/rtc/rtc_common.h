@@ -9,16 +9,23 @@
 
 static const uint32_t MAX_MTU = 1500;
 static const uint32_t RTC_MAX_PACKET_SIZE= 1350;
+static const uint32_t RTC_UDP_BATCH_SIZE = 64;
 
 static const uint32_t RTC_ICE_UFRAG_LENGTH = 4;
 static const uint32_t RTC_ICE_PASSWORD_LENGTH = 24;
 
 static const uint32_t RTC_SRTP_KEY_LEN = 16;
 static const uint32_t RTC_SRTP_SALT_LEN = 14;
+static const uint32_t RTC_SRTP_AES256_KEY_LEN = 32;
+static const uint32_t RTC_SRTP_GCM_SALT_LEN = 12;
 
 static const uint32_t RTC_MAX_RTP_PACKET_LENGTH = RTC_MAX_PACKET_SIZE - SRTP_MAX_TRAILER_LEN;
 static const uint32_t RTC_MAX_RTCP_PACKET_LENGTH = RTC_MAX_PACKET_SIZE - SRTP_MAX_TRAILER_LEN;
 
+// srtp protects pooled packets in place, the auth tag goes into the tailroom
+static_assert(RTC_MAX_PACKET_SIZE <= RtpPacket::kCapacity, "rtp packet has no room for the srtp trailer");
+static_assert(RTC_MAX_PACKET_SIZE <= RtcpPacket::kCapacity, "rtcp packet has no room for the srtp trailer");
+
 static const uint8_t  RTC_OPUS_PAYLOAD_TYPE = 111;
 
 static const uint8_t   RTC_H264_PAYLOAD_TYPE = 125;
@@ -30,7 +37,36 @@ static const uint8_t   RTC_H264_FRAME_TYPE_REF = 1;
 
 static const uint32_t  RTC_RTCP_UPDATE_INTERVAL = 1000;
 
-static const uint32_t  RTC_NACK_MAX_RTP_CACHE = 10000;
+// packets kept for rtx: a few rtts within the age bounds, and at most the bytes
+static const uint32_t  RTC_RTX_HISTORY_SIZE = 4096;
+static const size_t    RTC_RTX_HISTORY_MAX_BYTES = 4 * 1024 * 1024;
+static const uint32_t  RTC_RTX_HISTORY_MIN_MS = 1000;
+static const uint32_t  RTC_RTX_HISTORY_MAX_MS = 2000;
+static const uint32_t  RTC_RTX_MAX_RATE_PERCENT = 50;
+
+static const uint32_t  RTC_PACER_INTERVAL_MS = 5;
+static const uint32_t  RTC_PACER_BURST_MS = 10;
+static const uint32_t  RTC_PACER_MAX_QUEUE_MS = 2000;
+static const uint32_t  RTC_PACER_DEFAULT_BITRATE = 5000000;
+static const float     RTC_PACER_PACING_FACTOR = 2.5f;
+static const float     RTC_PACER_GOP_PACING_FACTOR = 5.0f;
+
+static const uint32_t  RTC_BWE_MIN_BITRATE = 100000;
+static const uint32_t  RTC_BWE_START_BITRATE = 2000000;
+static const uint32_t  RTC_BWE_MAX_BITRATE = 20000000;
+
+static const uint32_t  RTC_ENCODER_MIN_BITRATE = 150000;
+static const uint32_t  RTC_ENCODER_START_BITRATE = 800000;
+static const uint32_t  RTC_ENCODER_MAX_BITRATE = 8000000;
+
+static const uint32_t  RTC_KEYFRAME_MIN_INTERVAL_MS = 1000;
+// keyframe requests are ignored for one rtt after a gop burst, at least this long
+static const uint32_t  RTC_KEYFRAME_BURST_GUARD_MS = 100;
+
+static const uint32_t  RTC_TARGET_PLAYOUT_DELAY_MS = 200;
+
+static const uint32_t  RTC_GOP_CACHE_MAX_FRAMES = 300;
+static const size_t    RTC_GOP_CACHE_MAX_BYTES = 4 * 1024 * 1024;
 
 enum RtcMediaCodec
 {
@@ -47,3 +83,12 @@ enum RtcRole
 	RTC_ROLE_CLIENT = 1,
 	RTC_ROLE_SERVER = 2,
 };
+
+// dtls-srtp protection profiles, the ids of rfc 5764 and rfc 7714
+enum RtcSrtpProfile
+{
+	RTC_SRTP_PROFILE_NONE = 0,
+	RTC_SRTP_AES128_CM_SHA1_80 = 1,
+	RTC_SRTP_AEAD_AES_128_GCM = 7,
+	RTC_SRTP_AEAD_AES_256_GCM = 8,
+};
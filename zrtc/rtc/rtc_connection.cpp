@@ -3,6 +3,8 @@
 #include "rtc_utils.h"
 #include "opus_rtp_source.h"
 #include "h264_rtp_source.h"
+#include <algorithm>
+#include <chrono>
 
 RtcConnection::RtcConnection(std::shared_ptr<xop::EventLoop> event_loop)
 	: UdpConnection(event_loop)
@@ -20,7 +22,13 @@ RtcConnection::RtcConnection(std::shared_ptr<xop::EventLoop> event_loop)
 
 RtcConnection::~RtcConnection()
 {
-	Destroy();
+	// nothing else holds the connection, no task of ours can run meanwhile
+	Release();
+}
+
+void RtcConnection::SetGopCache(std::shared_ptr<GopCache> gop_cache)
+{
+	gop_cache_ = gop_cache;
 }
 
 void RtcConnection::SetStreamName(std::string stream_name)
@@ -28,13 +36,10 @@ void RtcConnection::SetStreamName(std::string stream_name)
 	stream_name_ = stream_name;
 }
 
-bool RtcConnection::SetLocalAddress(std::string ip, uint16_t port)
+bool RtcConnection::SetUdpDemuxer(std::shared_ptr<UdpDemuxer> udp_demuxer)
 {
-	local_port_ = port;
-	local_ip_ = ip;
-
-	if (!UdpConnection::Init(local_ip_, local_port_)) {
-		RTC_LOG_ERROR("create socket failed, port:{}", local_port_);
+	if (!UdpConnection::Init(udp_demuxer)) {
+		RTC_LOG_ERROR("udp demuxer not found.");
 		return false;
 	}
 
@@ -60,7 +65,7 @@ bool RtcConnection::Init(RtcRole role)
 	rtcp_sources_[audio_ssrc_]->SetSenderReportInterval(5000);
 	rtp_sources_[audio_ssrc_] = std::make_shared<OpusRtpSource>(audio_ssrc_, RTC_MEDIA_CODEC_OPUS);
 	rtp_sources_[audio_ssrc_]->SetExtension(RTP_EXTENSION_TWCC);
-	rtp_sources_[audio_ssrc_]->SetSendPacketCallback([this](std::list<RtpPacketPtr> rtp_pkts) {
+	rtp_sources_[audio_ssrc_]->SetSendPacketCallback([this](std::vector<RtpPacketPtr>& rtp_pkts) {
 		OnSendRtpPackets(rtp_pkts);
 	});
 
@@ -72,39 +77,75 @@ bool RtcConnection::Init(RtcRole role)
 	rtp_sources_[video_ssrc_] = std::make_shared<H264RtpSource>(video_ssrc_, RTC_MEDIA_CODEC_H264);
 	rtp_sources_[video_ssrc_]->SetRtx(rtx_ssrc_, RTC_MEDIA_CODEC_RTX);
 	rtp_sources_[video_ssrc_]->SetFec(fec_ssrc_, RTC_MEDIA_CODEC_FEC);
+	rtp_sources_[video_ssrc_]->SetFecEnabled(protection_controller_.GetMode() != PROTECTION_NACK);
 	rtp_sources_[video_ssrc_]->SetExtension(RTP_EXTENSION_TWCC);
-	rtp_sources_[video_ssrc_]->SetSendPacketCallback([this](std::list<RtpPacketPtr> rtp_pkts) {
+	rtp_sources_[video_ssrc_]->SetSendPacketCallback([this](std::vector<RtpPacketPtr>& rtp_pkts) {
 		OnSendRtpPackets(rtp_pkts);
 	});
 
 	rtcp_sink_ = std::make_shared<RtcpSink>();
 
-	check_rtcp_timer_id_ = event_loop_->AddTimer([this]() {
-		CheckSendRtcp();
-		return true;
-	}, 1000);
+	bandwidth_estimator_ = std::make_shared<BandwidthEstimator>();
+	target_bitrate_ = bandwidth_estimator_->GetTargetBitrate();
 
-	check_nack_timer_id_ = event_loop_->AddTimer([this]() {
-		CheckNack();
-		return true;
-	}, 5);
+	rtp_pacer_ = std::make_shared<RtpPacer>();
+	UpdatePacingRate();
 
 	return true;
 }
 
 void RtcConnection::Destroy()
 {
-	event_loop_->RemoveTimer(check_rtcp_timer_id_);
-	event_loop_->RemoveTimer(check_nack_timer_id_);
-	check_rtcp_timer_id_ = 0;
-	check_nack_timer_id_ = 0;
+	// no stun bind moves the connection to another scheduler once it has left the demuxer
+	if (udp_demuxer_) {
+		udp_demuxer_->RemoveConnection(this);
+	}
 
+	// the fan-out thread stops posting at once, the state goes with the tasks queued before ours
 	is_handshake_done_ = false;
-	dtls_connection_->Destroy();
+
+	auto conn = shared_from_this();
+	bool ret = task_scheduler_->AddTriggerEvent([conn] {
+		conn->Release();
+	});
+
+	if (!ret) {
+		RTC_LOG_ERROR("task queue full, release connection on destruction, ufrag:{}", ice_ufrag_);
+	}
+}
+
+void RtcConnection::Release()
+{
+	// no batch is protected once the queue is closed, the posted sends find no session
+	if (srtp_queue_) {
+		srtp_queue_->Close();
+		srtp_queue_.reset();
+	}
+
+	if (check_rtcp_timer_id_) {
+		task_scheduler_->RemoveTimer(check_rtcp_timer_id_);
+		check_rtcp_timer_id_ = 0;
+	}
+	if (check_nack_timer_id_) {
+		task_scheduler_->RemoveTimer(check_nack_timer_id_);
+		check_nack_timer_id_ = 0;
+	}
+	if (pacer_timer_id_) {
+		task_scheduler_->RemoveTimer(pacer_timer_id_);
+		pacer_timer_id_ = 0;
+	}
+
+	is_handshake_done_ = false;
+	if (dtls_connection_) {
+		dtls_connection_->Destroy();
+		dtls_connection_.reset();
+	}
 
 	rtp_sources_.clear();
 	rtcp_sources_.clear();
 	rtcp_sink_ = nullptr;
+	rtp_pacer_ = nullptr;
+	srtp_session_ = nullptr;
 
 	UdpConnection::Destroy();
 }
@@ -125,6 +166,127 @@ bool RtcConnection::SendVideoFrame(uint8_t* frame, size_t frame_size)
 	return true;
 }
 
+bool RtcConnection::SendVideoPackets(RtpFramePtr frame)
+{
+	if (!is_handshake_done_) {
+		return false;
+	}
+
+	// stamping and the nack history stay on our scheduler
+	std::weak_ptr<RtcConnection> weak_conn = shared_from_this();
+	if (is_video_started_) {
+		bool ret = task_scheduler_->AddTriggerEvent([weak_conn, frame] {
+			auto conn = weak_conn.lock();
+			if (conn && conn->rtp_sources_.count(conn->video_ssrc_)) {
+				conn->rtp_sources_[conn->video_ssrc_]->InputRtpPackets(frame->packets);
+			}
+		});
+
+		if (!ret) {
+			RTC_LOG_ERROR("task queue full, drop video packets:{}", frame->packets.size());
+		}
+		return ret;
+	}
+
+	// a late joiner starts with the cached gop, which ends with this frame,
+	// instead of waiting for the next idr
+	std::vector<RtpFramePtr> frames;
+	is_video_started_ = true;
+	if (gop_cache_) {
+		gop_cache_->GetFrames(frames);
+	}
+	if (frames.empty() || frames.back() != frame) {
+		frames.push_back(frame);
+	}
+	if (frames.size() > 1) {
+		OnKeyFrameSent();
+	}
+
+	bool ret = task_scheduler_->AddTriggerEvent([weak_conn, frames] {
+		auto conn = weak_conn.lock();
+		if (!conn || !conn->rtp_sources_.count(conn->video_ssrc_)) {
+			return;
+		}
+
+		if (frames.size() > 1) {
+			conn->pacing_factor_ = RTC_PACER_GOP_PACING_FACTOR;
+			conn->UpdatePacingRate();
+		}
+
+		for (auto& gop_frame : frames) {
+			conn->rtp_sources_[conn->video_ssrc_]->InputRtpPackets(gop_frame->packets);
+		}
+	});
+
+	if (!ret) {
+		RTC_LOG_ERROR("task queue full, drop video packets:{}", frame->packets.size());
+	}
+	return ret;
+}
+
+bool RtcConnection::SendAudioFrame(std::shared_ptr<uint8_t> frame, size_t frame_size)
+{
+	if (!is_handshake_done_) {
+		return false;
+	}
+
+	std::weak_ptr<RtcConnection> weak_conn = shared_from_this();
+	bool ret = task_scheduler_->AddTriggerEvent([weak_conn, frame, frame_size] {
+		auto conn = weak_conn.lock();
+		if (conn) {
+			conn->SendAudioFrame(frame.get(), frame_size);
+		}
+	});
+
+	if (!ret) {
+		RTC_LOG_ERROR("task queue full, drop audio frame:{}", frame_size);
+	}
+	return ret;
+}
+
+uint32_t RtcConnection::GetVideoLossRate()
+{
+	return video_loss_rate_;
+}
+
+uint32_t RtcConnection::GetVideoRTT()
+{
+	return video_rtt_;
+}
+
+uint32_t RtcConnection::GetVideoLossBurst()
+{
+	return video_loss_burst_;
+}
+
+void RtcConnection::SetPlayoutDelay(uint32_t delay_ms)
+{
+	protection_controller_.SetPlayoutDelay(delay_ms);
+}
+
+void RtcConnection::SetSrtpWorkerPool(std::shared_ptr<SrtpWorkerPool> srtp_worker_pool)
+{
+	srtp_worker_pool_ = srtp_worker_pool;
+	if (srtp_worker_pool_) {
+		srtp_queue_ = srtp_worker_pool_->CreateQueue();
+	}
+}
+
+uint32_t RtcConnection::GetVideoFecLossRate()
+{
+	return video_fec_loss_rate_;
+}
+
+RtpHistoryStats RtcConnection::GetVideoHistoryStats()
+{
+	RtpHistoryStats stats;
+	stats.packets = video_history_packets_;
+	stats.bytes = video_history_bytes_;
+	stats.owned_bytes = video_history_owned_bytes_;
+	stats.entry_bytes = video_history_entry_bytes_;
+	return stats;
+}
+
 bool RtcConnection::SendAudioFrame(uint8_t* frame, size_t frame_size)
 {
 	if (!is_handshake_done_) {
@@ -162,6 +324,34 @@ std::string RtcConnection::GetLocalUfrag()
 	return local_sdp_.GetIceUfrag();
 }
 
+std::string RtcConnection::GetLocalPwd()
+{
+	return ice_pwd_;
+}
+
+void RtcConnection::OnBind()
+{
+	// the timers start on the scheduler the first stun bind pinned us to
+	std::weak_ptr<RtcConnection> weak_conn = shared_from_this();
+	check_rtcp_timer_id_ = task_scheduler_->AddTimer([weak_conn]() {
+		auto conn = weak_conn.lock();
+		if (!conn) {
+			return false;
+		}
+		conn->CheckSendRtcp();
+		return true;
+	}, 1000);
+
+	check_nack_timer_id_ = task_scheduler_->AddTimer([weak_conn]() {
+		auto conn = weak_conn.lock();
+		if (!conn) {
+			return false;
+		}
+		conn->CheckNack();
+		return true;
+	}, 5);
+}
+
 void RtcConnection::OnRecv(uint8_t* pkt, size_t pkt_size)
 {
 	if (pkt_size > 0) {
@@ -189,30 +379,247 @@ int RtcConnection::OnSend(uint8_t* pkt, size_t pkt_size)
 	return sent_bytes;
 }
 
-void RtcConnection::OnSendRtpPackets(std::list<RtpPacketPtr> rtp_pkts)
+int RtcConnection::OnSendBatch(uint8_t** pkts, const size_t* sizes, size_t count, xop::DatagramBuffer* const* owners)
 {
-	event_loop_->AddTriggerEvent([this, rtp_pkts] {
-		for (auto pkt : rtp_pkts) {
+	int sent_pkts = UdpConnection::OnSendBatch(pkts, sizes, count, owners);
+	if (sent_pkts < 0) {
+		RTC_LOG_ERROR("sendmmsg error: {}", strerror(errno));
+	}
+	return sent_pkts;
+}
+
+void RtcConnection::OnSendRtpPackets(std::vector<RtpPacketPtr>& rtp_pkts)
+{
+	// a recycled frame carries the packets, the source gets its vector back
+	auto frame = RtpFrame::Create();
+	frame->packets.swap(rtp_pkts);
+
+	std::weak_ptr<RtcConnection> weak_conn = shared_from_this();
+	bool ret = task_scheduler_->AddTriggerEvent([weak_conn, frame] {
+		auto conn = weak_conn.lock();
+		if (!conn || !conn->rtp_pacer_) {
+			return;
+		}
+
+		for (auto& pkt : frame->packets) {
 			if (pkt) {
-				// twcc seq
-				rtp_sources_[pkt->ssrc]->UpdateExtSequence(pkt, connection_seq_++);
+				conn->rtp_pacer_->EnqueuePacket(pkt, conn->GetPacketPriority(pkt));
+			}
+		}
+		conn->SendPacedPackets();
+		conn->StartPacerTimer();
+	});
 
-				uint8_t srtp_buffer[MAX_MTU] = { 0 };
-				memcpy(srtp_buffer, pkt->data.get(), pkt->data_size);
+	if (!ret) {
+		RTC_LOG_ERROR("task queue full, drop rtp packets:{}", frame->packets.size());
+	}
+}
 
-				int rtp_pkt_size = srtp_session_->ProtectRtp(srtp_buffer, pkt->data_size);
-				if (rtp_pkt_size > 0) {
-					OnSend(srtp_buffer, rtp_pkt_size);
+RtpPacketPriority RtcConnection::GetPacketPriority(RtpPacketPtr& rtp_pkt)
+{
+	if (rtp_pkt->ssrc == audio_ssrc_) {
+		return RTP_PRIORITY_AUDIO;
+	}
+	else if (rtp_pkt->is_rtx_) {
+		return RTP_PRIORITY_RTX;
+	}
+	else if (rtp_pkt->is_fec_) {
+		return RTP_PRIORITY_FEC;
+	}
+	return RTP_PRIORITY_VIDEO;
+}
 
-					// update rtcp stats
-					if (!pkt->is_rtx_ && !pkt->is_fec_ && rtcp_sources_.count(pkt->ssrc)) {
-						auto rtcp_source = rtcp_sources_[pkt->ssrc];
-						rtcp_source->OnSendRtp(pkt->data_size, pkt->timestamp);
-					}
+void RtcConnection::SendPacedPackets()
+{
+	if (!rtp_pacer_ || !srtp_session_) {
+		return;
+	}
+
+	std::vector<RtpPacketPtr>& rtp_pkts = paced_pkts_;
+	rtp_pkts.clear();
+	rtp_pacer_->Process(rtp_pkts);
+
+	// the gop burst is out, back to the normal pacing rate
+	if (pacing_factor_ != RTC_PACER_PACING_FACTOR && rtp_pacer_->GetQueueBytes() == 0) {
+		pacing_factor_ = RTC_PACER_PACING_FACTOR;
+		gop_burst_end_time_ = GetTimeNowMs();
+		UpdatePacingRate();
+	}
+
+	if (rtp_pkts.empty()) {
+		return;
+	}
+
+	if (srtp_queue_) {
+		PostPacedPackets(rtp_pkts);
+		rtp_pkts.clear();
+		return;
+	}
+
+	// the paced packets go out in as few syscalls as possible, each with its packet as the owner,
+	// rtp_pkts keeps them alive until the batch is sent or queued to the ring
+	uint8_t* batch_pkts[RTC_UDP_BATCH_SIZE];
+	size_t batch_sizes[RTC_UDP_BATCH_SIZE];
+	xop::DatagramBuffer* batch_owners[RTC_UDP_BATCH_SIZE];
+	size_t batch_count = 0;
+
+	for (auto& pkt : rtp_pkts) {
+		if (pkt) {
+			// twcc seq
+			uint16_t transport_seq = connection_seq_++;
+			rtp_sources_[pkt->ssrc]->UpdateExtSequence(pkt, transport_seq);
+
+			// update rtcp stats, counted before the packet is protected
+			if (!pkt->is_rtx_ && !pkt->is_fec_ && rtcp_sources_.count(pkt->ssrc)) {
+				auto rtcp_source = rtcp_sources_[pkt->ssrc];
+				rtcp_source->OnSendRtp(pkt->data_size, pkt->timestamp);
+			}
+
+			// packets in the nack history stay plaintext, a copy is protected in their place
+			if (pkt->is_cached_) {
+				RtpPacketPtr srtp_pkt = RtpPacket::Create();
+				memcpy(srtp_pkt->data, pkt->data, pkt->data_size);
+				srtp_pkt->data_size = pkt->data_size;
+				pkt = srtp_pkt;
+			}
+
+			int rtp_pkt_size = srtp_session_->ProtectRtp(pkt->data, pkt->data_size);
+			if (rtp_pkt_size > 0) {
+				bandwidth_estimator_->OnPacketSent(transport_seq, rtp_pkt_size);
+
+				batch_pkts[batch_count] = pkt->data;
+				batch_sizes[batch_count] = rtp_pkt_size;
+				batch_owners[batch_count] = pkt.get();
+				if (++batch_count == RTC_UDP_BATCH_SIZE) {
+					OnSendBatch(batch_pkts, batch_sizes, batch_count, batch_owners);
+					batch_count = 0;
 				}
 			}
 		}
+	}
+
+	if (batch_count > 0) {
+		OnSendBatch(batch_pkts, batch_sizes, batch_count, batch_owners);
+	}
+	rtp_pkts.clear();
+}
+
+void RtcConnection::StartPacerTimer()
+{
+	// nothing is sent before the handshake, the timer also waits for the scheduler of the first bind
+	if (pacer_timer_id_ || !rtp_pacer_ || !srtp_session_ || rtp_pacer_->GetQueueBytes() == 0) {
+		return;
+	}
+
+	std::weak_ptr<RtcConnection> weak_conn = shared_from_this();
+	pacer_timer_id_ = task_scheduler_->AddTimer([weak_conn]() {
+		auto conn = weak_conn.lock();
+		if (!conn) {
+			return false;
+		}
+
+		conn->SendPacedPackets();
+		if (!conn->rtp_pacer_ || conn->rtp_pacer_->GetQueueBytes() == 0) {
+			conn->pacer_timer_id_ = 0;
+			return false;
+		}
+		return true;
+	}, RTC_PACER_INTERVAL_MS);
+}
+
+void RtcConnection::PostPacedPackets(std::vector<RtpPacketPtr>& rtp_pkts)
+{
+	auto srtp_batch = std::make_shared<SrtpBatch>();
+	srtp_batch->rtp_pkts.reserve(rtp_pkts.size());
+	srtp_batch->transport_seqs.reserve(rtp_pkts.size());
+
+	for (auto pkt : rtp_pkts) {
+		if (pkt) {
+			// twcc seq
+			uint16_t transport_seq = connection_seq_++;
+			rtp_sources_[pkt->ssrc]->UpdateExtSequence(pkt, transport_seq);
+
+			// update rtcp stats, counted before the packet is protected
+			if (!pkt->is_rtx_ && !pkt->is_fec_ && rtcp_sources_.count(pkt->ssrc)) {
+				auto rtcp_source = rtcp_sources_[pkt->ssrc];
+				rtcp_source->OnSendRtp(pkt->data_size, pkt->timestamp);
+			}
+
+			// packets in the nack history stay plaintext, the workers protect a copy
+			if (pkt->is_cached_) {
+				RtpPacketPtr srtp_pkt = RtpPacket::Create();
+				memcpy(srtp_pkt->data, pkt->data, pkt->data_size);
+				srtp_pkt->data_size = pkt->data_size;
+				pkt = srtp_pkt;
+			}
+
+			srtp_batch->rtp_pkts.push_back(pkt);
+			srtp_batch->transport_seqs.push_back(transport_seq);
+		}
+	}
+
+	// the session of the batch is kept, a new handshake may replace ours meanwhile.
+	// the worker never locks the connection, the last reference must not drop on the pool
+	auto srtp_session = srtp_session_;
+	auto task_scheduler = task_scheduler_;
+	std::weak_ptr<RtcConnection> weak_conn = shared_from_this();
+	bool ret = srtp_queue_->Post([weak_conn, task_scheduler, srtp_batch, srtp_session] {
+		if (weak_conn.expired()) {
+			return;
+		}
+
+		srtp_batch->srtp_sizes.resize(srtp_batch->rtp_pkts.size());
+		for (size_t i = 0; i < srtp_batch->rtp_pkts.size(); i++) {
+			auto& pkt = srtp_batch->rtp_pkts[i];
+			srtp_batch->srtp_sizes[i] = srtp_session->ProtectRtp(pkt->data, pkt->data_size);
+		}
+
+		bool ret = task_scheduler->AddTriggerEvent([weak_conn, srtp_batch] {
+			auto conn = weak_conn.lock();
+			if (conn) {
+				conn->SendProtectedPackets(*srtp_batch);
+			}
+		});
+
+		if (!ret) {
+			RTC_LOG_ERROR("task queue full, drop srtp packets:{}", srtp_batch->rtp_pkts.size());
+		}
 	});
+
+	if (!ret) {
+		RTC_LOG_ERROR("srtp queue full, drop rtp packets:{}", srtp_batch->rtp_pkts.size());
+	}
+}
+
+void RtcConnection::SendProtectedPackets(SrtpBatch& srtp_batch)
+{
+	if (!is_handshake_done_) {
+		return;
+	}
+
+	uint8_t* batch_pkts[RTC_UDP_BATCH_SIZE];
+	size_t batch_sizes[RTC_UDP_BATCH_SIZE];
+	xop::DatagramBuffer* batch_owners[RTC_UDP_BATCH_SIZE];
+	size_t batch_count = 0;
+
+	for (size_t i = 0; i < srtp_batch.rtp_pkts.size(); i++) {
+		int rtp_pkt_size = srtp_batch.srtp_sizes[i];
+		if (rtp_pkt_size > 0) {
+			bandwidth_estimator_->OnPacketSent(srtp_batch.transport_seqs[i], rtp_pkt_size);
+
+			batch_pkts[batch_count] = srtp_batch.rtp_pkts[i]->data;
+			batch_sizes[batch_count] = rtp_pkt_size;
+			batch_owners[batch_count] = srtp_batch.rtp_pkts[i].get();
+			if (++batch_count == RTC_UDP_BATCH_SIZE) {
+				OnSendBatch(batch_pkts, batch_sizes, batch_count, batch_owners);
+				batch_count = 0;
+			}
+		}
+	}
+
+	if (batch_count > 0) {
+		OnSendBatch(batch_pkts, batch_sizes, batch_count, batch_owners);
+	}
 }
 
 void RtcConnection::OnSendRtcpPackets(std::list<RtcpPacketPtr> rtcp_pkts)
@@ -221,12 +628,18 @@ void RtcConnection::OnSendRtcpPackets(std::list<RtcpPacketPtr> rtcp_pkts)
 		return;
 	}
 
-	event_loop_->AddTriggerEvent([this, rtcp_pkts] {
+	std::weak_ptr<RtcConnection> weak_conn = shared_from_this();
+	bool ret = task_scheduler_->AddTriggerEvent([weak_conn, rtcp_pkts] {
+		auto conn = weak_conn.lock();
+		if (!conn || !conn->srtp_session_) {
+			return;
+		}
+
 		for (auto pkt : rtcp_pkts) {
 			if (pkt) {
-				int rtcp_pkt_size = srtp_session_->ProtectRtcp(pkt->data.get(), pkt->data_size);
+				int rtcp_pkt_size = conn->srtp_session_->ProtectRtcp(pkt->data, pkt->data_size);
 				if (rtcp_pkt_size > 0) {
-					OnSend(pkt->data.get(), rtcp_pkt_size);
+					conn->OnSend(pkt->data, rtcp_pkt_size);
 				}
 				else {
 					break;
@@ -234,6 +647,10 @@ void RtcConnection::OnSendRtcpPackets(std::list<RtcpPacketPtr> rtcp_pkts)
 			}
 		}
 	});
+
+	if (!ret) {
+		RTC_LOG_ERROR("task queue full, drop rtcp packets:{}", rtcp_pkts.size());
+	}
 }
 
 void RtcConnection::OnStunPacket(uint8_t* stun_pkt, size_t size)
@@ -278,7 +695,7 @@ void RtcConnection::OnDtlsPacket(uint8_t* dtls_pkt, size_t size)
 			RTC_LOG_ERROR("srtp recv key not found.");
 			return;
 		}
-		if (!srtp_session_->Init(send_key, recv_key)) {
+		if (!srtp_session_->Init(dtls_connection_->GetSrtpProfile(), send_key, recv_key)) {
 			RTC_LOG_ERROR("srtp session init failed.");
 			return;
 		}
@@ -303,6 +720,8 @@ void RtcConnection::OnRtcpPacket(uint8_t* pkt, size_t size)
 		if (rtcp_sink_->Parse(pkt, rtcp_pkt_size)) {
 			CheckNack();
 			UpdateQoS();
+			UpdateBandwidth();
+			CheckKeyFrameRequest();
 		}
 	}
 }
@@ -323,6 +742,14 @@ void RtcConnection::CheckSendRtcp()
 		rtcp_sink_->OnSenderReportRecord(ComPactNtp(ntp_timestamp));
 		OnSendRtcpPackets(rtcp_pkts);
 	}
+
+	if (rtp_sources_.count(video_ssrc_)) {
+		RtpHistoryStats stats = rtp_sources_[video_ssrc_]->GetHistoryStats();
+		video_history_packets_ = stats.packets;
+		video_history_bytes_ = stats.bytes;
+		video_history_owned_bytes_ = stats.owned_bytes;
+		video_history_entry_bytes_ = stats.entry_bytes;
+	}
 }
 
 void RtcConnection::CheckNack()
@@ -330,8 +757,13 @@ void RtcConnection::CheckNack()
 	for (auto rtp_source : rtp_sources_) {
 		std::vector<uint16_t> lost_seqs;
 		if (rtcp_sink_->GetLostSeq(rtp_source.first, lost_seqs)) {
-			if (!lost_seqs.empty()) {
-				rtp_source.second->RetransmitRtpPackets(lost_seqs);
+			if (!lost_seqs.empty() && rtp_source.second->RetransmitRtpPackets(lost_seqs)) {
+				// the lost packets left the history, the viewer waits for an idr like after a pli
+				if (rtp_source.first == video_ssrc_ && !keyframe_pending_) {
+					RTC_LOG_INFO("nack unrecoverable, request keyframe, ufrag:{} lost:{}", ice_ufrag_, lost_seqs.size());
+					keyframe_requested_++;
+					keyframe_pending_ = true;
+				}
 			}
 		}
 	}
@@ -342,6 +774,93 @@ void RtcConnection::UpdateQoS()
 	for (auto rtp_source : rtp_sources_) {
 		uint32_t rtt = rtcp_sink_->GetRTT(rtp_source.first);
 		uint32_t loss_rate = rtcp_sink_->GetLossRate(rtp_source.first);
-		rtp_source.second->UpdateQoS(rtt, loss_rate);
+		if (rtp_source.first != video_ssrc_) {
+			rtp_source.second->UpdateQoS(rtt, loss_rate);
+			continue;
+		}
+
+		// the rtt decides how much of the loss is left to fec
+		if (protection_controller_.Update(rtt, loss_rate)) {
+			RTC_LOG_INFO("protection mode:{} fec-share:{}% rtt:{} lost:{}%, ufrag:{}",
+				(int)protection_controller_.GetMode(), protection_controller_.GetFecShare(), rtt, loss_rate, ice_ufrag_);
+		}
+
+		uint32_t fec_loss_rate = protection_controller_.GetFecLossRate();
+		rtp_source.second->SetFecEnabled(protection_controller_.GetMode() != PROTECTION_NACK);
+		rtp_source.second->UpdateQoS(rtt, fec_loss_rate);
+		video_loss_rate_ = loss_rate;
+		video_rtt_ = rtt;
+		video_loss_burst_ = rtp_source.second->GetLossBurst();
+		video_fec_loss_rate_ = fec_loss_rate;
+	}
+}
+
+void RtcConnection::UpdateBandwidth()
+{
+	std::vector<TransportFeedbackPacket> feedback;
+	if (!rtcp_sink_->GetTransportFeedback(feedback)) {
+		return;
+	}
+
+	if (bandwidth_estimator_->OnTransportFeedback(feedback)) {
+		target_bitrate_ = bandwidth_estimator_->GetTargetBitrate();
+		UpdatePacingRate();
+	}
+}
+
+void RtcConnection::UpdatePacingRate()
+{
+	rtp_pacer_->SetPacingRate(static_cast<uint32_t>(target_bitrate_ * pacing_factor_));
+}
+
+uint32_t RtcConnection::GetTargetBitrate()
+{
+	return target_bitrate_;
+}
+
+int64_t RtcConnection::GetTimeNowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RtcConnection::CheckKeyFrameRequest()
+{
+	uint32_t requests = rtcp_sink_->GetKeyFrameRequests(video_ssrc_);
+	if (requests == 0) {
+		return;
+	}
+
+	// the viewer asked before the idr of the gop burst reached it, the request is stale
+	uint32_t guard_ms = std::max<uint32_t>(video_rtt_, RTC_KEYFRAME_BURST_GUARD_MS);
+	if (pacing_factor_ != RTC_PACER_PACING_FACTOR
+		|| (gop_burst_end_time_ > 0 && GetTimeNowMs() - gop_burst_end_time_ < guard_ms)) {
+		RTC_LOG_INFO("keyframe request during gop burst ignored, ufrag:{} requests:{}", ice_ufrag_, requests);
+		return;
+	}
+
+	keyframe_requested_ += requests;
+	keyframe_pending_ = true;
+}
+
+bool RtcConnection::IsKeyFrameRequested()
+{
+	return keyframe_pending_;
+}
+
+void RtcConnection::OnKeyFrameSent()
+{
+	if (keyframe_pending_.exchange(false)) {
+		keyframe_served_++;
 	}
-}
\ No newline at end of file
+}
+
+uint32_t RtcConnection::GetKeyFrameRequested()
+{
+	return keyframe_requested_;
+}
+
+uint32_t RtcConnection::GetKeyFrameServed()
+{
+	return keyframe_served_;
+}
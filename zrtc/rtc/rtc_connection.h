@@ -2,38 +2,97 @@
 
 #include "dtls_connection.h"
 #include "udp_connection.h"
+#include "udp_demuxer.h"
 #include "rtc_common.h"
 #include "rtc_sdp.h"
 #include "srtp_session.h"
+#include "srtp_worker_pool.h"
 #include "rtp_source.h"
 #include "rtcp_source.h"
 #include "rtcp_sink.h"
+#include "rtp_pacer.h"
+#include "bandwidth_estimator.h"
+#include "gop_cache.h"
+#include "protection_controller.h"
 #include "stun_source.h"
 #include "stun_sink.h"
 
-class RtcConnection : public UdpConnection
+// paced packets of one pacer interval on their way through the srtp workers
+struct SrtpBatch
+{
+	std::vector<RtpPacketPtr> rtp_pkts;
+	std::vector<uint16_t> transport_seqs;
+	std::vector<int> srtp_sizes;
+};
+
+// posted tasks and timers hold the connection weakly, it may be released on any thread
+class RtcConnection : public UdpConnection, public std::enable_shared_from_this<RtcConnection>
 {
 public:
 	RtcConnection(std::shared_ptr<xop::EventLoop> event_loop);
 	virtual ~RtcConnection();
 
 	bool Init(RtcRole role);
+	// the teardown is posted to our scheduler
 	void Destroy();
 
 	bool SendVideoFrame(uint8_t* frame, size_t frame_size);
 	bool SendAudioFrame(uint8_t* frame, size_t frame_size);
 
+	// the frame or the packets built once by a shared H264RtpSource are shared by all connections,
+	// they are posted to our scheduler and must not be modified afterwards
+	bool SendVideoPackets(RtpFramePtr frame);
+	bool SendAudioFrame(std::shared_ptr<uint8_t> frame, size_t frame_size);
+	uint32_t GetVideoLossRate();
+	uint32_t GetVideoRTT();
+	uint32_t GetVideoLossBurst();
+
+	// nack while retransmissions arrive within the playout delay, fec beyond it
+	void SetPlayoutDelay(uint32_t delay_ms);
+	// the loss the shared fec should be sized for on behalf of this viewer
+	uint32_t GetVideoFecLossRate();
+
+	// memory held by the rtx history of this viewer, refreshed every second
+	RtpHistoryStats GetVideoHistoryStats();
+
+	// send-side estimate from transport-cc feedback
+	uint32_t GetTargetBitrate();
+
+	// pli/fir of this viewer wait until an idr of the shared encoder is sent to it
+	bool IsKeyFrameRequested();
+	void OnKeyFrameSent();
+	uint32_t GetKeyFrameRequested();
+	uint32_t GetKeyFrameServed();
+
+	// the first frame after the handshake is sent with the cached gop before it, paced at a higher rate
+	void SetGopCache(std::shared_ptr<GopCache> gop_cache);
+
+	// paced rtp is protected on the pool in order and sent from our scheduler, set before Init
+	void SetSrtpWorkerPool(std::shared_ptr<SrtpWorkerPool> srtp_worker_pool);
+
 	void SetStreamName(std::string stream_name);
-	bool SetLocalAddress(std::string ip, uint16_t port);
+	bool SetUdpDemuxer(std::shared_ptr<UdpDemuxer> udp_demuxer);
 
 	void SetRemoteSdp(std::string sdp);
 	std::string GetLocalSdp();
 	std::string GetLocalUfrag();
+	std::string GetLocalPwd();
 
 private:
+	void Release();
+	virtual void OnBind();
 	virtual void OnRecv(uint8_t* pkt, size_t pkt_size);
 	virtual int  OnSend(uint8_t* pkt, size_t pkt_size);
-	void OnSendRtpPackets(std::list<RtpPacketPtr> rtp_pkts);
+	virtual int  OnSendBatch(uint8_t** pkts, const size_t* sizes, size_t count, xop::DatagramBuffer* const* owners);
+	// takes the packets, rtp_pkts is left empty
+	void OnSendRtpPackets(std::vector<RtpPacketPtr>& rtp_pkts);
+	RtpPacketPriority GetPacketPriority(RtpPacketPtr& rtp_pkt);
+	void SendPacedPackets();
+	// the pacer timer only runs while packets are queued
+	void StartPacerTimer();
+	void PostPacedPackets(std::vector<RtpPacketPtr>& rtp_pkts);
+	void SendProtectedPackets(SrtpBatch& srtp_batch);
+	void UpdatePacingRate();
 	void OnSendRtcpPackets(std::list<RtcpPacketPtr> rtcp_pkts);
 	void OnStunPacket(uint8_t* pkt, size_t size);
 	void OnDtlsPacket(uint8_t* pkt, size_t size);
@@ -42,15 +101,39 @@ private:
 	void CheckSendRtcp();
 	void CheckNack();
 	void UpdateQoS();
+	void UpdateBandwidth();
+	void CheckKeyFrameRequest();
+
+	static int64_t GetTimeNowMs();
 
 	uint32_t audio_ssrc_ = 0;
 	uint32_t video_ssrc_ = 0;
 	uint32_t rtx_ssrc_ = 0;
 	uint32_t fec_ssrc_ = 0;
 	std::atomic<uint16_t> connection_seq_ = 1;
+	std::atomic<uint32_t> video_loss_rate_{0};
+	std::atomic<uint32_t> video_rtt_{0};
+	std::atomic<uint32_t> video_loss_burst_{0};
+	std::atomic<uint32_t> video_fec_loss_rate_{0};
+	std::atomic<uint32_t> video_history_packets_{0};
+	std::atomic<size_t> video_history_bytes_{0};
+	std::atomic<size_t> video_history_owned_bytes_{0};
+	std::atomic<size_t> video_history_entry_bytes_{0};
+	ProtectionController protection_controller_;
 	std::unordered_map<uint32_t, std::shared_ptr<RtpSource>> rtp_sources_;
 	std::unordered_map<uint32_t, std::shared_ptr<RtcpSource>> rtcp_sources_;
 	std::shared_ptr<RtcpSink> rtcp_sink_;
+	std::shared_ptr<RtpPacer> rtp_pacer_;
+	std::vector<RtpPacketPtr> paced_pkts_;
+	std::shared_ptr<BandwidthEstimator> bandwidth_estimator_;
+	std::atomic<uint32_t> target_bitrate_{0};
+	float pacing_factor_ = RTC_PACER_PACING_FACTOR;
+	int64_t gop_burst_end_time_ = 0;
+	std::shared_ptr<GopCache> gop_cache_;
+	bool is_video_started_ = false; // fan-out thread only
+	std::atomic<bool> keyframe_pending_{false};
+	std::atomic<uint32_t> keyframe_requested_{0};
+	std::atomic<uint32_t> keyframe_served_{0};
 
 	std::string stream_name_;
 	std::string ice_ufrag_;
@@ -61,11 +144,16 @@ private:
 
 	uint32_t check_rtcp_timer_id_ = 0;
 	uint32_t check_nack_timer_id_ = 0;
+	uint32_t pacer_timer_id_ = 0;
 	std::shared_ptr<StunSource> stun_source_;
 	std::shared_ptr<StunSink> stun_sink_;
 
-	bool is_handshake_done_ = false;
+	std::atomic<bool> is_handshake_done_{false}; // set on our scheduler, read by the fan-out thread
 	std::shared_ptr<DtlsConnection> dtls_connection_;
 	std::shared_ptr<SrtpSession> srtp_session_;
+	std::shared_ptr<SrtpWorkerPool> srtp_worker_pool_;
+	std::shared_ptr<SrtpWorkerPool::Queue> srtp_queue_;
 };
 
+// connection snapshot for the media threads, replaced as a whole with std::atomic_store
+using RtcConnectionList = std::vector<std::shared_ptr<RtcConnection>>;
@@ -19,6 +19,14 @@
         {spdlog::info(msg, ##__VA_ARGS__);} \
 }
 
+#define RTC_LOG_DEBUG(msg, ...) \
+{ \
+    if (spdlog::get(RTC_LOG_TAG))  \
+        {spdlog::get(RTC_LOG_TAG)->debug(msg, ##__VA_ARGS__);} \
+    else \
+        {spdlog::debug(msg, ##__VA_ARGS__);} \
+}
+
 #define RTC_LOG_ERROR(msg, ...) \
 { \
     if (spdlog::get(RTC_LOG_TAG))  \
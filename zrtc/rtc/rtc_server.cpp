@@ -2,7 +2,6 @@
 #include "rtc_common.h"
 
 RtcServer::RtcServer()
-	: event_loop_(new xop::EventLoop())
 {
 
 }
@@ -15,15 +14,114 @@ RtcServer::~RtcServer()
 bool RtcServer::Init(RtcConfig config)
 {
 	local_ip_ = config.local_ip;
+	local_port_ = config.local_port;
 	enable_h264_ = config.enable_h264;
 	enable_opus_ = config.enable_opus;
 
+	if (event_loop_) {
+		return false;
+	}
+
+	xop::PacketPool::EnableHugePages(config.enable_huge_pages);
+	keyframe_requester_.SetMinInterval(config.min_keyframe_interval_ms);
+	target_playout_delay_ms_ = config.target_playout_delay_ms;
+	if (config.srtp_threads > 0) {
+		srtp_worker_pool_ = std::make_shared<SrtpWorkerPool>(config.srtp_threads);
+	}
+
+	gop_cache_ = std::make_shared<GopCache>();
+	video_source_ = std::make_shared<H264RtpSource>(GenerateSSRC(), RTC_MEDIA_CODEC_H264);
+	video_source_->SetFec(GenerateSSRC(), RTC_MEDIA_CODEC_FEC);
+	video_source_->SetExtension(RTP_EXTENSION_TWCC);
+	video_source_->SetSendPacketCallback([this](std::vector<RtpPacketPtr>& rtp_pkts) {
+		// one frame is posted to every connection's scheduler and not changed after,
+		// it takes the packets and leaves its recycled vector to the packetizer
+		auto frame = RtpFrame::Create();
+		frame->packets.swap(rtp_pkts);
+		gop_cache_->InputFrame(frame, frame->packets.front()->frame_type == RTC_H264_FRAME_TYPE_IDR);
+		auto connection_list = std::atomic_load(&connection_list_);
+		for (auto& conn : *connection_list) {
+			conn->SendVideoPackets(frame);
+		}
+	});
+
+	event_loop_.reset(new xop::EventLoop(config.num_threads));
 	event_loop_->Loop();
+
+	udp_demuxer_ = std::make_shared<UdpDemuxer>(event_loop_);
+	if (!udp_demuxer_->Init(local_ip_, local_port_)) {
+		RTC_LOG_ERROR("bind udp port failed, addr:{}:{}", local_ip_, local_port_);
+		udp_demuxer_.reset();
+		return false;
+	}
+
+	if (!udp_demuxer_->EnableGso(config.enable_gso)) {
+		RTC_LOG_INFO("udp gso is not supported, use sendmmsg");
+	}
+
+	// slabs stop growing once the pools have warmed up
+	pool_stats_timer_id_ = event_loop_->AddTimer([this] {
+		auto stats = xop::PacketPool::GetStats();
+		RTC_LOG_INFO("packet pool, alloc:{} free:{} slabs:{} slab-bytes:{}",
+			stats.alloc_count, stats.free_count, stats.slab_count, stats.slab_bytes);
+
+		// one line for all viewers, each viewer's own numbers at debug level
+		auto connection_list = std::atomic_load(&connection_list_);
+		if (connection_list && !connection_list->empty()) {
+			uint64_t keyframe_requested = 0;
+			uint64_t keyframe_served = 0;
+			uint32_t keyframe_viewers = 0;
+			uint64_t history_packets = 0;
+			uint64_t owned_bytes = 0;
+			uint64_t ring_bytes = 0;
+			size_t max_owned_bytes = 0;
+			std::string max_owned_ufrag;
+
+			for (auto& conn : *connection_list) {
+				uint32_t requested = conn->GetKeyFrameRequested();
+				if (requested > 0) {
+					keyframe_requested += requested;
+					keyframe_served += conn->GetKeyFrameServed();
+					keyframe_viewers++;
+					RTC_LOG_DEBUG("keyframe, ufrag:{} requested:{} served:{}",
+						conn->GetLocalUfrag(), requested, conn->GetKeyFrameServed());
+				}
+
+				// shared packets are pinned by every viewer that references them, only owned ones add up
+				auto history = conn->GetVideoHistoryStats();
+				history_packets += history.packets;
+				owned_bytes += history.owned_bytes;
+				ring_bytes += history.entry_bytes;
+				if (history.owned_bytes >= max_owned_bytes) {
+					max_owned_bytes = history.owned_bytes;
+					max_owned_ufrag = conn->GetLocalUfrag();
+				}
+				RTC_LOG_DEBUG("rtx history, ufrag:{} packets:{} bytes:{} owned-bytes:{} ring-bytes:{}",
+					conn->GetLocalUfrag(), history.packets, history.bytes, history.owned_bytes, history.entry_bytes);
+			}
+
+			RTC_LOG_INFO("viewers:{} keyframe requested:{} served:{} by-viewers:{}",
+				connection_list->size(), keyframe_requested, keyframe_served, keyframe_viewers);
+			RTC_LOG_INFO("rtx history, packets:{} owned-bytes:{} ring-bytes:{} max-owned-bytes:{} ufrag:{}",
+				history_packets, owned_bytes, ring_bytes, max_owned_bytes, max_owned_ufrag);
+		}
+		return true;
+	}, 10000);
+
 	return true;
 }
 
 void RtcServer::Destroy()
 {
+	if (event_loop_ && pool_stats_timer_id_) {
+		event_loop_->RemoveTimer(pool_stats_timer_id_);
+		pool_stats_timer_id_ = 0;
+	}
+
+	if (udp_demuxer_) {
+		udp_demuxer_->Destroy();
+	}
+
 	if (event_loop_) {
 		event_loop_->Quit();
 	}
@@ -31,14 +129,32 @@ void RtcServer::Destroy()
 
 bool RtcServer::SendVideoFrame(uint8_t* frame, size_t frame_size)
 {
-	std::lock_guard<std::mutex> locker(connections_mutex_);
-
-	if (rtc_connections_.empty()) {
+	auto connection_list = std::atomic_load(&connection_list_);
+	if (!connection_list || connection_list->empty() || !video_source_) {
 		return false;
 	}
 
-	for (auto conn : rtc_connections_) {
-		conn.second->SendVideoFrame(frame, frame_size);
+	// the shared fec follows the viewer with the most loss left to fec,
+	// viewers that rely on nack alone do not forward it
+	uint32_t loss_rate = 0;
+	uint32_t loss_burst = 0;
+	uint32_t rtt = 0;
+	for (auto& conn : *connection_list) {
+		if (conn->GetVideoFecLossRate() >= loss_rate) {
+			loss_rate = conn->GetVideoFecLossRate();
+			loss_burst = conn->GetVideoLossBurst();
+			rtt = conn->GetVideoRTT();
+		}
+	}
+	video_source_->UpdateQoS(rtt, loss_rate, loss_burst);
+	video_source_->InputFrame(frame, frame_size);
+
+	// any idr serves the viewers waiting for one, scheduled or forced
+	if (H264RtpSource::GetFrameType(frame, frame_size) == RTC_H264_FRAME_TYPE_IDR) {
+		for (auto& conn : *connection_list) {
+			conn->OnKeyFrameSent();
+		}
+		keyframe_requester_.OnKeyFrame();
 	}
 
 	return true;
@@ -46,32 +162,86 @@ bool RtcServer::SendVideoFrame(uint8_t* frame, size_t frame_size)
 
 bool RtcServer::SendAudioFrame(uint8_t* frame, size_t frame_size)
 {
-	std::lock_guard<std::mutex> locker(connections_mutex_);
-
-	if (rtc_connections_.empty()) {
+	auto connection_list = std::atomic_load(&connection_list_);
+	if (!connection_list || connection_list->empty()) {
 		return false;
 	}
 
-	for (auto conn : rtc_connections_) {
-		conn.second->SendAudioFrame(frame, frame_size);
+	std::shared_ptr<uint8_t> audio_frame(new uint8_t[frame_size], std::default_delete<uint8_t[]>());
+	memcpy(audio_frame.get(), frame, frame_size);
+	for (auto& conn : *connection_list) {
+		conn->SendAudioFrame(audio_frame, frame_size);
 	}
 
 	return true;
 }
 
+uint32_t RtcServer::UpdateVideoBitrate()
+{
+	auto connection_list = std::atomic_load(&connection_list_);
+	if (!connection_list || connection_list->empty()) {
+		return 0;
+	}
+
+	std::vector<ViewerQoS> viewers;
+	for (auto& conn : *connection_list) {
+		ViewerQoS viewer;
+		viewer.target_bitrate = conn->GetTargetBitrate();
+		viewer.rtt = conn->GetVideoRTT();
+		viewer.loss_rate = conn->GetVideoLossRate();
+		viewers.push_back(viewer);
+	}
+
+	return video_rate_controller_.Update(viewers);
+}
+
+bool RtcServer::UpdateKeyFrameRequest()
+{
+	auto connection_list = std::atomic_load(&connection_list_);
+	if (!connection_list || connection_list->empty()) {
+		return false;
+	}
+
+	bool is_requested = false;
+	for (auto& conn : *connection_list) {
+		if (conn->IsKeyFrameRequested()) {
+			is_requested = true;
+			break;
+		}
+	}
+
+	return keyframe_requester_.Update(is_requested);
+}
+
 void RtcServer::OnRequest(std::string stream_name, std::string offer, std::string& answer)
 {
 	std::lock_guard<std::mutex> locker(connections_mutex_);
 
+	if (!udp_demuxer_) {
+		return;
+	}
+
 	auto rtc_connection = std::make_shared<RtcConnection>(event_loop_);
 	rtc_connection->SetStreamName(stream_name);
-	rtc_connection->SetLocalAddress(local_ip_, 10000);
+	rtc_connection->SetGopCache(gop_cache_);
+	rtc_connection->SetPlayoutDelay(target_playout_delay_ms_);
+	rtc_connection->SetSrtpWorkerPool(srtp_worker_pool_);
+	if (!rtc_connection->SetUdpDemuxer(udp_demuxer_)) {
+		return;
+	}
 	rtc_connection->Init(RTC_ROLE_SERVER);
 	rtc_connection->SetRemoteSdp(offer);
 	answer = rtc_connection->GetLocalSdp();
 	std::string ufrag = rtc_connection->GetLocalUfrag();
 
 	if (answer.size() > 0 && ufrag.size() > 0) {
+		udp_demuxer_->AddConnection(ufrag, rtc_connection->GetLocalPwd(), rtc_connection);
 		rtc_connections_[ufrag] = rtc_connection;
+
+		auto connection_list = std::make_shared<RtcConnectionList>();
+		for (auto& conn : rtc_connections_) {
+			connection_list->push_back(conn.second);
+		}
+		std::atomic_store(&connection_list_, std::shared_ptr<const RtcConnectionList>(connection_list));
 	}
 }
@@ -2,6 +2,9 @@
 
 #include "rtc_utils.h"
 #include "rtc_connection.h"
+#include "h264_rtp_source.h"
+#include "video_rate_controller.h"
+#include "keyframe_requester.h"
 #include <mutex>
 
 struct RtcConfig
@@ -10,6 +13,26 @@ struct RtcConfig
 	bool enable_opus = true;
 
 	std::string local_ip;
+	uint16_t local_port = 10000;
+
+	// udp segmentation offload for runs of equal sized packets, used when the kernel supports it
+	bool enable_gso = true;
+
+	// back the rtp/rtcp packet pools with huge pages, they must be reserved by the system
+	bool enable_huge_pages = false;
+
+	// connections are spread over the schedulers, each one is pinned to a single thread
+	uint32_t num_threads = std::thread::hardware_concurrency();
+
+	// pli/fir from any number of viewers force at most one idr per interval
+	uint32_t min_keyframe_interval_ms = RTC_KEYFRAME_MIN_INTERVAL_MS;
+
+	// retransmissions that would miss it are replaced by fec
+	uint32_t target_playout_delay_ms = RTC_TARGET_PLAYOUT_DELAY_MS;
+
+	// rtp of each connection is protected in order on a pool of this many threads
+	// and sent from the connection's scheduler, 0: protected on the scheduler
+	uint32_t srtp_threads = 0;
 };
 
 class RtcServer
@@ -21,17 +44,36 @@ public:
 	bool Init(RtcConfig config);
 	void Destroy();
 
+	// called from the encoder threads, they never wait for signaling or for the connections
 	bool SendVideoFrame(uint8_t* frame, size_t frame_size);
 	bool SendAudioFrame(uint8_t* frame, size_t frame_size);
 
+	// encoder bitrate that fits the viewers, 0 keeps the current one
+	uint32_t UpdateVideoBitrate();
+
+	// true when a viewer waits for an idr and the encoder should send one now
+	bool UpdateKeyFrameRequest();
+
 	void OnRequest(std::string stream_name, std::string offer, std::string& answer);
 
 private:
 	bool enable_h264_ = true;
 	bool enable_opus_ = true;
 	std::string local_ip_ = "127.0.0.1";
+	uint16_t local_port_ = 10000;
+	uint32_t target_playout_delay_ms_ = RTC_TARGET_PLAYOUT_DELAY_MS;
 	std::shared_ptr<xop::EventLoop> event_loop_;
+	std::shared_ptr<UdpDemuxer> udp_demuxer_;
+	std::shared_ptr<SrtpWorkerPool> srtp_worker_pool_;
+	xop::TimerId pool_stats_timer_id_ = 0;
 
 	std::mutex connections_mutex_;
 	std::unordered_map<std::string, std::shared_ptr<RtcConnection>> rtc_connections_;
+	std::shared_ptr<const RtcConnectionList> connection_list_;
+
+	// packetizes each video frame once, fec included, the connections only stamp it
+	std::shared_ptr<H264RtpSource> video_source_;
+	std::shared_ptr<GopCache> gop_cache_;
+	VideoRateController video_rate_controller_;
+	KeyFrameRequester keyframe_requester_;
 };
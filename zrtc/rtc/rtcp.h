@@ -1,9 +1,10 @@
 #pragma once
 
-#include <cstdint>
 #include <cstdint>
 #include <memory>
+#include <new>
 #include <vector>
+#include "net/MemoryManager.h"
 
 static const uint8_t RTCP_VERSION      = 2;
 static const uint8_t RTCP_HEADER_SIZE  = 4;
@@ -40,19 +41,46 @@ struct RtcpHeader
 	}
 };
 
+struct RtcpPacket;
+using RtcpPacketPtr = xop::RefPtr<RtcpPacket>;
+
+// The packet and its payload share one pooled buffer, the payload is not zeroed.
 struct RtcpPacket
 {
-	RtcpPacket()
-		: data(new uint8_t[1500], std::default_delete<uint8_t[]>())
+	static RtcpPacketPtr Create()
 	{
-		memset(data.get(), 0, 1500);
+		void* buffer = xop::PacketPool::Alloc();
+		RtcpPacket* rtcp_pkt = new (buffer) RtcpPacket();
+		rtcp_pkt->data = static_cast<uint8_t*>(buffer) + kDataOffset;
+		return RtcpPacketPtr(rtcp_pkt);
 	}
 
-	std::shared_ptr<uint8_t> data;
+	void AddRef()
+	{ ref_count_.fetch_add(1, std::memory_order_relaxed); }
+
+	void Release()
+	{
+		if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			this->~RtcpPacket();
+			xop::PacketPool::Free(this);
+		}
+	}
+
+	uint8_t* data = nullptr;
 	uint32_t data_size = 0;
+
+private:
+	RtcpPacket() = default;
+	~RtcpPacket() = default;
+
+	std::atomic<uint32_t> ref_count_{0};
+
+public:
+	static const uint32_t kDataOffset = 64;
+	static const uint32_t kCapacity = xop::PacketPool::kBufferSize - kDataOffset;
 };
 
-using RtcpPacketPtr = std::shared_ptr<RtcpPacket>;
+static_assert(sizeof(RtcpPacket) <= RtcpPacket::kDataOffset, "packet header overlaps the payload");
 
 static bool IsRtcpPacket(const uint8_t* data, size_t size)
 {
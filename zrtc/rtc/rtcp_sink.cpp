@@ -32,6 +32,25 @@ bool RtcpSink::GetLostSeq(uint32_t ssrc, std::vector<uint16_t>& lost_seqs)
     }
 }
 
+bool RtcpSink::GetTransportFeedback(std::vector<TransportFeedbackPacket>& feedback)
+{
+    feedback.swap(transport_feedback_);
+    transport_feedback_.clear();
+    return feedback.size() > 0;
+}
+
+uint32_t RtcpSink::GetKeyFrameRequests(uint32_t ssrc)
+{
+    if (keyframe_requests_.count(ssrc)) {
+        uint32_t requests = keyframe_requests_[ssrc];
+        keyframe_requests_.erase(ssrc);
+        return requests;
+    }
+    else {
+        return 0;
+    }
+}
+
 uint32_t RtcpSink::GetLossRate(uint32_t ssrc)
 {
     if (loss_rate_.count(ssrc)) {
@@ -58,6 +77,27 @@ bool RtcpSink::Parse(uint8_t* pkt, size_t size)
 	    return false;
     }
 
+    // compound packet, e.g. a receiver report followed by transport feedback
+    while (size >= RTCP_HEADER_SIZE) {
+        size_t pkt_size = (ReadU16BE(pkt + 2, size - 2) + 1) * 4;
+        if (pkt_size > size) {
+            break;
+        }
+
+        ParsePacket(pkt, pkt_size);
+        pkt += pkt_size;
+        size -= pkt_size;
+    }
+
+    return true;
+}
+
+bool RtcpSink::ParsePacket(uint8_t* pkt, size_t size)
+{
+    if (size < RTCP_HEADER_SIZE) {
+	    return false;
+    }
+
     rtcp_header_.version = pkt[0] >> 6;
     rtcp_header_.padding = (pkt[0] & 0x20) ? 1 : 0;
     rtcp_header_.rc = pkt[0] & 0x1f;
@@ -89,6 +129,7 @@ bool RtcpSink::Parse(uint8_t* pkt, size_t size)
         else if (fmt == RTCP_PT_PSFB_PLI) {
             OnPLI(payload, payload_size);
         }
+        break;
     default:
         break;
     }
@@ -151,19 +192,105 @@ void RtcpSink::OnNack(uint8_t* payload, size_t size)
 
 void RtcpSink::OnTransportFeedback(uint8_t* payload, size_t size)
 {
+    // draft-holmer-rmcat-transport-wide-cc-extensions-01
+    if (size < 16) {
+        return;
+    }
+
+    // the sequence numbers are transport wide, the sender and media ssrc at 0 and 4 are not needed
+    uint16_t base_seq = ReadU16BE(payload + 8, size - 8);
+    uint16_t status_count = ReadU16BE(payload + 10, size - 10);
+    int32_t reference_time = (payload[12] << 16) | (payload[13] << 8) | payload[14];
+    if (reference_time & 0x800000) {
+        reference_time -= 0x1000000;
+    }
+
+    // packet status chunks
+    std::vector<uint8_t> symbols;
+    symbols.reserve(status_count);
+    size_t index = 16;
+    while (symbols.size() < status_count && index + 2 <= size) {
+        uint16_t chunk = ReadU16BE(payload + index, 2);
+        index += 2;
+
+        if (!(chunk & 0x8000)) {
+            // run length chunk
+            uint8_t symbol = (chunk >> 13) & 0x3;
+            uint16_t run_length = chunk & 0x1fff;
+            for (uint16_t i = 0; i < run_length && symbols.size() < status_count; i++) {
+                symbols.push_back(symbol);
+            }
+        }
+        else if (!(chunk & 0x4000)) {
+            // status vector chunk, 14 one bit symbols
+            for (int i = 0; i < 14 && symbols.size() < status_count; i++) {
+                symbols.push_back((chunk >> (13 - i)) & 0x1);
+            }
+        }
+        else {
+            // status vector chunk, 7 two bit symbols
+            for (int i = 0; i < 7 && symbols.size() < status_count; i++) {
+                symbols.push_back((chunk >> (12 - 2 * i)) & 0x3);
+            }
+        }
+    }
 
+    // receive deltas, 250us each, the reference time counts in 64ms
+    int64_t recv_time_us = (int64_t)reference_time * 64000;
+    for (size_t n = 0; n < symbols.size(); n++) {
+        TransportFeedbackPacket feedback;
+        feedback.sequence = static_cast<uint16_t>(base_seq + n);
+
+        if (symbols[n] == 1) {
+            if (index + 1 > size) {
+                break;
+            }
+            recv_time_us += payload[index] * 250;
+            index += 1;
+            feedback.received = true;
+        }
+        else if (symbols[n] == 2) {
+            if (index + 2 > size) {
+                break;
+            }
+            recv_time_us += static_cast<int16_t>(ReadU16BE(payload + index, 2)) * 250;
+            index += 2;
+            feedback.received = true;
+        }
+
+        feedback.recv_time_us = recv_time_us;
+        transport_feedback_.push_back(feedback);
+    }
 }
 
 void RtcpSink::OnFir(uint8_t* payload, size_t size)
 {
-    uint32_t sender_ssrc = ReadU32BE(payload, size);
-    uint32_t media_ssrc = ReadU32BE(payload + 4, size);
-    RTC_LOG_INFO("rtcp fir, ssrc:{}", media_ssrc);
+    if (size < 8) {
+        return;
+    }
+
+    // fci entries: ssrc, command sequence number, 3 reserved bytes
+    for (size_t index = 8; index + 8 <= size; index += 8) {
+        uint32_t media_ssrc = ReadU32BE(payload + index, size - index);
+        uint8_t seq = payload[index + 4];
+
+        auto iter = fir_seqs_.find(media_ssrc);
+        if (iter != fir_seqs_.end() && iter->second == seq) {
+            continue;
+        }
+
+        fir_seqs_[media_ssrc] = seq;
+        keyframe_requests_[media_ssrc] += 1;
+        RTC_LOG_INFO("rtcp fir, ssrc:{} seq:{}", media_ssrc, seq);
+    }
 }
 
 void RtcpSink::OnPLI(uint8_t* payload, size_t size)
 {
-    uint32_t sender_ssrc = ReadU32BE(payload, size);
-    uint32_t media_ssrc = ReadU32BE(payload + 4, size);
-    RTC_LOG_INFO("rtcp pli, ssrc:{}", media_ssrc);
-}
\ No newline at end of file
+    if (size < 8) {
+        return;
+    }
+
+    uint32_t media_ssrc = ReadU32BE(payload + 4, size - 4);
+    keyframe_requests_[media_ssrc] += 1;
+}
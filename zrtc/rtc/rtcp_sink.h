@@ -15,6 +15,14 @@ struct ReportBlock
 	uint32_t delay_since_last_sr = 0;
 };
 
+// one entry of a transport-cc feedback, recv_time_us is on the receiver clock
+struct TransportFeedbackPacket
+{
+	uint16_t sequence = 0;
+	bool     received = false;
+	int64_t  recv_time_us = 0;
+};
+
 class RtcpSink
 {
 public:
@@ -25,11 +33,16 @@ public:
 
 	void OnSenderReportRecord(uint32_t last_sr);
 	bool GetLostSeq(uint32_t ssrc, std::vector<uint16_t>& lost_seqs);
+	bool GetTransportFeedback(std::vector<TransportFeedbackPacket>& feedback);
+
+	// pli and fir received for the ssrc since the last call, a retransmitted fir counts once
+	uint32_t GetKeyFrameRequests(uint32_t ssrc);
 
 	uint32_t GetLossRate(uint32_t ssrc);
 	uint32_t GetRTT(uint32_t ssrc);
 
 private:
+	bool ParsePacket(uint8_t* pkt, size_t size);
 	void OnReceiverReport(uint8_t* payload, size_t size);
 	void OnNack(uint8_t* payload, size_t size);
 	void OnTransportFeedback(uint8_t* payload, size_t size);
@@ -39,6 +52,9 @@ private:
 	RtcpHeader rtcp_header_ = {};
 	std::map<uint32_t, uint64_t> last_sr_records_;
 	std::map<uint32_t, std::vector<uint16_t>> nack_lost_seqs_;
+	std::vector<TransportFeedbackPacket> transport_feedback_;
+	std::map<uint32_t, uint32_t> keyframe_requests_;
+	std::map<uint32_t, uint8_t> fir_seqs_;
 	std::map<uint32_t, uint32_t> rtt_;
 	std::map<uint32_t, uint32_t> loss_rate_;
 
@@ -41,7 +41,7 @@ RtcpPacketPtr RtcpSource::BuildSenderReport()
 		return nullptr;
 	}
 
-	auto rtcp_packet = std::make_shared<RtcpPacket>();
+	auto rtcp_packet = RtcpPacket::Create();
 	RtcpHeader rtcp_header;
 	rtcp_header.version = RTCP_VERSION;
 	rtcp_header.padding = 0;
@@ -49,7 +49,7 @@ RtcpPacketPtr RtcpSource::BuildSenderReport()
 	rtcp_header.payload_type = RTCP_PT_SENDER_REPORT;
 	rtcp_header.length = (RTCP_SENDER_REPORT_SIZE - RTCP_HEADER_SIZE) / 4;
 	std::vector<uint8_t> header = rtcp_header.Build();
-	std::copy(header.begin(), header.end(), rtcp_packet->data.get());
+	std::copy(header.begin(), header.end(), rtcp_packet->data);
 
 	ByteArray payload;
 	payload.WriteUint32BE(ssrc_);
@@ -59,7 +59,7 @@ RtcpPacketPtr RtcpSource::BuildSenderReport()
 	payload.WriteUint32BE(rtp_packet_count_);
 	payload.WriteUint32BE(rtp_octet_count_);
 
-	memcpy(rtcp_packet->data.get() + header.size(), payload.Data(), payload.Size());
+	memcpy(rtcp_packet->data + header.size(), payload.Data(), payload.Size());
 	rtcp_packet->data_size = RTCP_SENDER_REPORT_SIZE;
 	return rtcp_packet;
 }
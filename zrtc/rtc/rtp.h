@@ -1,7 +1,10 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <new>
+#include "net/MemoryManager.h"
 
 static const uint8_t  RTP_VERSION = 2;
 static const uint32_t RTP_HEADER_SIZE = 12;
@@ -25,12 +28,30 @@ struct RtpHeader
 	uint32_t ssrc;
 };
 
-struct RtpPacket
+struct RtpPacket;
+using RtpPacketPtr = xop::RefPtr<RtpPacket>;
+
+// The packet and its payload share one pooled buffer, the payload is not zeroed.
+// An io_uring scheduler sends the payload in place and holds the packet until the send completes.
+struct RtpPacket final : public xop::DatagramBuffer
 {
-	RtpPacket()
-		: data(new uint8_t[1500], std::default_delete<uint8_t[]>())
+	static RtpPacketPtr Create()
+	{
+		void* buffer = xop::PacketPool::Alloc();
+		RtpPacket* rtp_pkt = new (buffer) RtpPacket();
+		rtp_pkt->data = static_cast<uint8_t*>(buffer) + kDataOffset;
+		return RtpPacketPtr(rtp_pkt);
+	}
+
+	void AddRef() override
+	{ ref_count_.fetch_add(1, std::memory_order_relaxed); }
+
+	void Release() override
 	{
-		memset(data.get(), 0, 1500);
+		if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			this->~RtpPacket();
+			xop::PacketPool::Free(this);
+		}
 	}
 
 	uint32_t ssrc = 0;
@@ -38,14 +59,26 @@ struct RtpPacket
 	uint16_t sequence = 0;
 	uint8_t  marker = 0;
 
-	std::shared_ptr<uint8_t> data;
+	uint8_t* data = nullptr;
 	uint32_t data_size  = 0;
 	uint8_t  frame_type = 0;
 	uint8_t  is_rtx_ = 0;
 	uint8_t  is_fec_ = 0;
+	// kept plaintext in the nack history, srtp must not run in place
+	uint8_t  is_cached_ = 0;
+
+private:
+	RtpPacket() = default;
+	~RtpPacket() = default;
+
+	std::atomic<uint32_t> ref_count_{0};
+
+public:
+	static const uint32_t kDataOffset = 64;
+	static const uint32_t kCapacity = xop::PacketPool::kBufferSize - kDataOffset;
 };
 
-using RtpPacketPtr = std::shared_ptr<RtpPacket>;
+static_assert(sizeof(RtpPacket) <= RtpPacket::kDataOffset, "packet header overlaps the payload");
 
 static bool IsRtpPacket(const uint8_t* data, size_t size)
 {
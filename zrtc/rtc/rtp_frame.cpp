@@ -0,0 +1,48 @@
+#include "rtp_frame.h"
+#include <mutex>
+
+// a frame is released on whichever scheduler drops the last reference, a few a second
+static const size_t kMaxFreeFrames = 256;
+
+static std::mutex s_free_frames_mutex;
+static std::vector<RtpFrame*> s_free_frames;
+
+RtpFramePtr RtpFrame::Create()
+{
+	RtpFrame* frame = nullptr;
+	{
+		std::lock_guard<std::mutex> locker(s_free_frames_mutex);
+		if (!s_free_frames.empty()) {
+			frame = s_free_frames.back();
+			s_free_frames.pop_back();
+		}
+	}
+
+	if (!frame) {
+		frame = new RtpFrame();
+	}
+	return RtpFramePtr(frame);
+}
+
+void RtpFrame::Release()
+{
+	if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+
+	// the packets go back to their pools now, the vector keeps its capacity
+	packets.clear();
+
+	{
+		std::lock_guard<std::mutex> locker(s_free_frames_mutex);
+		if (s_free_frames.size() < kMaxFreeFrames) {
+			if (s_free_frames.capacity() == 0) {
+				s_free_frames.reserve(kMaxFreeFrames);
+			}
+			s_free_frames.push_back(this);
+			return;
+		}
+	}
+
+	delete this;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "rtp.h"
+#include <vector>
+
+struct RtpFrame;
+using RtpFramePtr = xop::RefPtr<RtpFrame>;
+
+// Packets of one encoded frame, fec included, shared by all connections once built.
+// A released frame goes back to a free list with its packet vector, so a steady
+// stream of frames reuses the same frames and their capacity.
+struct RtpFrame
+{
+	static RtpFramePtr Create();
+
+	void AddRef()
+	{ ref_count_.fetch_add(1, std::memory_order_relaxed); }
+
+	void Release();
+
+	std::vector<RtpPacketPtr> packets;
+
+private:
+	RtpFrame() = default;
+	~RtpFrame() = default;
+
+	std::atomic<uint32_t> ref_count_{0};
+};
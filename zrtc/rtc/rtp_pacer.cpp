@@ -0,0 +1,117 @@
+#include "rtp_pacer.h"
+#include <chrono>
+
+RtpPacer::RtpPacer()
+{
+
+}
+
+RtpPacer::~RtpPacer()
+{
+
+}
+
+int64_t RtpPacer::GetTimeNowUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RtpPacer::SetPacingRate(uint32_t bitrate_bps)
+{
+	if (bitrate_bps > 0) {
+		pacing_rate_ = bitrate_bps;
+	}
+}
+
+void RtpPacer::SetBurstTime(uint32_t burst_ms)
+{
+	burst_ms_ = burst_ms;
+}
+
+void RtpPacer::EnqueuePacket(RtpPacketPtr rtp_pkt, RtpPacketPriority priority)
+{
+	EnqueuePacket(rtp_pkt, priority, GetTimeNowUs());
+}
+
+void RtpPacer::EnqueuePacket(RtpPacketPtr rtp_pkt, RtpPacketPriority priority, int64_t now_us)
+{
+	if (!rtp_pkt || priority >= RTP_PRIORITY_MAX) {
+		return;
+	}
+
+	QueuedPacket queued_pkt;
+	queued_pkt.rtp_pkt = rtp_pkt;
+	queued_pkt.enqueue_time_us = now_us;
+	queues_[priority].push_back(queued_pkt);
+	queue_bytes_ += rtp_pkt->data_size;
+}
+
+void RtpPacer::Process(std::vector<RtpPacketPtr>& rtp_pkts)
+{
+	Process(rtp_pkts, GetTimeNowUs());
+}
+
+void RtpPacer::Process(std::vector<RtpPacketPtr>& rtp_pkts, int64_t now_us)
+{
+	if (last_process_time_us_ == 0) {
+		last_process_time_us_ = now_us;
+	}
+
+	int64_t elapsed_us = now_us - last_process_time_us_;
+	last_process_time_us_ = now_us;
+
+	// a queue that would take longer than RTC_PACER_MAX_QUEUE_MS is drained faster than the target rate
+	int64_t pacing_rate = pacing_rate_;
+	int64_t drain_rate = (int64_t)queue_bytes_ * 8 * 1000 / RTC_PACER_MAX_QUEUE_MS;
+	if (drain_rate > pacing_rate) {
+		pacing_rate = drain_rate;
+	}
+
+	int64_t max_budget_bytes = pacing_rate * burst_ms_ / 8000;
+	budget_bytes_ += pacing_rate * elapsed_us / 8000000;
+	if (budget_bytes_ > max_budget_bytes) {
+		budget_bytes_ = max_budget_bytes;
+	}
+
+	for (int priority = 0; priority < RTP_PRIORITY_MAX && budget_bytes_ > 0; priority++) {
+		auto& queue = queues_[priority];
+		while (!queue.empty() && budget_bytes_ > 0) {
+			RtpPacketPtr rtp_pkt = queue.front().rtp_pkt;
+			queue.pop_front();
+			queue_bytes_ -= rtp_pkt->data_size;
+			budget_bytes_ -= rtp_pkt->data_size;
+			rtp_pkts.push_back(rtp_pkt);
+		}
+	}
+}
+
+uint32_t RtpPacer::GetPacingRate()
+{
+	return pacing_rate_;
+}
+
+size_t RtpPacer::GetQueueBytes()
+{
+	return queue_bytes_;
+}
+
+int64_t RtpPacer::GetQueueDelayMs()
+{
+	return GetQueueDelayMs(GetTimeNowUs());
+}
+
+int64_t RtpPacer::GetQueueDelayMs(int64_t now_us)
+{
+	int64_t oldest_time_us = 0;
+	for (auto& queue : queues_) {
+		if (!queue.empty() && (oldest_time_us == 0 || queue.front().enqueue_time_us < oldest_time_us)) {
+			oldest_time_us = queue.front().enqueue_time_us;
+		}
+	}
+
+	if (oldest_time_us == 0) {
+		return 0;
+	}
+	return (now_us - oldest_time_us) / 1000;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "rtc_common.h"
+#include <deque>
+#include <vector>
+
+// strict priority, a lower value is sent first
+enum RtpPacketPriority
+{
+	RTP_PRIORITY_AUDIO = 0,
+	RTP_PRIORITY_RTX   = 1,
+	RTP_PRIORITY_VIDEO = 2,
+	RTP_PRIORITY_FEC   = 3,
+	RTP_PRIORITY_MAX   = 4,
+};
+
+// Leaky bucket pacer, driven by the connection's scheduler timer.
+// The budget grows with the pacing rate up to the burst size, a packet
+// is sent while the budget is positive and may leave it in debt.
+class RtpPacer
+{
+public:
+	RtpPacer();
+	virtual ~RtpPacer();
+
+	void SetPacingRate(uint32_t bitrate_bps);
+	void SetBurstTime(uint32_t burst_ms);
+
+	void EnqueuePacket(RtpPacketPtr rtp_pkt, RtpPacketPriority priority);
+
+	// moves the packets that fit into the budget to rtp_pkts, in priority order
+	void Process(std::vector<RtpPacketPtr>& rtp_pkts);
+
+	uint32_t GetPacingRate();
+	size_t GetQueueBytes();
+	int64_t GetQueueDelayMs();
+
+	// the same on a given steady clock time in us, a trace is replayed with these
+	void EnqueuePacket(RtpPacketPtr rtp_pkt, RtpPacketPriority priority, int64_t now_us);
+	void Process(std::vector<RtpPacketPtr>& rtp_pkts, int64_t now_us);
+	int64_t GetQueueDelayMs(int64_t now_us);
+
+private:
+	struct QueuedPacket
+	{
+		RtpPacketPtr rtp_pkt;
+		int64_t enqueue_time_us = 0;
+	};
+
+	static int64_t GetTimeNowUs();
+
+	std::deque<QueuedPacket> queues_[RTP_PRIORITY_MAX];
+	size_t queue_bytes_ = 0;
+
+	uint32_t pacing_rate_ = RTC_PACER_DEFAULT_BITRATE;
+	uint32_t burst_ms_ = RTC_PACER_BURST_MS;
+	int64_t budget_bytes_ = 0;
+	int64_t last_process_time_us_ = 0;
+};
@@ -0,0 +1,227 @@
+#include "rtp_packet_history.h"
+#include "rtc_common.h"
+#include <chrono>
+
+// a lost packet is nacked after about one rtt, the retransmission may be lost too
+static const uint32_t kRttMultiplier = 3;
+
+static const int64_t  kRateWindowMs = 1000;
+
+RtpPacketHistory::RtpPacketHistory()
+{
+	SetMaxBytes(RTC_RTX_HISTORY_MAX_BYTES);
+	SetMaxRtxRate(RTC_RTX_MAX_RATE_PERCENT);
+	SetRtt(0);
+}
+
+RtpPacketHistory::~RtpPacketHistory()
+{
+
+}
+
+int64_t RtpPacketHistory::GetTimeNowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RtpPacketHistory::SetSize(uint32_t size)
+{
+	uint32_t ring_size = 1;
+	while (ring_size < size && ring_size < (1 << 15)) {
+		ring_size <<= 1;
+	}
+
+	Clear();
+	entries_.clear();
+	entries_.shrink_to_fit();
+	entries_.resize(ring_size);
+	mask_ = ring_size - 1;
+}
+
+void RtpPacketHistory::SetMaxBytes(size_t max_bytes)
+{
+	max_bytes_ = max_bytes;
+}
+
+void RtpPacketHistory::SetMaxRtxRate(uint32_t percent)
+{
+	max_rtx_rate_ = percent;
+}
+
+void RtpPacketHistory::SetRtt(uint32_t rtt)
+{
+	uint32_t max_age_ms = rtt * kRttMultiplier;
+	if (max_age_ms < RTC_RTX_HISTORY_MIN_MS) {
+		max_age_ms = RTC_RTX_HISTORY_MIN_MS;
+	}
+	else if (max_age_ms > RTC_RTX_HISTORY_MAX_MS) {
+		max_age_ms = RTC_RTX_HISTORY_MAX_MS;
+	}
+	max_age_ms_ = max_age_ms;
+}
+
+int64_t RtpPacketHistory::Unwrap(uint16_t sequence)
+{
+	if (newest_seq_ < 0) {
+		return sequence;
+	}
+
+	int16_t delta = static_cast<int16_t>(sequence - static_cast<uint16_t>(newest_seq_));
+	return newest_seq_ + delta;
+}
+
+void RtpPacketHistory::Insert(uint16_t sequence, RtpPacketPtr rtp_pkt, bool is_shared)
+{
+	int64_t unwrapped_seq = Unwrap(sequence);
+	if (entries_.empty() || unwrapped_seq <= newest_seq_) {
+		return;
+	}
+
+	int64_t now_ms = GetTimeNowMs();
+	if (newest_seq_ < 0 || unwrapped_seq - newest_seq_ > (int64_t)mask_) {
+		Clear();
+		oldest_seq_ = unwrapped_seq;
+	}
+	newest_seq_ = unwrapped_seq;
+
+	// the slot still holds the packet one ring earlier
+	Entry& entry = entries_[unwrapped_seq & mask_];
+	Remove(entry);
+	if (oldest_seq_ <= unwrapped_seq - (int64_t)mask_ - 1) {
+		oldest_seq_ = unwrapped_seq - mask_;
+	}
+
+	entry.unwrapped_seq = unwrapped_seq;
+	entry.time_ms = now_ms;
+	entry.rtx_time_ms = 0;
+	entry.rtp_pkt = rtp_pkt;
+	entry.is_shared = is_shared;
+	packets_++;
+	bytes_ += xop::PacketPool::kBufferSize;
+	if (!is_shared) {
+		owned_bytes_ += xop::PacketPool::kBufferSize;
+	}
+
+	UpdateRateWindow(now_ms);
+	window_media_bytes_ += rtp_pkt->data_size;
+
+	Expire(now_ms);
+}
+
+RtpPacketPtr RtpPacketHistory::Get(uint16_t sequence)
+{
+	Entry* entry = Find(sequence, GetTimeNowMs());
+	if (!entry) {
+		return nullptr;
+	}
+
+	return entry->rtp_pkt;
+}
+
+RtxStatus RtpPacketHistory::GetForRetransmit(uint16_t sequence, uint32_t min_interval_ms, RtpPacketPtr& rtp_pkt)
+{
+	int64_t now_ms = GetTimeNowMs();
+	Entry* entry = Find(sequence, now_ms);
+	if (!entry) {
+		return RTX_STATUS_MISSING;
+	}
+
+	if (entry->rtx_time_ms != 0 && now_ms - entry->rtx_time_ms < min_interval_ms) {
+		return RTX_STATUS_SUPPRESSED;
+	}
+
+	// the budget follows the media of this window or, early in it, of the last one
+	UpdateRateWindow(now_ms);
+	size_t media_bytes = window_media_bytes_ > last_window_media_bytes_ ? window_media_bytes_ : last_window_media_bytes_;
+	if (window_rtx_bytes_ + entry->rtp_pkt->data_size > media_bytes * max_rtx_rate_ / 100) {
+		return RTX_STATUS_RATE_LIMITED;
+	}
+
+	window_rtx_bytes_ += entry->rtp_pkt->data_size;
+	entry->rtx_time_ms = now_ms;
+	rtp_pkt = entry->rtp_pkt;
+	return RTX_STATUS_OK;
+}
+
+void RtpPacketHistory::Clear()
+{
+	for (auto& entry : entries_) {
+		Remove(entry);
+	}
+
+	oldest_seq_ = 0;
+	newest_seq_ = -1;
+}
+
+RtpHistoryStats RtpPacketHistory::GetStats()
+{
+	RtpHistoryStats stats;
+	stats.packets = packets_;
+	stats.bytes = bytes_;
+	stats.owned_bytes = owned_bytes_;
+	stats.entry_bytes = entries_.capacity() * sizeof(Entry);
+	return stats;
+}
+
+RtpPacketHistory::Entry* RtpPacketHistory::Find(uint16_t sequence, int64_t now_ms)
+{
+	int64_t unwrapped_seq = Unwrap(sequence);
+	if (newest_seq_ < 0 || unwrapped_seq > newest_seq_ || unwrapped_seq < oldest_seq_) {
+		return nullptr;
+	}
+
+	Entry& entry = entries_[unwrapped_seq & mask_];
+	if (entry.unwrapped_seq != unwrapped_seq || !entry.rtp_pkt) {
+		return nullptr;
+	}
+
+	// no insert expired it while the stream was idle
+	if (now_ms - entry.time_ms > max_age_ms_) {
+		return nullptr;
+	}
+
+	return &entry;
+}
+
+void RtpPacketHistory::UpdateRateWindow(int64_t now_ms)
+{
+	if (now_ms - window_start_ms_ < kRateWindowMs) {
+		return;
+	}
+
+	// an idle window leaves nothing to follow
+	bool is_consecutive = now_ms - window_start_ms_ < 2 * kRateWindowMs;
+	last_window_media_bytes_ = is_consecutive ? window_media_bytes_ : 0;
+	window_media_bytes_ = 0;
+	window_rtx_bytes_ = 0;
+	window_start_ms_ = now_ms;
+}
+
+void RtpPacketHistory::Remove(Entry& entry)
+{
+	if (entry.rtp_pkt) {
+		packets_--;
+		bytes_ -= xop::PacketPool::kBufferSize;
+		if (!entry.is_shared) {
+			owned_bytes_ -= xop::PacketPool::kBufferSize;
+		}
+		entry.rtp_pkt = nullptr;
+	}
+	entry.unwrapped_seq = -1;
+}
+
+void RtpPacketHistory::Expire(int64_t now_ms)
+{
+	// the oldest packets go first, the newest one always stays
+	while (oldest_seq_ < newest_seq_) {
+		Entry& entry = entries_[oldest_seq_ & mask_];
+		if (entry.unwrapped_seq == oldest_seq_ && entry.rtp_pkt) {
+			if (now_ms - entry.time_ms <= max_age_ms_ && bytes_ <= max_bytes_) {
+				break;
+			}
+			Remove(entry);
+		}
+		oldest_seq_++;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "rtp.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum RtxStatus
+{
+	RTX_STATUS_OK           = 0,
+	RTX_STATUS_MISSING      = 1, // dropped from the history or never sent, only a key frame repairs it
+	RTX_STATUS_SUPPRESSED   = 2, // retransmitted less than the interval ago, the copy is on its way
+	RTX_STATUS_RATE_LIMITED = 3, // retransmissions used up their share of the media rate
+};
+
+struct RtpHistoryStats
+{
+	uint32_t packets = 0;
+	size_t bytes = 0;       // pooled buffers referenced by the history
+	size_t owned_bytes = 0; // the part not shared with other connections
+	size_t entry_bytes = 0; // the ring itself
+};
+
+// Media packets kept for retransmission, bounded by age and by bytes.
+// Slots are indexed by the low bits of the sequence, the unwrapped sequence
+// stored in each slot tells the packet from an older one that used it.
+// A packet built once by a shared source is only referenced, its header keeps
+// the sequence of the shared packetizer rather than ours, the payload is the same.
+// Retransmissions are limited to one per packet per interval and to a share of the media bytes.
+// Not thread safe, call it from the source's scheduler.
+class RtpPacketHistory
+{
+public:
+	RtpPacketHistory();
+	virtual ~RtpPacketHistory();
+
+	// size: slots, rounded up to a power of two, nothing is kept before it is set
+	void SetSize(uint32_t size);
+	void SetMaxBytes(size_t max_bytes);
+
+	// retransmitted bytes per window, percent of the media bytes
+	void SetMaxRtxRate(uint32_t percent);
+
+	// packets are kept for a few round trips, within the age bounds
+	void SetRtt(uint32_t rtt);
+
+	// sequence: ours, in sending order
+	void Insert(uint16_t sequence, RtpPacketPtr rtp_pkt, bool is_shared);
+
+	// null when the packet is too old or was dropped
+	RtpPacketPtr Get(uint16_t sequence);
+
+	// min_interval_ms: usually the smoothed rtt, a nack repeated within it is a duplicate.
+	// rtp_pkt is set on RTX_STATUS_OK only, the packet counts as retransmitted from now on
+	RtxStatus GetForRetransmit(uint16_t sequence, uint32_t min_interval_ms, RtpPacketPtr& rtp_pkt);
+
+	void Clear();
+
+	RtpHistoryStats GetStats();
+
+private:
+	struct Entry
+	{
+		int64_t unwrapped_seq = -1;
+		int64_t time_ms = 0;
+		int64_t rtx_time_ms = 0;
+		RtpPacketPtr rtp_pkt;
+		bool is_shared = false;
+	};
+
+	static int64_t GetTimeNowMs();
+
+	int64_t Unwrap(uint16_t sequence);
+	Entry* Find(uint16_t sequence, int64_t now_ms);
+	void UpdateRateWindow(int64_t now_ms);
+	void Remove(Entry& entry);
+	void Expire(int64_t now_ms);
+
+	std::vector<Entry> entries_;
+	uint32_t mask_ = 0;
+	size_t max_bytes_ = 0;
+	uint32_t max_age_ms_ = 0;
+
+	int64_t oldest_seq_ = 0;
+	int64_t newest_seq_ = -1;
+	uint32_t packets_ = 0;
+	size_t bytes_ = 0;
+	size_t owned_bytes_ = 0;
+
+	uint32_t max_rtx_rate_ = 0;
+	int64_t window_start_ms_ = 0;
+	size_t window_media_bytes_ = 0;
+	size_t last_window_media_bytes_ = 0;
+	size_t window_rtx_bytes_ = 0;
+};
@@ -1,5 +1,11 @@
 #include "rtp_source.h"
 
+// a duplicate nack within this interval is ignored even on a lan
+static const uint32_t kMinRetransmitIntervalMs = 10;
+
+// share of a nack that can no longer be retransmitted before a key frame is requested
+static const uint32_t kKeyFrameMissingPercent = 50;
+
 static uint32_t GetH264Timestamp()
 {
 	return static_cast<uint32_t>((std::chrono::time_point_cast<std::chrono::microseconds>(
@@ -24,7 +30,7 @@ void RtpSource::SetRtx(uint32_t ssrc, uint8_t payload_type)
 {
 	rtx_ssrc_ = ssrc;
 	rtx_payloa_type_ = payload_type;
-	rtp_cache_.resize(RTC_NACK_MAX_RTP_CACHE);
+	rtp_history_.SetSize(RTC_RTX_HISTORY_SIZE);
 }
 
 void RtpSource::SetFec(uint32_t fec_ssrc, uint8_t payload_type)
@@ -34,6 +40,11 @@ void RtpSource::SetFec(uint32_t fec_ssrc, uint8_t payload_type)
 	fec_encoder_ = std::make_shared<FecEncoder>(rtp_header_.ssrc, fec_ssrc, fec_payload_type_);
 }
 
+void RtpSource::SetFecEnabled(bool enabled)
+{
+	is_fec_enabled_ = enabled;
+}
+
 void RtpSource::SetExtension(RtpExtensionType ext_type)
 {
 	if (extension_pos_.count(ext_type)) {
@@ -47,8 +58,9 @@ void RtpSource::SetExtension(RtpExtensionType ext_type)
 	switch (ext_type)
 	{
 	case RTP_EXTENSION_TWCC:
+		// packets stamped from a shared source never go through BuildHeader
+		extension_pos_[RTP_EXTENSION_TWCC] = RTP_HEADER_SIZE + extension_size_ + 1;
 		extension_size_ += 4;
-		extension_pos_[RTP_EXTENSION_TWCC] = 0;
 		break;
 	default:
 		break;
@@ -88,10 +100,10 @@ uint32_t RtpSource::GetSSRC()
 	return rtp_header_.ssrc;
 }
 
-void RtpSource::BuildHeader(std::shared_ptr<RtpPacket> rtp_pkt)
+void RtpSource::BuildHeader(RtpPacketPtr rtp_pkt)
 {
-	uint8_t* rtp_header = rtp_pkt->data.get();
-	rtp_header[0] |= rtp_header_.version << 6;
+	uint8_t* rtp_header = rtp_pkt->data;
+	rtp_header[0] = rtp_header_.version << 6;
 	rtp_header[0] |= rtp_header_.padding << 5;
 	rtp_header[0] |= rtp_header_.extension << 4;
 	rtp_header[0] |= rtp_header_.csrc_count;
@@ -129,15 +141,16 @@ void RtpSource::BuildHeader(std::shared_ptr<RtpPacket> rtp_pkt)
 	rtp_pkt->marker = rtp_header_.marker;
 }
 
-void RtpSource::UpdateRtpCache(std::list<RtpPacketPtr>& rtp_pkts)
+void RtpSource::UpdateRtpCache(std::vector<RtpPacketPtr>& rtp_pkts)
 {
 	if (rtx_ssrc_ == 0) {
 		return;
 	}
 
-	for (auto pkt : rtp_pkts) {
+	for (auto& pkt : rtp_pkts) {
 		if (!pkt->is_rtx_) {
-			rtp_cache_[pkt->sequence % RTC_NACK_MAX_RTP_CACHE] = pkt;
+			pkt->is_cached_ = 1;
+			rtp_history_.Insert(pkt->sequence, pkt, false);
 		}
 	}
 }
@@ -147,91 +160,186 @@ void RtpSource::UpdateExtSequence(RtpPacketPtr& rtp_packet, uint16_t conn_seq)
 	if (extension_pos_.count(RTP_EXTENSION_TWCC)) {
 		uint32_t ext_pos = extension_pos_[RTP_EXTENSION_TWCC];
 		if (ext_pos != 0) {
-			WriteUint16BE(rtp_packet->data.get() + ext_pos, conn_seq);
+			WriteUint16BE(rtp_packet->data + ext_pos, conn_seq);
 		}
 	}
 }
 
 void RtpSource::UpdateQoS(uint32_t rtt, uint32_t loss_rate)
+{
+	UpdateQoS(rtt, loss_rate, loss_burst_);
+}
+
+void RtpSource::UpdateQoS(uint32_t rtt, uint32_t loss_rate, uint32_t loss_burst)
 {
 	rtt_ = rtt;
 	smooth_rtt_ = (smooth_rtt_ * 3 + rtt_ * 1) >> 2; // 3/4 + 1/4
 	loss_rate_ = loss_rate;
+	rtp_history_.SetRtt(smooth_rtt_);
 
 	if (fec_encoder_) {
-		fec_encoder_->UpdateLossRate(loss_rate);
+		fec_encoder_->UpdateNetworkState(loss_rate, loss_burst, smooth_rtt_);
 	}
 }
 
-void RtpSource::RetransmitRtpPackets(std::vector<uint16_t>& lost_seqs)
+uint32_t RtpSource::GetLossBurst()
 {
-	if (rtx_ssrc_ == 0) {
-		return;
+	return loss_burst_;
+}
+
+RtpHistoryStats RtpSource::GetHistoryStats()
+{
+	return rtp_history_.GetStats();
+}
+
+bool RtpSource::RetransmitRtpPackets(std::vector<uint16_t>& lost_seqs)
+{
+	// a lost packet next to another lost one counts as burst loss
+	uint32_t burst_lost = 0;
+	for (size_t n = 0; n < lost_seqs.size(); n++) {
+		bool has_prev = n > 0 && static_cast<uint16_t>(lost_seqs[n] - lost_seqs[n - 1]) == 1;
+		bool has_next = n + 1 < lost_seqs.size() && static_cast<uint16_t>(lost_seqs[n + 1] - lost_seqs[n]) == 1;
+		if (has_prev || has_next) {
+			burst_lost++;
+		}
+	}
+	if (!lost_seqs.empty()) {
+		uint32_t loss_burst = static_cast<uint32_t>(burst_lost * 100 / lost_seqs.size());
+		loss_burst_ = (loss_burst_ * 3 + loss_burst * 1) >> 2; // 3/4 + 1/4
+	}
+
+	if (rtx_ssrc_ == 0 || lost_seqs.empty()) {
+		return false;
 	}
 
-	std::list<RtpPacketPtr> rtx_pkts;
+	// chrome repeats a nack until the packet arrives, one copy per rtt is enough
+	uint32_t min_interval = smooth_rtt_ > kMinRetransmitIntervalMs ? smooth_rtt_ : kMinRetransmitIntervalMs;
+	uint32_t num_missing = 0;
+	uint32_t num_limited = 0;
+
+	rtx_pkts_.clear();
 	for (auto lost_seq :  lost_seqs) {
-		auto rtp_packet = rtp_cache_[lost_seq % RTC_NACK_MAX_RTP_CACHE];
-		if (rtp_packet) {
-			auto rtx_packet = std::make_shared<RtpPacket>();
+		RtpPacketPtr rtp_packet;
+		RtxStatus status = rtp_history_.GetForRetransmit(lost_seq, min_interval, rtp_packet);
+		if (status == RTX_STATUS_MISSING) {
+			num_missing++;
+		}
+		else if (status == RTX_STATUS_RATE_LIMITED) {
+			num_limited++;
+		}
+		else if (status == RTX_STATUS_OK) {
+			auto rtx_packet = RtpPacket::Create();
 			BuildHeader(rtx_packet);
-			uint8_t* rtx_header = rtx_packet->data.get();
+			uint8_t* rtx_header = rtx_packet->data;
 			rtx_header[1] = rtp_packet->marker << 7 | rtx_payloa_type_;
 			WriteUint16BE(&rtx_header[2], rtx_seq_++);
 			WriteUint32BE(&rtx_header[4], rtp_packet->timestamp);
 			WriteUint32BE(&rtx_header[8], rtx_ssrc_);
 
-			WriteUint16BE(&rtx_header[header_size_], rtp_packet->sequence);
-			memcpy(rtx_packet->data.get() + header_size_ + sizeof(rtp_packet->sequence),
-				rtp_packet->data.get() + header_size_, rtp_packet->data_size - header_size_);
-			rtx_packet->data_size =  rtp_packet->data_size + sizeof(rtp_packet->sequence);
+			WriteUint16BE(&rtx_header[header_size_], lost_seq);
+			memcpy(rtx_packet->data + header_size_ + sizeof(lost_seq),
+				rtp_packet->data + header_size_, rtp_packet->data_size - header_size_);
+			rtx_packet->data_size =  rtp_packet->data_size + sizeof(lost_seq);
 			rtx_packet->ssrc = rtp_header_.ssrc;
 			rtx_packet->is_rtx_ = 1;
-			rtx_pkts.push_back(rtx_packet);
+			rtx_pkts_.push_back(std::move(rtx_packet));
 			// RTC_LOG_INFO("retrans rtp:{} --> rtx:{}", rtp_packet->sequence, rtx_seq_ - 1);
 		}
 	}
 
-	if (!rtx_pkts.empty() && send_pkt_callback_) {
-		send_pkt_callback_(rtx_pkts);
+	SendRtpPackets(rtx_pkts_);
+
+	if (num_limited > 0) {
+		RTC_LOG_INFO("rtx rate limited, ssrc:{} lost:{} dropped:{}", rtp_header_.ssrc, lost_seqs.size(), num_limited);
 	}
+
+	return num_missing * 100 >= lost_seqs.size() * kKeyFrameMissingPercent;
 }
 
-void RtpSource::GeneratedFecPacket(std::list<RtpPacketPtr>& rtp_pkts)
+void RtpSource::InputRtpPackets(const std::vector<RtpPacketPtr>& shared_pkts)
 {
-	if (fec_ssrc_ == 0) {
-		return;
-	}
+	rtp_pkts_.clear();
+	uint16_t seq_delta = 0;
 
-	std::list<RtpPacketPtr> rtp_fec_pkts;
-	for (auto rtp_pkt : rtp_pkts) {
-		fec_encoder_->AddRtpPacket(rtp_pkt);
+	// the header layout matches ours, only ssrc and sequences are rewritten
+	for (auto& shared_pkt : shared_pkts) {
+		if (shared_pkt->is_fec_ && (fec_ssrc_ == 0 || !is_fec_enabled_ || shared_pkt->data_size < header_size_ + 18)) {
+			continue;
+		}
 
-		std::list<webrtc::ForwardErrorCorrection::Packet*> fec_packets;
-		fec_encoder_->GetFecPackets(fec_packets);
+		auto rtp_pkt = RtpPacket::Create();
+		memcpy(rtp_pkt->data, shared_pkt->data, shared_pkt->data_size);
+		rtp_pkt->data_size = shared_pkt->data_size;
+		rtp_pkt->timestamp = shared_pkt->timestamp;
+		rtp_pkt->marker = shared_pkt->marker;
+		rtp_pkt->frame_type = shared_pkt->frame_type;
+		rtp_pkt->ssrc = rtp_header_.ssrc;
+
+		uint8_t* rtp_header = rtp_pkt->data;
+		if (shared_pkt->is_fec_) {
+			rtp_pkt->is_fec_ = 1;
+			WriteUint16BE(&rtp_header[2], fec_seq_++);
+			WriteUint32BE(&rtp_header[8], fec_ssrc_);
+
+			// flexfec header: protected ssrc at 12, sequence number base at 16,
+			// the media packets of a frame keep their spacing so the masks still apply
+			uint8_t* fec_header = rtp_header + header_size_;
+			uint16_t seq_base = ReadU16BE(&fec_header[16], 2) + seq_delta;
+			WriteUint32BE(&fec_header[12], rtp_header_.ssrc);
+			WriteUint16BE(&fec_header[16], seq_base);
+		}
+		else {
+			rtp_pkt->sequence = sequence_++;
+			seq_delta = rtp_pkt->sequence - shared_pkt->sequence;
+			WriteUint16BE(&rtp_header[2], rtp_pkt->sequence);
+			WriteUint32BE(&rtp_header[8], rtp_header_.ssrc);
+
+			// the shared packet stays plaintext for rtx, our copy is protected in place
+			if (rtx_ssrc_ != 0) {
+				rtp_history_.Insert(rtp_pkt->sequence, shared_pkt, true);
+			}
+		}
 
-		if (!fec_packets.empty()) {
-			for (const auto* fec_pkt : fec_packets) {
-				auto rtp_fec_packet = std::make_shared<RtpPacket>();
-				BuildHeader(rtp_fec_packet);
-				rtp_fec_packet->ssrc = rtp_header_.ssrc;
-				rtp_fec_packet->is_fec_ = 1;
-				rtp_fec_packet->marker = 0;
+		rtp_pkts_.push_back(std::move(rtp_pkt));
+	}
 
-				uint8_t* rtp_header = rtp_fec_packet->data.get();
-				rtp_header[1] = rtp_fec_packet->marker << 7 | fec_payload_type_;
-				WriteUint16BE(&rtp_header[2], fec_seq_++);
-				WriteUint32BE(&rtp_header[4], GetH264Timestamp());
-				WriteUint32BE(&rtp_header[8], fec_ssrc_);
+	SendRtpPackets(rtp_pkts_);
+}
 
-				memcpy(rtp_fec_packet->data.get() + header_size_, fec_pkt->data.cdata(), fec_pkt->data.size());
-				rtp_fec_packet->data_size = header_size_ + static_cast<uint32_t>(fec_pkt->data.size());
-				rtp_fec_pkts.push_back(rtp_fec_packet);
-			}
-		}
+void RtpSource::GeneratedFecPacket(std::vector<RtpPacketPtr>& rtp_pkts)
+{
+	if (fec_ssrc_ == 0 || !is_fec_enabled_ || rtp_pkts.empty()) {
+		return;
+	}
+
+	// the encoder writes the flexfec header and payload after our rtp header
+	fec_pkts_.clear();
+	bool is_keyframe = rtp_pkts.front()->frame_type == RTC_H264_FRAME_TYPE_IDR;
+	fec_encoder_->EncodeFrame(rtp_pkts, is_keyframe, header_size_, fec_pkts_);
+
+	for (auto& rtp_fec_packet : fec_pkts_) {
+		BuildHeader(rtp_fec_packet);
+		rtp_fec_packet->ssrc = rtp_header_.ssrc;
+		rtp_fec_packet->is_fec_ = 1;
+		rtp_fec_packet->marker = 0;
+
+		uint8_t* rtp_header = rtp_fec_packet->data;
+		rtp_header[1] = rtp_fec_packet->marker << 7 | fec_payload_type_;
+		WriteUint16BE(&rtp_header[2], fec_seq_++);
+		WriteUint32BE(&rtp_header[4], GetH264Timestamp());
+		WriteUint32BE(&rtp_header[8], fec_ssrc_);
 	}
 
-	if (!rtp_fec_pkts.empty()) {
-		rtp_pkts.insert(rtp_pkts.end(), rtp_fec_pkts.begin(), rtp_fec_pkts.end());
+	for (auto& rtp_fec_packet : fec_pkts_) {
+		rtp_pkts.push_back(std::move(rtp_fec_packet));
+	}
+	fec_pkts_.clear();
+}
+
+void RtpSource::SendRtpPackets(std::vector<RtpPacketPtr>& rtp_pkts)
+{
+	if (!rtp_pkts.empty() && send_pkt_callback_) {
+		send_pkt_callback_(rtp_pkts);
 	}
+	rtp_pkts.clear();
 }
\ No newline at end of file
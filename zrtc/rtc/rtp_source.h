@@ -2,38 +2,57 @@
 
 #include "rtc_common.h"
 #include "fec_encoder.h"
+#include "rtp_packet_history.h"
 #include <chrono>
 #include <vector>
 
 class RtpSource
 {
 public:
-	using SendPacketCallback = std::function<void(std::list<RtpPacketPtr> rtp_pkts)>;
+	// the packets are lent for the call, a receiver that keeps them swaps them out,
+	// the vector is cleared and reused for the next frame
+	using SendPacketCallback = std::function<void(std::vector<RtpPacketPtr>& rtp_pkts)>;
 
 	RtpSource(uint32_t ssrc, uint8_t payload_type);
 	virtual ~RtpSource();
 
 	virtual void SetRtx(uint32_t rtx_ssrc, uint8_t payload_type);
 	virtual void SetFec(uint32_t fec_ssrc, uint8_t payload_type);
+	// disabled fec is neither generated nor forwarded, the negotiated stream stays
+	virtual void SetFecEnabled(bool enabled);
 	virtual void SetExtension(RtpExtensionType ext_type);
 	virtual void SetTimestamp(uint32_t timestamp);
 	virtual void SetMarker(uint8_t marker);
 	virtual void SetSequence(uint32_t sequence);
-	virtual void BuildHeader(std::shared_ptr<RtpPacket> rtp_pkt);
-	virtual void RetransmitRtpPackets(std::vector<uint16_t>& lost_seqs);
+	virtual void BuildHeader(RtpPacketPtr rtp_pkt);
+	// returns true when most of the lost packets are gone from the history, only a key frame repairs them
+	virtual bool RetransmitRtpPackets(std::vector<uint16_t>& lost_seqs);
+	// stamps our ssrc and sequences on packets built once by a shared source, fec included
+	virtual void InputRtpPackets(const std::vector<RtpPacketPtr>& shared_pkts);
 	virtual void SetSendPacketCallback(const SendPacketCallback& callback);
 	virtual uint32_t GetTimestamp();
 	virtual uint32_t GetSSRC();
 
 	virtual void UpdateExtSequence(RtpPacketPtr& rtp_packet, uint16_t conn_seq);
 	virtual void UpdateQoS(uint32_t rtt, uint32_t loss_rate);
+	// loss_burst: percent of the lost packets next to another lost one
+	virtual void UpdateQoS(uint32_t rtt, uint32_t loss_rate, uint32_t loss_burst);
+	// measured on the nack lists of this source
+	virtual uint32_t GetLossBurst();
+
+	virtual RtpHistoryStats GetHistoryStats();
 
 protected:
-	void UpdateRtpCache(std::list<RtpPacketPtr>& rtp_pkts);
-	void GeneratedFecPacket(std::list<RtpPacketPtr>& rtp_pkts);
+	void UpdateRtpCache(std::vector<RtpPacketPtr>& rtp_pkts);
+	void GeneratedFecPacket(std::vector<RtpPacketPtr>& rtp_pkts);
+	void SendRtpPackets(std::vector<RtpPacketPtr>& rtp_pkts);
 
 	RtpHeader rtp_header_ = {};
 	SendPacketCallback send_pkt_callback_;
+	// reused for every frame, a steady stream of frames allocates no containers
+	std::vector<RtpPacketPtr> rtp_pkts_;
+	std::vector<RtpPacketPtr> rtx_pkts_;
+	std::vector<RtpPacketPtr> fec_pkts_;
 	uint32_t header_size_ = 0;
 	uint32_t extension_size_ = 0;
 	uint16_t sequence_ = 1;
@@ -42,16 +61,18 @@ protected:
 	uint16_t rtx_seq_ = 1;
 	uint32_t rtx_ssrc_ = 0;
 	uint32_t rtx_payloa_type_ = 0;
-	std::vector<RtpPacketPtr> rtp_cache_;
+	RtpPacketHistory rtp_history_;
 
 	uint16_t fec_seq_ = 1;
 	uint32_t fec_ssrc_ = 0;
 	uint32_t fec_payload_type_ = 0;
+	bool is_fec_enabled_ = true;
 	std::shared_ptr<FecEncoder> fec_encoder_;
 
 	uint32_t rtt_ = 0;
 	uint32_t smooth_rtt_ = 0;
 	uint32_t loss_rate_ = 0;
+	uint32_t loss_burst_ = 0;
 
 	std::map<RtpExtensionType, uint32_t> extension_pos_;
 };
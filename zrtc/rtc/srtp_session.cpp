@@ -10,12 +10,93 @@ SrtpSession::~SrtpSession()
 	Destroy();
 }
 
-bool SrtpSession::Init(std::string send_key, std::string recv_key)
+static bool SetCryptoPolicy(RtcSrtpProfile profile, srtp_policy_t* srtp_policy)
 {
+	switch (profile)
+	{
+	case RTC_SRTP_AES128_CM_SHA1_80:
+		srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&srtp_policy->rtp);
+		srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&srtp_policy->rtcp);
+		return true;
+	case RTC_SRTP_AEAD_AES_128_GCM:
+		srtp_crypto_policy_set_aes_gcm_128_16_auth(&srtp_policy->rtp);
+		srtp_crypto_policy_set_aes_gcm_128_16_auth(&srtp_policy->rtcp);
+		return true;
+	case RTC_SRTP_AEAD_AES_256_GCM:
+		srtp_crypto_policy_set_aes_gcm_256_16_auth(&srtp_policy->rtp);
+		srtp_crypto_policy_set_aes_gcm_256_16_auth(&srtp_policy->rtcp);
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+uint32_t SrtpSession::GetKeyLength(RtcSrtpProfile profile)
+{
+	switch (profile)
+	{
+	case RTC_SRTP_AES128_CM_SHA1_80:
+	case RTC_SRTP_AEAD_AES_128_GCM:
+		return RTC_SRTP_KEY_LEN;
+	case RTC_SRTP_AEAD_AES_256_GCM:
+		return RTC_SRTP_AES256_KEY_LEN;
+	default:
+		break;
+	}
+	return 0;
+}
+
+uint32_t SrtpSession::GetSaltLength(RtcSrtpProfile profile)
+{
+	switch (profile)
+	{
+	case RTC_SRTP_AES128_CM_SHA1_80:
+		return RTC_SRTP_SALT_LEN;
+	case RTC_SRTP_AEAD_AES_128_GCM:
+	case RTC_SRTP_AEAD_AES_256_GCM:
+		return RTC_SRTP_GCM_SALT_LEN;
+	default:
+		break;
+	}
+	return 0;
+}
+
+bool SrtpSession::IsGcmSupported()
+{
+	static bool is_supported = false;
+	static std::once_flag flag;
+	std::call_once(flag, [] {
+		srtp_policy_t srtp_policy;
+		memset(&srtp_policy, 0, sizeof(srtp_policy_t));
+		SetCryptoPolicy(RTC_SRTP_AEAD_AES_128_GCM, &srtp_policy);
+
+		unsigned char key[RTC_SRTP_KEY_LEN + RTC_SRTP_GCM_SALT_LEN] = { 0 };
+		srtp_policy.key = key;
+		srtp_policy.ssrc.type = ssrc_any_outbound;
+		srtp_policy.window_size = 4096;
+
+		srtp_t session = nullptr;
+		is_supported = srtp_create(&session, &srtp_policy) == srtp_err_status_ok;
+		if (session != nullptr) {
+			srtp_dealloc(session);
+		}
+	});
+	return is_supported;
+}
+
+bool SrtpSession::Init(RtcSrtpProfile profile, std::string send_key, std::string recv_key)
+{
+	uint32_t key_len = GetKeyLength(profile) + GetSaltLength(profile);
+	if (GetKeyLength(profile) == 0 || send_key.size() != key_len || recv_key.size() != key_len) {
+		RTC_LOG_ERROR("srtp key mismatch, profile:{} send-key:{} recv-key:{}",
+			(int)profile, send_key.size(), recv_key.size());
+		return false;
+	}
+
 	srtp_policy_t srtp_policy;
 	memset(&srtp_policy, 0, sizeof(srtp_policy_t));
-	srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&srtp_policy.rtp);
-	srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&srtp_policy.rtcp);
+	SetCryptoPolicy(profile, &srtp_policy);
 	srtp_policy.ssrc.value = 0;
 	srtp_policy.window_size = 4096;
 	srtp_policy.next = NULL;
@@ -30,6 +111,13 @@ bool SrtpSession::Init(std::string send_key, std::string recv_key)
 		goto failed;
 	}
 
+	// rtcp has a send session of its own, rtp may be protected on another thread
+	status = srtp_create(&rtcp_send_session_, &srtp_policy);
+	if (status != srtp_err_status_ok) {
+		RTC_LOG_ERROR("srtp_create failed, status:{}", (int)status);
+		goto failed;
+	}
+
 	// recv session
 	srtp_policy.key = (unsigned char*)recv_key.c_str();
 	srtp_policy.ssrc.type = ssrc_any_inbound;
@@ -46,6 +134,10 @@ failed:
 		srtp_dealloc(send_session_);
 		send_session_ = nullptr;
 	}
+	if (rtcp_send_session_ != nullptr) {
+		srtp_dealloc(rtcp_send_session_);
+		rtcp_send_session_ = nullptr;
+	}
 	if (recv_session_ != nullptr) {
 		srtp_dealloc(recv_session_);
 		recv_session_ = nullptr;
@@ -60,6 +152,11 @@ void SrtpSession::Destroy()
 		send_session_ = nullptr;
 	}
 
+	if (rtcp_send_session_ != nullptr) {
+		srtp_dealloc(rtcp_send_session_);
+		rtcp_send_session_ = nullptr;
+	}
+
 	if (recv_session_ != nullptr) {
 		srtp_dealloc(recv_session_);
 		recv_session_ = nullptr;
@@ -81,7 +178,10 @@ int SrtpSession::ProtectRtp(uint8_t* pkt, int len)
 
 int SrtpSession::ProtectRtcp(uint8_t* pkt, int len)
 {
-	srtp_err_status_t status = srtp_protect_rtcp(send_session_, pkt, &len);
+	if (!rtcp_send_session_) {
+		return 0;
+	}
+	srtp_err_status_t status = srtp_protect_rtcp(rtcp_send_session_, pkt, &len);
 	if (status != srtp_err_status_ok) {
 		RTC_LOG_ERROR("srtp_protect_rtcp failed, status:{}", (int)status);
 		return -1;
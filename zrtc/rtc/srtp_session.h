@@ -2,6 +2,8 @@
 
 #include "rtc_common.h"
 #include "srtp.h"
+#include <mutex>
+#include <string>
 
 class SrtpSession
 {
@@ -9,16 +11,27 @@ public:
 	SrtpSession();
 	virtual ~SrtpSession();
 
-	bool Init(std::string send_key, std::string recv_key);
+	// key: master key followed by the master salt, sized for the profile
+	bool Init(RtcSrtpProfile profile, std::string send_key, std::string recv_key);
 	void Destroy();
 
+	// rtp and rtcp are protected with separate libsrtp sessions,
+	// each of the two may be used from its own thread
 	int ProtectRtp(uint8_t* pkt, int len);
 	int ProtectRtcp(uint8_t* pkt, int len);
 	int UnprotectRtp(uint8_t* pkt, int len);
 	int UnprotectRtcp(uint8_t* pkt, int len);
 
+	// 0 for a profile we do not support
+	static uint32_t GetKeyLength(RtcSrtpProfile profile);
+	static uint32_t GetSaltLength(RtcSrtpProfile profile);
+
+	// aes-gcm is only built into libsrtp with its openssl backend, checked once per process
+	static bool IsGcmSupported();
+
 private:
 	srtp_t send_session_ = nullptr;
+	srtp_t rtcp_send_session_ = nullptr;
 	srtp_t recv_session_ = nullptr;
 };
 
@@ -0,0 +1,120 @@
+#include "srtp_worker_pool.h"
+
+// a busy connection hands the worker over after a few batches
+static const uint32_t kMaxTasksPerTurn = 4;
+
+// batches of one connection waiting for a worker, about one second of pacer intervals
+static const size_t kMaxQueueTasks = 256;
+
+SrtpWorkerPool::Queue::Queue(SrtpWorkerPool* pool)
+	: pool_(pool)
+{
+
+}
+
+bool SrtpWorkerPool::Queue::Post(xop::Task task)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	if (is_closed_ || tasks_.size() >= kMaxQueueTasks) {
+		return false;
+	}
+
+	tasks_.push_back(std::move(task));
+	if (!is_scheduled_) {
+		is_scheduled_ = true;
+		pool_->Schedule(shared_from_this());
+	}
+	return true;
+}
+
+void SrtpWorkerPool::Queue::Close()
+{
+	std::unique_lock<std::mutex> locker(mutex_);
+	is_closed_ = true;
+	tasks_.clear();
+	cond_.wait(locker, [this] { return !is_running_; });
+}
+
+SrtpWorkerPool::SrtpWorkerPool(uint32_t num_threads)
+{
+	num_threads = num_threads > 0 ? num_threads : 1;
+	for (uint32_t n = 0; n < num_threads; n++) {
+		threads_.emplace_back(&SrtpWorkerPool::Run, this);
+	}
+}
+
+SrtpWorkerPool::~SrtpWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+		is_stopped_ = true;
+	}
+	cond_.notify_all();
+
+	for (auto& thread : threads_) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+}
+
+std::shared_ptr<SrtpWorkerPool::Queue> SrtpWorkerPool::CreateQueue()
+{
+	return std::shared_ptr<Queue>(new Queue(this));
+}
+
+void SrtpWorkerPool::Schedule(std::shared_ptr<Queue> queue)
+{
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+		ready_queues_.push_back(std::move(queue));
+	}
+	cond_.notify_one();
+}
+
+void SrtpWorkerPool::Run()
+{
+	for (;;) {
+		std::shared_ptr<Queue> queue;
+		{
+			std::unique_lock<std::mutex> locker(mutex_);
+			cond_.wait(locker, [this] { return is_stopped_ || !ready_queues_.empty(); });
+			if (is_stopped_) {
+				return;
+			}
+			queue = std::move(ready_queues_.front());
+			ready_queues_.pop_front();
+		}
+
+		// the queue is ours until it is empty or its turn is over
+		for (uint32_t n = 0; n < kMaxTasksPerTurn; n++) {
+			xop::Task task;
+			{
+				std::lock_guard<std::mutex> locker(queue->mutex_);
+				if (queue->tasks_.empty() || queue->is_closed_) {
+					break;
+				}
+				task = std::move(queue->tasks_.front());
+				queue->tasks_.pop_front();
+				queue->is_running_ = true;
+			}
+
+			task();
+			task.Reset();
+
+			{
+				std::lock_guard<std::mutex> locker(queue->mutex_);
+				queue->is_running_ = false;
+			}
+			queue->cond_.notify_all();
+		}
+
+		std::lock_guard<std::mutex> locker(queue->mutex_);
+		if (queue->tasks_.empty() || queue->is_closed_) {
+			queue->is_scheduled_ = false;
+		}
+		else {
+			Schedule(queue);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "net/TaskQueue.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the srtp protection of many connections on a few threads.
+// Each connection posts to its own queue, the tasks of one queue run in order
+// and never at the same time, as the per-stream state of libsrtp requires.
+class SrtpWorkerPool
+{
+public:
+	class Queue : public std::enable_shared_from_this<Queue>
+	{
+	public:
+		// false once the queue is closed or full, the task is dropped
+		bool Post(xop::Task task);
+
+		// drops the waiting tasks and waits for the running one,
+		// no task of the queue runs once it returns, not to be called from a task
+		void Close();
+
+	private:
+		friend class SrtpWorkerPool;
+		explicit Queue(SrtpWorkerPool* pool);
+
+		SrtpWorkerPool* pool_ = nullptr;
+		std::mutex mutex_;
+		std::condition_variable cond_;
+		std::deque<xop::Task> tasks_;
+		bool is_scheduled_ = false;
+		bool is_running_ = false;
+		bool is_closed_ = false;
+	};
+
+	SrtpWorkerPool(uint32_t num_threads);
+	virtual ~SrtpWorkerPool();
+
+	// the pool must outlive its queues
+	std::shared_ptr<Queue> CreateQueue();
+
+private:
+	void Schedule(std::shared_ptr<Queue> queue);
+	void Run();
+
+	std::mutex mutex_;
+	std::condition_variable cond_;
+	std::deque<std::shared_ptr<Queue>> ready_queues_;
+	std::vector<std::thread> threads_;
+	bool is_stopped_ = false;
+};
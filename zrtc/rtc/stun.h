@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 
 enum StunMessageType {
 	STUN_MESSAGE_UNKNOW = 0x0000,
@@ -94,3 +95,29 @@ static bool IsStunPacket(const uint8_t* data, size_t size)
 
 	return true;
 }
+
+// USERNAME: "<receiver ufrag>:<sender ufrag>"
+static std::string GetStunUsername(const uint8_t* data, size_t size)
+{
+	if (!IsStunPacket(data, size)) {
+		return "";
+	}
+
+	size_t pos = STUN_HEADER_SIZE;
+	while (pos + STUN_ATTRIBUTE_HEADER_SIZE <= size) {
+		uint16_t attr_type = (data[pos] << 8) | data[pos + 1];
+		uint16_t attr_length = (data[pos + 2] << 8) | data[pos + 3];
+		pos += STUN_ATTRIBUTE_HEADER_SIZE;
+		if (pos + attr_length > size) {
+			break;
+		}
+
+		if (attr_type == STUN_ATTR_USERNAME) {
+			return std::string(reinterpret_cast<const char*>(data + pos), attr_length);
+		}
+
+		pos += (attr_length + 3) & ~3;
+	}
+
+	return "";
+}
@@ -1,6 +1,10 @@
 #include "stun_sink.h"
 #include "rtc_common.h"
 
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
 StunSink::StunSink()
 {
 
@@ -76,3 +80,53 @@ std::string StunSink::GetMessageIntegrity() const
 {
 	return message_integrity_;
 }
+
+bool StunSink::CheckMessageIntegrity(const uint8_t* data, size_t size, const std::string& password)
+{
+	if (!IsStunPacket(data, size) || password.empty()) {
+		return false;
+	}
+
+	size_t pos = STUN_HEADER_SIZE;
+	while (pos + STUN_ATTRIBUTE_HEADER_SIZE <= size) {
+		uint16_t attr_type = (data[pos] << 8) | data[pos + 1];
+		uint16_t attr_length = (data[pos + 2] << 8) | data[pos + 3];
+		if (pos + STUN_ATTRIBUTE_HEADER_SIZE + attr_length > size) {
+			return false;
+		}
+
+		if (attr_type != STUN_ATTR_MESSAGE_INTEGRITY) {
+			pos += STUN_ATTRIBUTE_HEADER_SIZE + ((attr_length + 3) & ~3);
+			continue;
+		}
+
+		if (attr_length != 20) {
+			return false;
+		}
+
+		// the length field counts up to the end of MESSAGE-INTEGRITY, a FINGERPRINT after it is left out
+		uint8_t header[STUN_HEADER_SIZE];
+		memcpy(header, data, STUN_HEADER_SIZE);
+		uint16_t length = (uint16_t)(pos + STUN_ATTRIBUTE_HEADER_SIZE + 20 - STUN_HEADER_SIZE);
+		header[2] = (uint8_t)(length >> 8);
+		header[3] = (uint8_t)(length & 0xff);
+
+		unsigned char hmac[EVP_MAX_MD_SIZE] = { 0 };
+		unsigned int hmac_len = 0;
+		HMAC_CTX* hmac_ctx = HMAC_CTX_new();
+		if (hmac_ctx == nullptr) {
+			return false;
+		}
+
+		bool is_ok = HMAC_Init_ex(hmac_ctx, password.c_str(), (int)password.length(), EVP_sha1(), NULL) > 0
+			&& HMAC_Update(hmac_ctx, header, STUN_HEADER_SIZE) > 0
+			&& HMAC_Update(hmac_ctx, data + STUN_HEADER_SIZE, pos - STUN_HEADER_SIZE) > 0
+			&& HMAC_Final(hmac_ctx, hmac, &hmac_len) > 0;
+		HMAC_CTX_free(hmac_ctx);
+
+		return is_ok && hmac_len == 20
+			&& CRYPTO_memcmp(hmac, data + pos + STUN_ATTRIBUTE_HEADER_SIZE, 20) == 0;
+	}
+
+	return false;
+}
@@ -16,6 +16,9 @@ public:
 	std::string GetAttrUserName() const;
 	std::string GetMessageIntegrity() const;
 
+	// HMAC-SHA1 of the message up to its MESSAGE-INTEGRITY, keyed with the short term password
+	static bool CheckMessageIntegrity(const uint8_t* data, size_t size, const std::string& password);
+
 private:
 	uint16_t message_type_ = 0;
 	uint32_t message_length_ = 0;
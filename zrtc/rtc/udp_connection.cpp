@@ -1,8 +1,9 @@
 #include "udp_connection.h"
-#include "net/SocketUtil.h"
+#include "udp_demuxer.h"
 
 UdpConnection::UdpConnection(std::shared_ptr<xop::EventLoop> event_loop)
 	: event_loop_(event_loop)
+	, task_scheduler_(event_loop->GetTaskScheduler())
 {
 
 }
@@ -12,47 +13,35 @@ UdpConnection::~UdpConnection()
 
 }
 
-bool UdpConnection::Init(std::string ip, uint16_t port)
+bool UdpConnection::Init(std::shared_ptr<UdpDemuxer> udp_demuxer)
 {
-	socket_ = ::socket(AF_INET, SOCK_DGRAM, 0);
-	xop::SocketUtil::SetSendBufSize(socket_, 50 * 1024);
-	if (!xop::SocketUtil::Bind(socket_, ip, port)) {
-		xop::SocketUtil::Close(socket_);
-		socket_ = 0;
+	if (!udp_demuxer) {
 		return false;
 	}
 
-	channel_.reset(new xop::Channel(socket_));
-	channel_->SetReadCallback([this]() { this->OnRecv(); });
-	channel_->EnableReading();
-	event_loop_->UpdateChannel(channel_);
-
+	udp_demuxer_ = udp_demuxer;
+	socket_index_ = udp_demuxer_->GetSocketIndex(task_scheduler_);
+	local_ip_ = udp_demuxer_->GetLocalIp();
+	local_port_ = udp_demuxer_->GetLocalPort();
 	return true;
 }
 
 void UdpConnection::Destroy()
 {
-	if (channel_ && event_loop_) {
-		event_loop_->RemoveChannel(channel_);
-		channel_.reset();
-	}
-
-	if (socket_) {
-		xop::SocketUtil::Close(socket_);
-		socket_ = 0;
+	if (udp_demuxer_) {
+		udp_demuxer_->RemoveConnection(this);
+		udp_demuxer_.reset();
 	}
 }
 
-void UdpConnection::OnRecv()
+void UdpConnection::SetPeerAddress(const sockaddr_in& peer_addr)
 {
-	sockaddr_in peer_addr = {};
-	socklen_t addr_len = sizeof(sockaddr_in);
+	peer_addr_ = peer_addr;
+}
 
-	uint8_t buf[1500] = { 0 };
-	int recv_bytes = recvfrom(socket_, (char*)buf, sizeof(buf), 0, (sockaddr*)&peer_addr, &addr_len);
-	memcpy_s(&peer_addr_, sizeof(sockaddr_in), &peer_addr, sizeof(sockaddr_in));
+void UdpConnection::OnBind()
+{
 
-	OnRecv(buf, recv_bytes);
 }
 
 void UdpConnection::OnRecv(uint8_t* buf, size_t recv_bytes)
@@ -62,12 +51,18 @@ void UdpConnection::OnRecv(uint8_t* buf, size_t recv_bytes)
 
 int UdpConnection::OnSend(uint8_t* pkt, size_t size)
 {
-	int sent_bytes = sendto(socket_, (char*)pkt, (int)size, 0, (sockaddr*)&peer_addr_, sizeof(struct sockaddr_in));
-	if (sent_bytes <= 0) {
-		if (EAGAIN == errno) {
-			sent_bytes = 0;
-		}
+	if (!udp_demuxer_ || peer_addr_.sin_port == 0) {
+		return -1;
 	}
 
-	return sent_bytes;
-}
\ No newline at end of file
+	return udp_demuxer_->SendTo(pkt, size, peer_addr_, socket_index_);
+}
+
+int UdpConnection::OnSendBatch(uint8_t** pkts, const size_t* sizes, size_t count, xop::DatagramBuffer* const* owners)
+{
+	if (!udp_demuxer_ || peer_addr_.sin_port == 0) {
+		return -1;
+	}
+
+	return udp_demuxer_->SendBatch(pkts, sizes, count, peer_addr_, socket_index_, owners);
+}
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "net/EventLoop.h"
+#include <string>
+#include <vector>
+
+class UdpDemuxer;
 
 class UdpConnection
 {
@@ -8,19 +12,38 @@ public:
 	UdpConnection(std::shared_ptr<xop::EventLoop> event_loop);
 	virtual ~UdpConnection();
 
-	bool Init(std::string ip, uint16_t port);
+	bool Init(std::shared_ptr<UdpDemuxer> udp_demuxer);
 	void Destroy();
 
+	void SetPeerAddress(const sockaddr_in& peer_addr);
+
+	std::shared_ptr<xop::TaskScheduler> GetTaskScheduler() const
+	{ return task_scheduler_; }
+
 protected:
-	void OnRecv();
+	friend class UdpDemuxer;
+
+	// the first stun bind pinned us to the scheduler reading our peer, called on it before the packet
+	virtual void OnBind();
 	virtual void OnRecv(uint8_t* pkt, size_t size);
 	virtual int  OnSend(uint8_t* pkt, size_t size);
+	// owners: the buffer of each packet or nullptr, see UdpDemuxer::SendBatch
+	virtual int  OnSendBatch(uint8_t** pkts, const size_t* sizes, size_t count, xop::DatagramBuffer* const* owners);
 
 	std::shared_ptr<xop::EventLoop> event_loop_;
-	std::shared_ptr<xop::Channel> channel_;
-	SOCKET socket_ = 0;
+	std::shared_ptr<UdpDemuxer> udp_demuxer_;
+	// both are replaced once by the first stun bind, under the demuxer lock
+	std::shared_ptr<xop::TaskScheduler> task_scheduler_;
+	int socket_index_ = 0;
 	std::string local_ip_;
 	uint16_t local_port_ = 0;
 	sockaddr_in peer_addr_ = {};
+
+private:
+	// set by UdpDemuxer under its lock
+	std::string demuxer_ufrag_;
+	std::string demuxer_pwd_;
+	std::vector<std::pair<int, uint64_t>> demuxer_addrs_;
+	bool is_bound_ = false;
 };
 
@@ -0,0 +1,598 @@
+#include "udp_demuxer.h"
+#include "udp_connection.h"
+#include "stun_sink.h"
+#include "rtc_log.h"
+#include "net/SocketUtil.h"
+
+#if defined(__linux) || defined(__linux__)
+#include <netinet/udp.h>
+#include <linux/filter.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
+static const int RTC_UDP_SOCKET_BUF_SIZE = 4 * 1024 * 1024;
+static const size_t RTC_UDP_MAX_GSO_SEGMENTS = 64;
+static const size_t RTC_UDP_MAX_GSO_SIZE = 65000;
+// host, srflx and relay candidates of both families, and a few roams
+static const size_t RTC_UDP_MAX_PEER_ADDRS = 8;
+
+UdpDemuxer::UdpDemuxer(std::shared_ptr<xop::EventLoop> event_loop)
+	: event_loop_(event_loop)
+{
+
+}
+
+UdpDemuxer::~UdpDemuxer()
+{
+	Destroy();
+}
+
+bool UdpDemuxer::Init(std::string ip, uint16_t port)
+{
+	if (!sockets_.empty()) {
+		return false;
+	}
+
+	auto task_schedulers = event_loop_->GetTaskSchedulers();
+	if (task_schedulers.empty()) {
+		return false;
+	}
+
+	bool reuse_port = false;
+#if defined(__linux) || defined(__linux__)
+	reuse_port = task_schedulers.size() > 1;
+#endif
+	if (!reuse_port) {
+		task_schedulers.resize(1);
+	}
+
+	for (auto task_scheduler : task_schedulers) {
+		SOCKET sockfd = CreateSocket(ip, port, reuse_port);
+		if (!sockfd) {
+			Destroy();
+			return false;
+		}
+
+		std::shared_ptr<UdpSocket> udp_socket(new UdpSocket);
+		udp_socket->socket = sockfd;
+		udp_socket->index = (int)sockets_.size();
+		udp_socket->task_scheduler = task_scheduler;
+		udp_socket->recv_buffer.reset(new uint8_t[RTC_UDP_BATCH_SIZE * MAX_MTU]);
+		sockets_.push_back(std::move(udp_socket));
+	}
+
+	if (reuse_port && !AttachSteeringFilter(sockets_[0]->socket, (uint32_t)sockets_.size())) {
+		RTC_LOG_ERROR("attach reuseport filter failed: {}, use the kernel flow hash", strerror(errno));
+	}
+
+	local_ip_ = ip;
+	local_port_ = port;
+
+#if defined(__linux) || defined(__linux__)
+	int gso_size = 0;
+	socklen_t optlen = sizeof(gso_size);
+	is_gso_supported_ = getsockopt(sockets_[0]->socket, SOL_UDP, UDP_SEGMENT, &gso_size, &optlen) == 0;
+	is_gso_enabled_ = is_gso_supported_;
+#endif
+
+	for (auto& udp_socket : sockets_) {
+		UdpSocket* sock = udp_socket.get();
+		sock->is_scheduler_io = sock->task_scheduler->AddDatagramSocket(sock->socket,
+			[this, sock](uint8_t* data, size_t size, const sockaddr_in& peer_addr) { this->OnPacket(sock, data, size, peer_addr); },
+			[this](int error) { this->OnSendError(error); });
+		if (sock->is_scheduler_io) {
+			continue;
+		}
+
+		sock->channel.reset(new xop::Channel(sock->socket));
+		sock->channel->SetReadCallback([this, sock]() { this->OnRecv(sock); });
+		sock->channel->EnableReading();
+		sock->task_scheduler->UpdateChannel(sock->channel);
+	}
+
+	return true;
+}
+
+void UdpDemuxer::Destroy()
+{
+	std::vector<std::shared_ptr<UdpSocket>> sockets;
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+		sockets.swap(sockets_);
+		ufrag_conns_.clear();
+	}
+
+	for (auto& udp_socket : sockets) {
+		if (udp_socket->is_scheduler_io) {
+			udp_socket->task_scheduler->RemoveDatagramSocket(udp_socket->socket);
+			udp_socket->is_scheduler_io = false;
+		}
+
+		if (udp_socket->channel && udp_socket->task_scheduler) {
+			udp_socket->task_scheduler->RemoveChannel(udp_socket->channel);
+			udp_socket->channel.reset();
+		}
+
+		if (udp_socket->socket) {
+			xop::SocketUtil::Close(udp_socket->socket);
+			udp_socket->socket = 0;
+		}
+	}
+}
+
+SOCKET UdpDemuxer::CreateSocket(std::string ip, uint16_t port, bool reuse_port)
+{
+	SOCKET sockfd = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (reuse_port) {
+		xop::SocketUtil::SetReusePort(sockfd);
+	}
+	xop::SocketUtil::SetSendBufSize(sockfd, RTC_UDP_SOCKET_BUF_SIZE);
+	xop::SocketUtil::SetRecvBufSize(sockfd, RTC_UDP_SOCKET_BUF_SIZE);
+	if (!xop::SocketUtil::Bind(sockfd, ip, port)) {
+		xop::SocketUtil::Close(sockfd);
+		return 0;
+	}
+
+	return sockfd;
+}
+
+bool UdpDemuxer::AttachSteeringFilter(SOCKET sockfd, uint32_t num_sockets)
+{
+#if defined(__linux) || defined(__linux__)
+	// socket index = (source ip ^ source port) % num_sockets, in host byte order
+	struct sock_filter code[] = {
+		{ BPF_LDX | BPF_B | BPF_MSH, 0, 0, (uint32_t)SKF_NET_OFF },        // x = ip header length
+		{ BPF_LD  | BPF_H | BPF_IND, 0, 0, (uint32_t)SKF_NET_OFF },        // a = udp source port
+		{ BPF_ST, 0, 0, 0 },                                               // m[0] = a
+		{ BPF_LD  | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_NET_OFF + 12) }, // a = ip source address
+		{ BPF_LDX | BPF_MEM, 0, 0, 0 },                                    // x = m[0]
+		{ BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0 },
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, num_sockets },
+		{ BPF_RET | BPF_A, 0, 0, 0 },
+	};
+
+	struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+	return setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
+#else
+	return false;
+#endif
+}
+
+UdpDemuxer::UdpSocket* UdpDemuxer::GetUdpSocket(int socket_index) const
+{
+	if (socket_index < 0 || socket_index >= (int)sockets_.size()) {
+		return sockets_.empty() ? nullptr : sockets_[0].get();
+	}
+
+	return sockets_[socket_index].get();
+}
+
+int UdpDemuxer::GetSocketIndex(std::shared_ptr<xop::TaskScheduler> task_scheduler) const
+{
+	for (size_t n = 0; n < sockets_.size(); n++) {
+		if (sockets_[n]->task_scheduler == task_scheduler) {
+			return (int)n;
+		}
+	}
+
+	return 0;
+}
+
+bool UdpDemuxer::EnableGso(bool enable)
+{
+	is_gso_enabled_ = enable && is_gso_supported_;
+	return is_gso_enabled_ == enable;
+}
+
+void UdpDemuxer::AddConnection(std::string ufrag, std::string pwd, std::shared_ptr<UdpConnection> conn)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+	ufrag_conns_[ufrag] = conn;
+	conn->demuxer_ufrag_ = ufrag;
+	conn->demuxer_pwd_ = pwd;
+}
+
+void UdpDemuxer::RemoveConnection(UdpConnection* conn)
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	auto iter = ufrag_conns_.find(conn->demuxer_ufrag_);
+	if (iter != ufrag_conns_.end()) {
+		auto udp_conn = iter->second.lock();
+		if (!udp_conn || udp_conn.get() == conn) {
+			ufrag_conns_.erase(iter);
+		}
+	}
+
+	for (auto& addr : conn->demuxer_addrs_) {
+		RemovePeerAddress(conn, addr);
+	}
+	conn->demuxer_addrs_.clear();
+}
+
+void UdpDemuxer::RemovePeerAddress(UdpConnection* conn, const std::pair<int, uint64_t>& addr)
+{
+	if (addr.first >= (int)sockets_.size()) {
+		return;
+	}
+
+	// the address maps belong to the socket schedulers, the task keeps the socket alive
+	std::shared_ptr<UdpSocket> udp_socket = sockets_[addr.first];
+	uint64_t addr_key = addr.second;
+	udp_socket->task_scheduler->AddTriggerEvent([udp_socket, addr_key, conn] {
+		auto iter = udp_socket->addr_conns.find(addr_key);
+		if (iter != udp_socket->addr_conns.end()) {
+			auto udp_conn = iter->second.lock();
+			if (!udp_conn || udp_conn.get() == conn) {
+				udp_socket->addr_conns.erase(iter);
+			}
+		}
+	});
+}
+
+int UdpDemuxer::SendTo(uint8_t* pkt, size_t size, const sockaddr_in& peer_addr, int socket_index)
+{
+	UdpSocket* udp_socket = GetUdpSocket(socket_index);
+	if (!udp_socket) {
+		return -1;
+	}
+
+	if (udp_socket->is_scheduler_io
+		&& udp_socket->task_scheduler->SendDatagram(udp_socket->socket, &pkt, &size, 1, peer_addr, 0, nullptr)) {
+		return (int)size;
+	}
+
+	int sent_bytes = sendto(udp_socket->socket, (char*)pkt, (int)size, 0, (sockaddr*)&peer_addr, sizeof(struct sockaddr_in));
+	if (sent_bytes <= 0) {
+		if (EAGAIN == errno) {
+			sent_bytes = 0;
+		}
+	}
+
+	return sent_bytes;
+}
+
+int UdpDemuxer::SendBatch(uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr, int socket_index,
+	xop::DatagramBuffer* const* owners)
+{
+	UdpSocket* udp_socket = GetUdpSocket(socket_index);
+	if (!udp_socket) {
+		return -1;
+	}
+
+	if (count > RTC_UDP_BATCH_SIZE) {
+		count = RTC_UDP_BATCH_SIZE;
+	}
+
+#if defined(__linux) || defined(__linux__)
+	// queued to the ring when sent from the loop thread, what the ring does not take goes through sendmmsg
+	size_t queued_pkts = 0;
+	if (udp_socket->is_scheduler_io) {
+		queued_pkts = SendBatchScheduler(udp_socket, pkts, sizes, count, peer_addr, owners);
+		if (queued_pkts == count) {
+			return (int)count;
+		}
+	}
+
+	int sent_pkts = SendBatchSocket(udp_socket->socket, pkts + queued_pkts, sizes + queued_pkts, count - queued_pkts, peer_addr);
+	if (sent_pkts < 0) {
+		return queued_pkts > 0 ? (int)queued_pkts : -1;
+	}
+
+	return (int)queued_pkts + sent_pkts;
+#else
+	int sent_pkts = 0;
+	for (size_t n = 0; n < count; n++) {
+		if (SendTo(pkts[n], sizes[n], peer_addr, socket_index) < 0) {
+			return sent_pkts > 0 ? sent_pkts : -1;
+		}
+		sent_pkts++;
+	}
+
+	return sent_pkts;
+#endif
+}
+
+size_t UdpDemuxer::SendBatchScheduler(UdpSocket* udp_socket, uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr,
+	xop::DatagramBuffer* const* owners)
+{
+	bool is_gso_enabled = is_gso_enabled_;
+	size_t queued_pkts = 0;
+	while (queued_pkts < count) {
+		size_t end = is_gso_enabled ? GetSegmentRun(sizes, count, queued_pkts) : queued_pkts + 1;
+		uint16_t segment_size = end - queued_pkts > 1 ? (uint16_t)sizes[queued_pkts] : 0;
+		if (!udp_socket->task_scheduler->SendDatagram(udp_socket->socket, pkts + queued_pkts, sizes + queued_pkts,
+			end - queued_pkts, peer_addr, segment_size, owners ? owners + queued_pkts : nullptr)) {
+			break;
+		}
+		queued_pkts = end;
+	}
+
+	return queued_pkts;
+}
+
+int UdpDemuxer::SendBatchSocket(SOCKET sockfd, uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr)
+{
+#if defined(__linux) || defined(__linux__)
+	if (is_gso_enabled_ && count > 1) {
+		int sent_pkts = SendBatchGso(sockfd, pkts, sizes, count, peer_addr);
+		if (sent_pkts >= 0 || is_gso_enabled_) {
+			return sent_pkts;
+		}
+	}
+
+	struct mmsghdr msgs[RTC_UDP_BATCH_SIZE];
+	struct iovec iovs[RTC_UDP_BATCH_SIZE];
+	memset(msgs, 0, sizeof(struct mmsghdr) * count);
+
+	for (size_t n = 0; n < count; n++) {
+		iovs[n].iov_base = pkts[n];
+		iovs[n].iov_len = sizes[n];
+		msgs[n].msg_hdr.msg_name = (void*)&peer_addr;
+		msgs[n].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		msgs[n].msg_hdr.msg_iov = &iovs[n];
+		msgs[n].msg_hdr.msg_iovlen = 1;
+	}
+
+	size_t sent_pkts = 0;
+	while (sent_pkts < count) {
+		int ret = sendmmsg(sockfd, msgs + sent_pkts, (unsigned int)(count - sent_pkts), 0);
+		if (ret <= 0) {
+			if (sent_pkts == 0 && EAGAIN != errno) {
+				return -1;
+			}
+			break;
+		}
+		sent_pkts += ret;
+	}
+
+	return (int)sent_pkts;
+#else
+	return -1;
+#endif
+}
+
+int UdpDemuxer::SendBatchGso(SOCKET sockfd, uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr)
+{
+#if defined(__linux) || defined(__linux__)
+	struct mmsghdr msgs[RTC_UDP_BATCH_SIZE];
+	struct iovec iovs[RTC_UDP_BATCH_SIZE];
+	size_t msg_pkts[RTC_UDP_BATCH_SIZE];
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} controls[RTC_UDP_BATCH_SIZE];
+
+	size_t num_msgs = 0;
+	for (size_t n = 0; n < count; ) {
+		size_t segment_size = sizes[n];
+		size_t end = GetSegmentRun(sizes, count, n);
+
+		for (size_t i = n; i < end; i++) {
+			iovs[i].iov_base = pkts[i];
+			iovs[i].iov_len = sizes[i];
+		}
+
+		struct msghdr& msg = msgs[num_msgs].msg_hdr;
+		memset(&msgs[num_msgs], 0, sizeof(struct mmsghdr));
+		msg.msg_name = (void*)&peer_addr;
+		msg.msg_namelen = sizeof(struct sockaddr_in);
+		msg.msg_iov = &iovs[n];
+		msg.msg_iovlen = end - n;
+
+		if (end - n > 1) {
+			msg.msg_control = controls[num_msgs].buf;
+			msg.msg_controllen = sizeof(controls[num_msgs].buf);
+			struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			uint16_t gso_size = (uint16_t)segment_size;
+			memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+		}
+
+		msg_pkts[num_msgs++] = end - n;
+		n = end;
+	}
+
+	size_t sent_msgs = 0;
+	size_t sent_pkts = 0;
+	while (sent_msgs < num_msgs) {
+		int ret = sendmmsg(sockfd, msgs + sent_msgs, (unsigned int)(num_msgs - sent_msgs), 0);
+		if (ret <= 0) {
+			if (sent_pkts == 0 && (EIO == errno || EINVAL == errno || ENOPROTOOPT == errno)) {
+				// the device or route can not segment, stay on plain batches from now on
+				RTC_LOG_ERROR("udp gso send failed: {}, fallback to sendmmsg", strerror(errno));
+				is_gso_enabled_ = false;
+				return -1;
+			}
+			if (sent_pkts == 0 && EAGAIN != errno) {
+				return -1;
+			}
+			break;
+		}
+
+		for (int n = 0; n < ret; n++) {
+			sent_pkts += msg_pkts[sent_msgs++];
+		}
+	}
+
+	return (int)sent_pkts;
+#else
+	return -1;
+#endif
+}
+
+void UdpDemuxer::OnSendError(int error)
+{
+	// sends queued to the ring fail after the fact, the next batches go out unsegmented
+	if ((EIO == error || EINVAL == error || ENOPROTOOPT == error) && is_gso_enabled_.exchange(false)) {
+		RTC_LOG_ERROR("udp gso send failed: {}, fallback to single datagrams", strerror(error));
+	}
+}
+
+std::string UdpDemuxer::GetLocalIp() const
+{
+	return local_ip_;
+}
+
+uint16_t UdpDemuxer::GetLocalPort() const
+{
+	return local_port_;
+}
+
+void UdpDemuxer::OnRecv(UdpSocket* udp_socket)
+{
+	uint8_t* recv_buffer = udp_socket->recv_buffer.get();
+
+#if defined(__linux) || defined(__linux__)
+	struct mmsghdr msgs[RTC_UDP_BATCH_SIZE];
+	struct iovec iovs[RTC_UDP_BATCH_SIZE];
+	sockaddr_in peer_addrs[RTC_UDP_BATCH_SIZE];
+	memset(msgs, 0, sizeof(msgs));
+
+	for (size_t n = 0; n < RTC_UDP_BATCH_SIZE; n++) {
+		iovs[n].iov_base = recv_buffer + n * MAX_MTU;
+		iovs[n].iov_len = MAX_MTU;
+		msgs[n].msg_hdr.msg_name = &peer_addrs[n];
+		msgs[n].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		msgs[n].msg_hdr.msg_iov = &iovs[n];
+		msgs[n].msg_hdr.msg_iovlen = 1;
+	}
+
+	// drain what is queued without blocking, the channel is level triggered
+	int num_msgs = recvmmsg(udp_socket->socket, msgs, RTC_UDP_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+	for (int n = 0; n < num_msgs; n++) {
+		if (msgs[n].msg_len > 0) {
+			OnPacket(udp_socket, recv_buffer + n * MAX_MTU, msgs[n].msg_len, peer_addrs[n]);
+		}
+	}
+#else
+	sockaddr_in peer_addr = {};
+	socklen_t addr_len = sizeof(sockaddr_in);
+
+	uint8_t* buf = recv_buffer;
+	int recv_bytes = recvfrom(udp_socket->socket, (char*)buf, MAX_MTU, 0, (sockaddr*)&peer_addr, &addr_len);
+	if (recv_bytes > 0) {
+		OnPacket(udp_socket, buf, recv_bytes, peer_addr);
+	}
+#endif
+}
+
+void UdpDemuxer::OnPacket(UdpSocket* udp_socket, uint8_t* pkt, size_t size, const sockaddr_in& peer_addr)
+{
+	bool is_new_peer = false;
+	bool is_bound = false;
+	auto conn = FindConnection(udp_socket, pkt, size, peer_addr, is_new_peer, is_bound);
+	if (!conn) {
+		return;
+	}
+
+	if (conn->task_scheduler_ == udp_socket->task_scheduler) {
+		if (is_new_peer) {
+			conn->SetPeerAddress(peer_addr);
+		}
+		if (is_bound) {
+			conn->OnBind();
+		}
+		conn->OnRecv(pkt, size);
+		return;
+	}
+
+	// the connection state is only touched from its own scheduler
+	auto task_scheduler = conn->GetTaskScheduler();
+	size_t pkt_size = size;
+	std::shared_ptr<uint8_t> pkt_copy(new uint8_t[pkt_size], std::default_delete<uint8_t[]>());
+	memcpy(pkt_copy.get(), pkt, pkt_size);
+	task_scheduler->AddTriggerEvent([conn, pkt_copy, pkt_size, peer_addr, is_new_peer] {
+		if (is_new_peer) {
+			conn->SetPeerAddress(peer_addr);
+		}
+		conn->OnRecv(pkt_copy.get(), pkt_size);
+	});
+}
+
+std::shared_ptr<UdpConnection> UdpDemuxer::FindConnection(UdpSocket* udp_socket, uint8_t* pkt, size_t size, const sockaddr_in& peer_addr,
+	bool& is_new_peer, bool& is_bound)
+{
+	uint64_t addr_key = GetAddressKey(peer_addr);
+
+	// the peer is always steered to this socket, no other thread reads its map
+	auto& addr_conns = udp_socket->addr_conns;
+	auto iter = addr_conns.find(addr_key);
+	if (iter != addr_conns.end()) {
+		auto conn = iter->second.lock();
+		if (conn) {
+			return conn;
+		}
+		addr_conns.erase(iter);
+	}
+
+	// only a stun binding request carrying a known ufrag and signed with its pwd may bind a new peer address
+	std::string username = GetStunUsername(pkt, size);
+	std::string ufrag = username.substr(0, username.find(':'));
+	if (ufrag.empty()) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	auto ufrag_iter = ufrag_conns_.find(ufrag);
+	if (ufrag_iter == ufrag_conns_.end()) {
+		return nullptr;
+	}
+
+	auto conn = ufrag_iter->second.lock();
+	if (!conn) {
+		ufrag_conns_.erase(ufrag_iter);
+		return nullptr;
+	}
+
+	// dropped without a log, anyone who saw the ufrag in the sdp may send these
+	if (!StunSink::CheckMessageIntegrity(pkt, size, conn->demuxer_pwd_)) {
+		return nullptr;
+	}
+
+	// the connection moves to the thread reading its peer, nothing runs on it before its first bind
+	if (!conn->is_bound_) {
+		conn->is_bound_ = true;
+		conn->task_scheduler_ = udp_socket->task_scheduler;
+		conn->socket_index_ = udp_socket->index;
+		is_bound = true;
+	}
+
+	if (conn->demuxer_addrs_.size() >= RTC_UDP_MAX_PEER_ADDRS) {
+		RemovePeerAddress(conn.get(), conn->demuxer_addrs_.front());
+		conn->demuxer_addrs_.erase(conn->demuxer_addrs_.begin());
+	}
+
+	is_new_peer = true;
+	addr_conns[addr_key] = conn;
+	conn->demuxer_addrs_.emplace_back(udp_socket->index, addr_key);
+	RTC_LOG_INFO("udp demuxer bind peer, ufrag:{} addr:{}:{} socket:{}", ufrag,
+		inet_ntoa(peer_addr.sin_addr), ntohs(peer_addr.sin_port), udp_socket->index);
+	return conn;
+}
+
+uint64_t UdpDemuxer::GetAddressKey(const sockaddr_in& addr)
+{
+	// the local side of the 5-tuple is fixed by the socket
+	return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+}
+
+size_t UdpDemuxer::GetSegmentRun(const size_t* sizes, size_t count, size_t start)
+{
+	// a segment run is full sized packets optionally followed by one shorter tail
+	size_t segment_size = sizes[start];
+	size_t total_size = sizes[start];
+	size_t end = start + 1;
+	while (end < count && sizes[end - 1] == segment_size && sizes[end] <= segment_size
+		&& end - start < RTC_UDP_MAX_GSO_SEGMENTS && total_size + sizes[end] <= RTC_UDP_MAX_GSO_SIZE) {
+		total_size += sizes[end];
+		end++;
+	}
+
+	return end;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "net/EventLoop.h"
+#include "rtc_common.h"
+#include <atomic>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class UdpConnection;
+
+// One local udp port, packets are routed to connections by the ice ufrag
+// of the stun USERNAME, then by the peer address once it has been learned.
+// On linux every scheduler reads its own SO_REUSEPORT socket, a reuseport bpf
+// program steers each peer to a fixed socket so it is always read by the same thread.
+// A new peer address is only bound by a binding request signed with the connection's ice pwd,
+// a connection keeps at most a few addresses and forgets the oldest.
+// The first stun bind pins the connection to the scheduler of that socket, the learned
+// addresses are kept per socket and looked up without a lock. Packets of a later peer
+// address steered to another socket are handed over to the connection's scheduler.
+// On linux datagrams are received and sent in batches with recvmmsg/sendmmsg,
+// runs of equal sized packets are sent as one UDP_SEGMENT (GSO) buffer when the kernel supports it.
+// On an io_uring scheduler the socket is read by a multishot recvmsg into a provided buffer ring
+// and sends from the loop thread are queued to the ring, both without a syscall per batch.
+// Packets queued with their owners are sent in place, the ring holds them until the completion.
+class UdpDemuxer
+{
+public:
+	UdpDemuxer(std::shared_ptr<xop::EventLoop> event_loop);
+	virtual ~UdpDemuxer();
+
+	bool Init(std::string ip, uint16_t port);
+	void Destroy();
+
+	// returns false when the kernel does not support udp segmentation offload
+	bool EnableGso(bool enable);
+
+	void AddConnection(std::string ufrag, std::string pwd, std::shared_ptr<UdpConnection> conn);
+	void RemoveConnection(UdpConnection* conn);
+
+	// connections send on the socket read by their own scheduler
+	int GetSocketIndex(std::shared_ptr<xop::TaskScheduler> task_scheduler) const;
+
+	int SendTo(uint8_t* pkt, size_t size, const sockaddr_in& peer_addr, int socket_index = 0);
+	// returns the number of packets handed to the socket, -1 on error.
+	// with owners, the buffer of each packet, an io_uring scheduler sends them without a copy
+	int SendBatch(uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr, int socket_index = 0,
+		xop::DatagramBuffer* const* owners = nullptr);
+
+	std::string GetLocalIp() const;
+	uint16_t GetLocalPort() const;
+
+private:
+	struct UdpSocket
+	{
+		SOCKET socket = 0;
+		int index = 0;
+		std::shared_ptr<xop::TaskScheduler> task_scheduler;
+		std::shared_ptr<xop::Channel> channel;
+		// received and sent through the scheduler instead of the channel
+		bool is_scheduler_io = false;
+		std::unique_ptr<uint8_t[]> recv_buffer;
+		// peers steered to this socket, only touched by its scheduler
+		std::unordered_map<uint64_t, std::weak_ptr<UdpConnection>> addr_conns;
+	};
+
+	SOCKET CreateSocket(std::string ip, uint16_t port, bool reuse_port);
+	bool AttachSteeringFilter(SOCKET sockfd, uint32_t num_sockets);
+	UdpSocket* GetUdpSocket(int socket_index) const;
+
+	size_t SendBatchScheduler(UdpSocket* udp_socket, uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr,
+		xop::DatagramBuffer* const* owners);
+	int  SendBatchSocket(SOCKET sockfd, uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr);
+	int  SendBatchGso(SOCKET sockfd, uint8_t** pkts, const size_t* sizes, size_t count, const sockaddr_in& peer_addr);
+	void OnSendError(int error);
+	void OnRecv(UdpSocket* udp_socket);
+	void OnPacket(UdpSocket* udp_socket, uint8_t* pkt, size_t size, const sockaddr_in& peer_addr);
+	std::shared_ptr<UdpConnection> FindConnection(UdpSocket* udp_socket, uint8_t* pkt, size_t size, const sockaddr_in& peer_addr,
+		bool& is_new_peer, bool& is_bound);
+
+	// posts the removal to the scheduler owning the address map, under mutex_
+	void RemovePeerAddress(UdpConnection* conn, const std::pair<int, uint64_t>& addr);
+
+	static uint64_t GetAddressKey(const sockaddr_in& addr);
+	static size_t GetSegmentRun(const size_t* sizes, size_t count, size_t start);
+
+	std::shared_ptr<xop::EventLoop> event_loop_;
+	// shared with the tasks posted to the socket schedulers, which may run after Destroy
+	std::vector<std::shared_ptr<UdpSocket>> sockets_;
+	std::string local_ip_;
+	uint16_t local_port_ = 0;
+	bool is_gso_supported_ = false;
+	std::atomic<bool> is_gso_enabled_{false};
+
+	// only taken to bind a new peer address and to add or remove a connection
+	std::mutex mutex_;
+	std::unordered_map<std::string, std::weak_ptr<UdpConnection>> ufrag_conns_;
+};
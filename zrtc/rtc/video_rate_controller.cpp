@@ -0,0 +1,98 @@
+#include "video_rate_controller.h"
+#include "rtc_common.h"
+#include <algorithm>
+#include <chrono>
+
+static const double  kDecreaseHysteresis = 0.9;
+static const double  kIncreaseHysteresis = 1.1;
+static const double  kMaxIncreaseStep = 1.25;
+static const int64_t kMinIncreaseIntervalMs = 1000;
+static const uint32_t kMaxOverheadLossRate = 50;
+
+VideoRateController::VideoRateController()
+{
+	SetBitrates(RTC_ENCODER_MIN_BITRATE, RTC_ENCODER_START_BITRATE, RTC_ENCODER_MAX_BITRATE);
+}
+
+VideoRateController::~VideoRateController()
+{
+
+}
+
+int64_t VideoRateController::GetTimeNowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void VideoRateController::SetBitrates(uint32_t min_bitrate_bps, uint32_t start_bitrate_bps, uint32_t max_bitrate_bps)
+{
+	min_bitrate_ = min_bitrate_bps;
+	max_bitrate_ = max_bitrate_bps > min_bitrate_bps ? max_bitrate_bps : min_bitrate_bps;
+	bitrate_ = std::min(std::max(start_bitrate_bps, min_bitrate_), max_bitrate_);
+}
+
+void VideoRateController::SetPercentile(uint32_t percentile)
+{
+	percentile_ = percentile < 100 ? percentile : 99;
+}
+
+uint32_t VideoRateController::Update(const std::vector<ViewerQoS>& viewers)
+{
+	if (viewers.empty()) {
+		return 0;
+	}
+
+	std::vector<uint32_t> budgets;
+	std::vector<uint32_t> rtts;
+	budgets.reserve(viewers.size());
+	rtts.reserve(viewers.size());
+
+	for (auto& viewer : viewers) {
+		if (viewer.target_bitrate == 0) {
+			continue;
+		}
+
+		// fec and retransmissions grow with the loss, the encoder gets the rest
+		uint32_t loss_rate = std::min(viewer.loss_rate, kMaxOverheadLossRate);
+		budgets.push_back(static_cast<uint32_t>((uint64_t)viewer.target_bitrate * (100 - loss_rate) / 100));
+		rtts.push_back(viewer.rtt);
+	}
+
+	if (budgets.empty()) {
+		return 0;
+	}
+
+	size_t index = budgets.size() * percentile_ / 100;
+	std::nth_element(budgets.begin(), budgets.begin() + index, budgets.end());
+	std::nth_element(rtts.begin(), rtts.begin() + index, rtts.end(), std::greater<uint32_t>());
+	uint32_t budget = std::min(std::max(budgets[index], min_bitrate_), max_bitrate_);
+	uint32_t rtt = rtts[index];
+
+	int64_t now = GetTimeNowMs();
+	uint32_t bitrate = bitrate_;
+
+	if (budget < bitrate_ * kDecreaseHysteresis) {
+		bitrate = budget;
+	}
+	else if (budget > bitrate_ * kIncreaseHysteresis) {
+		// let the estimates see the last change before the next increase
+		int64_t interval = std::max(kMinIncreaseIntervalMs, (int64_t)rtt * 3);
+		if (now - last_change_time_ >= interval) {
+			bitrate = std::min(budget, static_cast<uint32_t>(bitrate_ * kMaxIncreaseStep));
+		}
+	}
+
+	if (bitrate == bitrate_) {
+		return 0;
+	}
+
+	bitrate_ = bitrate;
+	last_change_time_ = now;
+	return bitrate_;
+}
+
+uint32_t VideoRateController::GetBitrate()
+{
+	return bitrate_;
+}
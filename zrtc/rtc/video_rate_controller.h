@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct ViewerQoS
+{
+	uint32_t target_bitrate = 0; // bps, send-side estimate
+	uint32_t rtt = 0;            // ms
+	uint32_t loss_rate = 0;      // percent
+};
+
+// Picks one encoder bitrate for all viewers of a shared encoder.
+// Each viewer gets its estimate minus the share spent on fec and rtx,
+// the encoder follows a low percentile of those. Decreases apply at once,
+// increases wait a few round trips and grow in bounded steps.
+// Not thread safe, call it from one thread.
+class VideoRateController
+{
+public:
+	VideoRateController();
+	virtual ~VideoRateController();
+
+	void SetBitrates(uint32_t min_bitrate_bps, uint32_t start_bitrate_bps, uint32_t max_bitrate_bps);
+
+	// 0: the slowest viewer decides, 10: the 10th percentile
+	void SetPercentile(uint32_t percentile);
+
+	// returns the new encoder bitrate, or 0 when it should stay
+	uint32_t Update(const std::vector<ViewerQoS>& viewers);
+
+	uint32_t GetBitrate();
+
+private:
+	static int64_t GetTimeNowMs();
+
+	uint32_t min_bitrate_ = 0;
+	uint32_t max_bitrate_ = 0;
+	uint32_t bitrate_ = 0;
+	uint32_t percentile_ = 10;
+	int64_t last_change_time_ = 0;
+};
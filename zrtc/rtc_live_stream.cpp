@@ -60,6 +60,16 @@ void RtcLiveStream::SetAudioCallback(const AudioCallback& callback)
 	audio_callback_ = callback;
 }
 
+void RtcLiveStream::SetVideoBitrate(uint32_t bitrate_bps)
+{
+	video_bitrate_ = bitrate_bps;
+}
+
+void RtcLiveStream::ForceIDR()
+{
+	force_idr_ = true;
+}
+
 bool RtcLiveStream::InitVideo()
 {
 	if (video_thread_) {
@@ -93,11 +103,11 @@ bool RtcLiveStream::InitVideo()
 
 	video_thread_.reset(new std::thread([this] {
 		start_video_ = true;
-		int64_t frame_interval = 1000 / video_config_.video.framerate;
 		while (start_video_) {
 			xop::Timestamp timestamp;
 			CaptureVideo();
 
+			int64_t frame_interval = 1000 / video_config_.video.framerate;
 			int64_t capture_interval = timestamp.Elapsed();
 			int64_t duration = frame_interval > capture_interval ? frame_interval - capture_interval : 1;
 			xop::Timer::Sleep(duration);
@@ -118,6 +128,16 @@ void RtcLiveStream::CaptureVideo()
 		return;
 	}
 
+	uint32_t video_bitrate = video_bitrate_.exchange(0);
+	if (video_bitrate > 0 && video_bitrate != video_config_.video.bitrate) {
+		video_config_.video.bitrate = video_bitrate;
+		h264_encoder_->Reconfigure(video_config_.video);
+	}
+
+	if (force_idr_.exchange(false)) {
+		h264_encoder_->ForceIDR();
+	}
+
 	auto packet = h264_encoder_->Encode(image.bgra.data(), image.width, image.height, (uint32_t)image.bgra.size());
 	if (!packet) {
 		return;
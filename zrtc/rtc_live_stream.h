@@ -5,6 +5,7 @@
 #include "avcodec/h264_encoder.h"
 #include "avcodec/opus_encoder.h"
 #include "avcodec/audio_resampler.h"
+#include <atomic>
 
 class RtcLiveStream
 {
@@ -21,6 +22,10 @@ public:
 	void SetVideoCallback(const VideoCallback& callback);
 	void SetAudioCallback(const AudioCallback& callback);
 
+	// applied by the video thread before the next frame
+	void SetVideoBitrate(uint32_t bitrate_bps);
+	void ForceIDR();
+
 private:
 	bool InitVideo();
 	bool InitAudio();
@@ -35,6 +40,8 @@ private:
 	bool start_audio_ = false;
 
 	AVConfig video_config_ = {};
+	std::atomic<uint32_t> video_bitrate_{0};
+	std::atomic<bool> force_idr_{false};
 	std::shared_ptr<ffmpeg::H264Encoder> h264_encoder_;
 	std::shared_ptr<DX::ScreenCapture> screen_capture_;
 
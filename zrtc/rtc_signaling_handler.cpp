@@ -3,35 +3,68 @@
 
 RtcSignalingHandler::RtcSignalingHandler(const SignalingConfig& signaling_config)
 	: signaling_config_(signaling_config)
-	, event_loop_(std::make_shared<xop::EventLoop>())
+	, event_loop_(std::make_shared<xop::EventLoop>(signaling_config.rtc_threads))
+	, udp_demuxer_(std::make_shared<UdpDemuxer>(event_loop_))
+	, video_source_(std::make_shared<H264RtpSource>(GenerateSSRC(), RTC_MEDIA_CODEC_H264))
+	, gop_cache_(std::make_shared<GopCache>())
 {
 	event_loop_->Loop();
+	keyframe_requester_.SetMinInterval(signaling_config_.min_keyframe_interval_ms);
+	if (signaling_config_.srtp_threads > 0) {
+		srtp_worker_pool_ = std::make_shared<SrtpWorkerPool>(signaling_config_.srtp_threads);
+	}
+
+	// each frame is packetized once, fec included, and stamped per connection
+	video_source_->SetFec(GenerateSSRC(), RTC_MEDIA_CODEC_FEC);
+	video_source_->SetExtension(RTP_EXTENSION_TWCC);
+	video_source_->SetSendPacketCallback([this](std::vector<RtpPacketPtr>& rtp_pkts) {
+		auto frame = RtpFrame::Create();
+		frame->packets.swap(rtp_pkts);
+		gop_cache_->InputFrame(frame, frame->packets.front()->frame_type == RTC_H264_FRAME_TYPE_IDR);
+		auto conn_list = std::atomic_load(&conn_list_);
+		for (auto& conn : *conn_list) {
+			conn->SendVideoPackets(frame);
+		}
+	});
+
+	if (!udp_demuxer_->Init(signaling_config_.host, signaling_config_.rtc_port)) {
+		RTC_LOG_ERROR("bind udp port failed, address:{}:{}", signaling_config_.host.c_str(), signaling_config_.rtc_port);
+	}
 }
 
 RtcSignalingHandler::~RtcSignalingHandler() {
+	udp_demuxer_->Destroy();
 	event_loop_->Quit();
 }
 
 void RtcSignalingHandler::GetLocalDescription(std::string uid, std::string & local_sdp) {
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_int_distribution<> dis(10000, UINT16_MAX);
-	uint16_t port = static_cast<uint16_t>(dis(gen));
-
 	auto rtc_connection = std::make_shared<RtcConnection>(event_loop_);
 	rtc_connection->SetStreamName(uid);
-	if (!rtc_connection->SetLocalAddress(signaling_config_.host.c_str(), port)) {
-		port = static_cast<uint16_t>(dis(gen));
-		if (!rtc_connection->SetLocalAddress(signaling_config_.host.c_str(), port)) {
-			return;
-		}
+	rtc_connection->SetGopCache(gop_cache_);
+	rtc_connection->SetPlayoutDelay(signaling_config_.target_playout_delay_ms);
+	rtc_connection->SetSrtpWorkerPool(srtp_worker_pool_);
+	if (!rtc_connection->SetUdpDemuxer(udp_demuxer_)) {
+		return;
 	}
 	rtc_connection->Init(RTC_ROLE_SERVER);
 	local_sdp = rtc_connection->GetLocalSdp();
+	udp_demuxer_->AddConnection(rtc_connection->GetLocalUfrag(), rtc_connection->GetLocalPwd(), rtc_connection);
 
 	std::lock_guard<std::mutex> locker(conns_mutex_);
+	// a reconnect replaces the old connection, its teardown runs on its own scheduler
+	auto iter = rtc_conns_.find(uid);
+	if (iter != rtc_conns_.end()) {
+		iter->second->Destroy();
+	}
 	rtc_conns_[uid] = rtc_connection;
-	RTC_LOG_INFO("init rtc connection, address:{}:{}", signaling_config_.host.c_str(), port);
+
+	// the media threads read a snapshot and never take conns_mutex_
+	auto conn_list = std::make_shared<RtcConnectionList>();
+	for (auto& conn : rtc_conns_) {
+		conn_list->push_back(conn.second);
+	}
+	std::atomic_store(&conn_list_, std::shared_ptr<const RtcConnectionList>(conn_list));
+	RTC_LOG_INFO("init rtc connection, address:{}:{}", signaling_config_.host.c_str(), signaling_config_.rtc_port);
 }
 
 void RtcSignalingHandler::OnRemoteDescription(std::string uid, std::string remote_sdp) {
@@ -43,16 +76,87 @@ void RtcSignalingHandler::OnRemoteDescription(std::string uid, std::string remot
 
 void RtcSignalingHandler::SendVideoFrame(uint8_t* frame, size_t frame_size)
 {
-	std::lock_guard<std::mutex> locker(conns_mutex_);
-	for (auto conn : rtc_conns_) {
-		conn.second->SendVideoFrame(frame, frame_size);
+	auto conn_list = std::atomic_load(&conn_list_);
+	if (!conn_list || conn_list->empty()) {
+		return;
+	}
+
+	uint32_t loss_rate = 0;
+	uint32_t loss_burst = 0;
+	uint32_t rtt = 0;
+	for (auto& conn : *conn_list) {
+		if (conn->GetVideoFecLossRate() >= loss_rate) {
+			loss_rate = conn->GetVideoFecLossRate();
+			loss_burst = conn->GetVideoLossBurst();
+			rtt = conn->GetVideoRTT();
+		}
+	}
+	video_source_->UpdateQoS(rtt, loss_rate, loss_burst);
+	video_source_->InputFrame(frame, frame_size);
+
+	if (H264RtpSource::GetFrameType(frame, frame_size) == RTC_H264_FRAME_TYPE_IDR) {
+		for (auto& conn : *conn_list) {
+			conn->OnKeyFrameSent();
+		}
+		keyframe_requester_.OnKeyFrame();
 	}
 }
 
 void RtcSignalingHandler::SendAudioFrame(uint8_t* frame, size_t frame_size)
 {
-	std::lock_guard<std::mutex> locker(conns_mutex_);
-	for (auto conn : rtc_conns_) {
-		conn.second->SendAudioFrame(frame, frame_size);
+	auto conn_list = std::atomic_load(&conn_list_);
+	if (!conn_list || conn_list->empty()) {
+		return;
+	}
+
+	std::shared_ptr<uint8_t> audio_frame(new uint8_t[frame_size], std::default_delete<uint8_t[]>());
+	memcpy(audio_frame.get(), frame, frame_size);
+	for (auto& conn : *conn_list) {
+		conn->SendAudioFrame(audio_frame, frame_size);
+	}
+}
+
+uint32_t RtcSignalingHandler::UpdateVideoBitrate()
+{
+	auto conn_list = std::atomic_load(&conn_list_);
+	if (!conn_list || conn_list->empty()) {
+		return 0;
 	}
+
+	std::vector<ViewerQoS> viewers;
+	for (auto& conn : *conn_list) {
+		ViewerQoS viewer;
+		viewer.target_bitrate = conn->GetTargetBitrate();
+		viewer.rtt = conn->GetVideoRTT();
+		viewer.loss_rate = conn->GetVideoLossRate();
+		viewers.push_back(viewer);
+	}
+
+	uint32_t bitrate = video_rate_controller_.Update(viewers);
+	if (bitrate > 0) {
+		RTC_LOG_INFO("video bitrate:{}kbps viewers:{}", bitrate / 1000, viewers.size());
+	}
+	return bitrate;
+}
+
+bool RtcSignalingHandler::UpdateKeyFrameRequest()
+{
+	auto conn_list = std::atomic_load(&conn_list_);
+	if (!conn_list || conn_list->empty()) {
+		return false;
+	}
+
+	uint32_t waiting_viewers = 0;
+	for (auto& conn : *conn_list) {
+		if (conn->IsKeyFrameRequested()) {
+			waiting_viewers++;
+		}
+	}
+
+	if (!keyframe_requester_.Update(waiting_viewers > 0)) {
+		return false;
+	}
+
+	RTC_LOG_INFO("force idr, waiting viewers:{}", waiting_viewers);
+	return true;
 }
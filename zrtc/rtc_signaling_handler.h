@@ -2,6 +2,9 @@
 
 
 #include "rtc/rtc_connection.h"
+#include "rtc/h264_rtp_source.h"
+#include "rtc/video_rate_controller.h"
+#include "rtc/keyframe_requester.h"
 #include "signaling_server.h"
 
 class RtcSignalingHandler : public SignalingHandler
@@ -14,10 +17,19 @@ public:
 	virtual void OnRemoteDescription(std::string uid, std::string remote_sdp);
 	virtual void SendVideoFrame(uint8_t* frame, size_t frame_size);
 	virtual void SendAudioFrame(uint8_t* frame, size_t frame_size);
+	virtual uint32_t UpdateVideoBitrate();
+	virtual bool UpdateKeyFrameRequest();
 
 private:
 	SignalingConfig signaling_config_;
 	std::shared_ptr<xop::EventLoop> event_loop_;
+	std::shared_ptr<UdpDemuxer> udp_demuxer_;
+	std::shared_ptr<SrtpWorkerPool> srtp_worker_pool_;
 	std::mutex conns_mutex_;
 	std::unordered_map<std::string, std::shared_ptr<RtcConnection>> rtc_conns_;
+	std::shared_ptr<const RtcConnectionList> conn_list_;
+	std::shared_ptr<H264RtpSource> video_source_;
+	std::shared_ptr<GopCache> gop_cache_;
+	VideoRateController video_rate_controller_;
+	KeyFrameRequester keyframe_requester_;
 };
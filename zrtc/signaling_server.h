@@ -12,6 +12,11 @@ struct SignalingConfig
 {
 	uint16_t port = 18080;
 	std::string host = "localhost";
+	uint16_t rtc_port = 10000;
+	uint32_t rtc_threads = std::thread::hardware_concurrency();
+	uint32_t min_keyframe_interval_ms = 1000; // at most one forced idr per interval for all viewers
+	uint32_t target_playout_delay_ms = 200; // nack while retransmissions fit in it, fec beyond
+	uint32_t srtp_threads = 0; // rtp protected on a pool of this many threads, 0: on the rtc threads
 
 	std::string cert_path;
 	std::string key_path;
@@ -24,6 +29,12 @@ public:
 	virtual void OnRemoteDescription(std::string uid, std::string remote_sdp) {}
 	virtual void SendVideoFrame(uint8_t* frame, size_t frame_size) {}
 	virtual void SendAudioFrame(uint8_t* frame, size_t frame_size) {}
+
+	// encoder bitrate that fits the viewers, 0 keeps the current one
+	virtual uint32_t UpdateVideoBitrate() { return 0; }
+
+	// true when a viewer waits for an idr and the encoder should send one now
+	virtual bool UpdateKeyFrameRequest() { return false; }
 };
 
 class SignalingServer
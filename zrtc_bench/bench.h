@@ -0,0 +1,8 @@
+#pragma once
+
+// Each benchmark prints its own table to stdout.
+void RunUdpSendBench();
+void RunUdpRecvBench();
+void RunTimerQueueBench();
+void RunFecXorBench();
+void RunSrtpBench();
@@ -0,0 +1,62 @@
+#include "bench.h"
+#include "rtc/fec_xor.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// The fec payload kernels the way FecEncoder::EncodeFec calls them: one fec payload
+// accumulates the payloads of a group of media packets. The selected kernel against the
+// scalar loop it falls back to, at the sizes of a full packet and of a short tail.
+
+namespace
+{
+
+using namespace std::chrono;
+
+static const size_t kGroupPackets = 8;
+static const size_t kBytesPerRun = 512 * 1024 * 1024;
+
+// GB/s of media payload folded into the fec payload
+double RunKernel(FecXorFunc xor_func, size_t payload_size)
+{
+	std::vector<std::vector<uint8_t>> media(kGroupPackets, std::vector<uint8_t>(payload_size));
+	for (size_t n = 0; n < kGroupPackets; n++) {
+		for (size_t m = 0; m < payload_size; m++) {
+			media[n][m] = (uint8_t)(n * 31 + m);
+		}
+	}
+
+	// the rtp header is 12 bytes and the fec header 20, the payloads are never 32 byte aligned
+	std::vector<uint8_t> fec(payload_size + 20);
+	uint8_t* fec_payload = fec.data() + 20;
+
+	size_t groups = kBytesPerRun / (kGroupPackets * payload_size) + 1;
+	auto begin = steady_clock::now();
+	for (size_t group = 0; group < groups; group++) {
+		for (size_t n = 0; n < kGroupPackets; n++) {
+			xor_func(fec_payload, media[n].data(), payload_size);
+		}
+	}
+	double elapsed_s = duration<double>(steady_clock::now() - begin).count();
+
+	// keep the result alive
+	volatile uint8_t sink = fec_payload[payload_size / 2];
+	(void)sink;
+	return (double)(groups * kGroupPackets * payload_size) / elapsed_s / 1e9;
+}
+
+}
+
+void RunFecXorBench()
+{
+	FecXorKernel kernel = GetFecXorKernel();
+	printf("selected kernel: %s, %zu media packets per fec packet\n", kernel.name, kGroupPackets);
+	printf("payload  scalar GB/s  %6s GB/s  speedup\n", kernel.name);
+
+	size_t payload_sizes[] = { 100, 500, 1188 };
+	for (size_t payload_size : payload_sizes) {
+		double scalar_rate = RunKernel(FecXorScalar, payload_size);
+		double kernel_rate = RunKernel(kernel.xor_func, payload_size);
+		printf("%7zu  %11.2f  %11.2f  %6.2fx\n", payload_size, scalar_rate, kernel_rate, kernel_rate / scalar_rate);
+	}
+}
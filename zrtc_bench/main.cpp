@@ -0,0 +1,37 @@
+#include "bench.h"
+#include <cstdio>
+#include <cstring>
+
+struct Bench
+{
+	const char* name;
+	void (*run)();
+};
+
+static const Bench kBenches[] = {
+	{ "udp_send", RunUdpSendBench },
+	{ "udp_recv", RunUdpRecvBench },
+	{ "timer_queue", RunTimerQueueBench },
+	{ "fec_xor", RunFecXorBench },
+	{ "srtp", RunSrtpBench },
+};
+
+// zrtc_bench [name ...], no name runs every benchmark
+int main(int argc, char** argv)
+{
+	for (auto& bench : kBenches) {
+		bool is_selected = argc < 2;
+		for (int n = 1; n < argc; n++) {
+			if (strcmp(argv[n], bench.name) == 0) {
+				is_selected = true;
+			}
+		}
+
+		if (is_selected) {
+			printf("== %s\n", bench.name);
+			bench.run();
+		}
+	}
+
+	return 0;
+}
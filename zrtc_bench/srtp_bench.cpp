@@ -0,0 +1,141 @@
+#include "bench.h"
+#include "rtc/srtp_session.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// SrtpSession::ProtectRtp and UnprotectRtp for each profile we negotiate, at the sizes of
+// an audio packet, a mid sized video packet and a full one. One session protects batches
+// of consecutive packets, a second session keyed the other way round unprotects them.
+
+namespace
+{
+
+using namespace std::chrono;
+
+static const int kBatchPackets = 1024;
+static const int kBatches = 200;
+
+struct SrtpProfileName
+{
+	RtcSrtpProfile profile;
+	const char* name;
+};
+
+static const SrtpProfileName kProfiles[] = {
+	{ RTC_SRTP_AES128_CM_SHA1_80, "AES128_CM_SHA1_80" },
+	{ RTC_SRTP_AEAD_AES_128_GCM, "AEAD_AES_128_GCM" },
+	{ RTC_SRTP_AEAD_AES_256_GCM, "AEAD_AES_256_GCM" },
+};
+
+std::string MakeKey(RtcSrtpProfile profile, uint8_t seed)
+{
+	std::string key(SrtpSession::GetKeyLength(profile) + SrtpSession::GetSaltLength(profile), '\0');
+	for (size_t n = 0; n < key.size(); n++) {
+		key[n] = (char)(seed + n * 13);
+	}
+	return key;
+}
+
+// packets/s of protect and unprotect, 0 when a packet fails
+void RunProfile(RtcSrtpProfile profile, size_t pkt_size, double& protect_pps, double& unprotect_pps)
+{
+	protect_pps = 0;
+	unprotect_pps = 0;
+
+	std::string local_key = MakeKey(profile, 1);
+	std::string remote_key = MakeKey(profile, 7);
+	SrtpSession sender;
+	SrtpSession receiver;
+	if (!sender.Init(profile, local_key, remote_key) || !receiver.Init(profile, remote_key, local_key)) {
+		return;
+	}
+
+	// room for the auth tag
+	size_t buffer_size = pkt_size + SRTP_MAX_TRAILER_LEN;
+	std::vector<uint8_t> buffer(kBatchPackets * buffer_size);
+	std::vector<int> sizes(kBatchPackets);
+
+	std::vector<uint8_t> rtp_pkt(pkt_size);
+	for (size_t n = 0; n < pkt_size; n++) {
+		rtp_pkt[n] = (uint8_t)(n * 7 + 3);
+	}
+	rtp_pkt[0] = 0x80;
+	rtp_pkt[1] = 96;
+	rtp_pkt[8] = 0x12;
+	rtp_pkt[9] = 0x34;
+	rtp_pkt[10] = 0x56;
+	rtp_pkt[11] = 0x78;
+
+	uint16_t sequence = 0;
+	uint32_t timestamp = 0;
+	steady_clock::duration protect_time(0);
+	steady_clock::duration unprotect_time(0);
+	for (int batch = 0; batch < kBatches; batch++) {
+		for (int n = 0; n < kBatchPackets; n++) {
+			uint8_t* pkt = buffer.data() + n * buffer_size;
+			memcpy(pkt, rtp_pkt.data(), pkt_size);
+			pkt[2] = (uint8_t)(sequence >> 8);
+			pkt[3] = (uint8_t)(sequence & 0xff);
+			pkt[4] = (uint8_t)(timestamp >> 24);
+			pkt[5] = (uint8_t)(timestamp >> 16);
+			pkt[6] = (uint8_t)(timestamp >> 8);
+			pkt[7] = (uint8_t)(timestamp & 0xff);
+			sequence++;
+			timestamp += 3000;
+		}
+
+		auto begin = steady_clock::now();
+		for (int n = 0; n < kBatchPackets; n++) {
+			sizes[n] = sender.ProtectRtp(buffer.data() + n * buffer_size, (int)pkt_size);
+		}
+		protect_time += steady_clock::now() - begin;
+
+		begin = steady_clock::now();
+		for (int n = 0; n < kBatchPackets; n++) {
+			if (sizes[n] <= 0 || receiver.UnprotectRtp(buffer.data() + n * buffer_size, sizes[n]) != (int)pkt_size) {
+				return;
+			}
+		}
+		unprotect_time += steady_clock::now() - begin;
+	}
+
+	double packets = (double)kBatches * kBatchPackets;
+	protect_pps = packets / duration<double>(protect_time).count();
+	unprotect_pps = packets / duration<double>(unprotect_time).count();
+}
+
+}
+
+void RunSrtpBench()
+{
+	if (srtp_init() != srtp_err_status_ok) {
+		printf("srtp_init failed\n");
+		return;
+	}
+
+	printf("libsrtp %s, %d packets per case\n", srtp_get_version_string(), kBatches * kBatchPackets);
+	printf("profile             size   protect pkt/s  Gbit/s   unprotect pkt/s  Gbit/s\n");
+
+	size_t pkt_sizes[] = { 200, 500, 1200 };
+	for (auto& profile : kProfiles) {
+		if (profile.profile != RTC_SRTP_AES128_CM_SHA1_80 && !SrtpSession::IsGcmSupported()) {
+			printf("%-18s  aes-gcm is not built into this libsrtp\n", profile.name);
+			continue;
+		}
+
+		for (size_t pkt_size : pkt_sizes) {
+			double protect_pps = 0;
+			double unprotect_pps = 0;
+			RunProfile(profile.profile, pkt_size, protect_pps, unprotect_pps);
+			if (protect_pps == 0) {
+				printf("%-18s %5zu   failed\n", profile.name, pkt_size);
+				continue;
+			}
+
+			printf("%-18s %5zu %15.0f %7.2f %17.0f %7.2f\n", profile.name, pkt_size,
+				protect_pps, protect_pps * pkt_size * 8 / 1e9, unprotect_pps, unprotect_pps * pkt_size * 8 / 1e9);
+		}
+	}
+}
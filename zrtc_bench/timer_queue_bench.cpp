@@ -0,0 +1,170 @@
+#include "bench.h"
+#include "net/Timer.h"
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// xop::TimerQueue (timing wheel) against the std::map queue it replaced.
+// Both are driven the way TaskScheduler drives them: one connection has a 5 ms nack timer
+// and a 1 s rtcp timer, the loop handles the expired ones every millisecond.
+
+namespace
+{
+
+using namespace std::chrono;
+
+// the previous TimerQueue, kept as it was apart from the names
+class MapTimerQueue
+{
+public:
+	xop::TimerId AddTimer(const xop::TimerEvent& event, uint32_t ms)
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+
+		int64_t timeout = GetTimeNow();
+		xop::TimerId timer_id = ++last_timer_id_;
+
+		auto timer = std::make_shared<MapTimer>();
+		timer->event_callback = event;
+		timer->interval = ms > 0 ? ms : 1;
+		timer->next_timeout = timeout + timer->interval;
+		timers_.emplace(timer_id, timer);
+		events_.emplace(std::pair<int64_t, xop::TimerId>(timeout + ms, timer_id), std::move(timer));
+		return timer_id;
+	}
+
+	void RemoveTimer(xop::TimerId timer_id)
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+
+		auto iter = timers_.find(timer_id);
+		if (iter != timers_.end()) {
+			int64_t timeout = iter->second->next_timeout;
+			events_.erase(std::pair<int64_t, xop::TimerId>(timeout, timer_id));
+			timers_.erase(timer_id);
+		}
+	}
+
+	void HandleTimerEvent()
+	{
+		if (!timers_.empty()) {
+			std::lock_guard<std::mutex> locker(mutex_);
+			int64_t time_point = GetTimeNow();
+			while (!timers_.empty() && events_.begin()->first.first <= time_point) {
+				xop::TimerId timer_id = events_.begin()->first.second;
+				bool flag = events_.begin()->second->event_callback();
+				if (flag == true) {
+					events_.begin()->second->next_timeout = time_point + events_.begin()->second->interval;
+					auto timer = std::move(events_.begin()->second);
+					events_.erase(events_.begin());
+					events_.emplace(std::pair<int64_t, xop::TimerId>(timer->next_timeout, timer_id), timer);
+				}
+				else {
+					events_.erase(events_.begin());
+					timers_.erase(timer_id);
+				}
+			}
+		}
+	}
+
+private:
+	struct MapTimer
+	{
+		xop::TimerEvent event_callback;
+		uint32_t interval = 0;
+		int64_t next_timeout = 0;
+	};
+
+	static int64_t GetTimeNow()
+	{
+		return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	std::mutex mutex_;
+	std::unordered_map<xop::TimerId, std::shared_ptr<MapTimer>> timers_;
+	std::map<std::pair<int64_t, xop::TimerId>, std::shared_ptr<MapTimer>> events_;
+	uint32_t last_timer_id_ = 0;
+};
+
+struct TimerResult
+{
+	double add_remove_ns = 0;
+	double fires_per_s = 0;
+	double ns_per_fire = 0;
+	double busy_percent = 0;
+};
+
+template <typename Queue>
+TimerResult RunQueue(uint32_t num_connections, int duration_ms)
+{
+	TimerResult result;
+	uint64_t fires = 0;
+	auto callback = [&fires] { fires++; return true; };
+
+	// add and remove without firing
+	{
+		Queue queue;
+		std::vector<xop::TimerId> timer_ids(num_connections * 2);
+		auto begin = steady_clock::now();
+		for (int round = 0; round < 10; round++) {
+			for (uint32_t n = 0; n < num_connections; n++) {
+				timer_ids[n * 2] = queue.AddTimer(callback, 5);
+				timer_ids[n * 2 + 1] = queue.AddTimer(callback, 1000);
+			}
+			for (auto timer_id : timer_ids) {
+				queue.RemoveTimer(timer_id);
+			}
+		}
+		double elapsed_ns = (double)duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+		result.add_remove_ns = elapsed_ns / (10.0 * timer_ids.size());
+	}
+
+	// steady state, the connections start spread over one nack interval
+	Queue queue;
+	for (uint32_t n = 0; n < num_connections; n++) {
+		if (n % (num_connections / 5 + 1) == 0) {
+			std::this_thread::sleep_for(milliseconds(1));
+		}
+		queue.AddTimer(callback, 5);
+		queue.AddTimer(callback, 1000);
+	}
+
+	fires = 0;
+	nanoseconds busy(0);
+	auto begin = steady_clock::now();
+	auto end = begin + milliseconds(duration_ms);
+	while (steady_clock::now() < end) {
+		auto handle_begin = steady_clock::now();
+		queue.HandleTimerEvent();
+		busy += duration_cast<nanoseconds>(steady_clock::now() - handle_begin);
+		std::this_thread::sleep_for(milliseconds(1));
+	}
+	double elapsed_s = duration<double>(steady_clock::now() - begin).count();
+
+	result.fires_per_s = fires / elapsed_s;
+	result.ns_per_fire = fires > 0 ? (double)busy.count() / fires : 0;
+	result.busy_percent = 100.0 * duration<double>(busy).count() / elapsed_s;
+	return result;
+}
+
+}
+
+void RunTimerQueueBench()
+{
+	const uint32_t connection_counts[] = { 1000, 5000, 20000 };
+	const int kDurationMs = 2000;
+
+	printf("connections  queue  add+remove ns  fires/s   ns/fire  loop busy\n");
+	for (uint32_t num_connections : connection_counts) {
+		TimerResult map_result = RunQueue<MapTimerQueue>(num_connections, kDurationMs);
+		TimerResult wheel_result = RunQueue<xop::TimerQueue>(num_connections, kDurationMs);
+		printf("%11u  map   %13.0f %9.0f %9.0f %8.1f%%\n", num_connections,
+			map_result.add_remove_ns, map_result.fires_per_s, map_result.ns_per_fire, map_result.busy_percent);
+		printf("%11u  wheel %13.0f %9.0f %9.0f %8.1f%%\n", num_connections,
+			wheel_result.add_remove_ns, wheel_result.fires_per_s, wheel_result.ns_per_fire, wheel_result.busy_percent);
+	}
+}
@@ -0,0 +1,205 @@
+#include "bench.h"
+#include "rtc/udp_demuxer.h"
+#include "rtc/udp_connection.h"
+#include "rtc/stun_source.h"
+#include "net/SocketUtil.h"
+#include "spdlog/spdlog.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Packets/s received through UdpDemuxer::OnPacket with 1 to 8 schedulers. Each peer socket
+// binds its own connection with a signed stun binding request, then sends 100 byte rtcp
+// feedback with a stun consent check every kStunInterval packets, from a few sender threads.
+// The reuseport filter spreads the peers over the schedulers' sockets, each connection counts
+// what its OnRecv is handed. What the receivers do not keep up with is dropped by the kernel.
+
+static const char* kLocalIp = "127.0.0.1";
+static const uint16_t kLocalPort = 17200;
+static const uint32_t kPeers = 64;
+static const uint32_t kSenderThreads = 4;
+static const size_t kRtcpSize = 100;
+static const uint32_t kStunInterval = 50;
+static const int kDurationMs = 2000;
+
+class RecvConnection : public UdpConnection
+{
+public:
+	RecvConnection(std::shared_ptr<xop::EventLoop> event_loop)
+		: UdpConnection(event_loop)
+	{ }
+
+	uint64_t GetRecvPackets() const
+	{ return recv_pkts_.load(std::memory_order_relaxed); }
+
+protected:
+	virtual void OnRecv(uint8_t* pkt, size_t size) override
+	{ recv_pkts_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> recv_pkts_{0};
+};
+
+struct RecvPeer
+{
+	SOCKET socket = 0;
+	std::shared_ptr<RecvConnection> conn;
+	std::vector<uint8_t> stun;
+};
+
+static std::vector<uint8_t> BuildBindingRequest(std::string ufrag, std::string pwd, uint32_t n)
+{
+	char transaction_id[13] = { 0 };
+	snprintf(transaction_id, sizeof(transaction_id), "bench%07u", n);
+
+	StunSource stun_source;
+	stun_source.SetMessageType(STUN_BINDING_REQUEST);
+	stun_source.SetTransactionId(transaction_id);
+	stun_source.SetUserame(ufrag + ":peer");
+	stun_source.SetPassword(pwd);
+	return stun_source.Build();
+}
+
+static void SendPackets(std::vector<RecvPeer*> peers, sockaddr_in server_addr,
+	std::atomic<bool>* is_running, uint64_t* sent_pkts)
+{
+	uint8_t rtcp[kRtcpSize] = { 0 };
+	rtcp[0] = 0x81;
+	rtcp[1] = 205;
+	rtcp[3] = kRtcpSize / 4 - 1;
+
+	uint64_t count = 0;
+	while (is_running->load(std::memory_order_relaxed)) {
+		for (auto peer : peers) {
+			bool is_stun = (count / peers.size()) % kStunInterval == 0;
+			const uint8_t* pkt = is_stun ? peer->stun.data() : rtcp;
+			size_t size = is_stun ? peer->stun.size() : kRtcpSize;
+			if (sendto(peer->socket, (const char*)pkt, (int)size, 0, (sockaddr*)&server_addr, sizeof(server_addr)) > 0) {
+				count++;
+			}
+		}
+	}
+
+	*sent_pkts = count;
+}
+
+static uint64_t GetRecvPackets(const std::vector<RecvPeer>& peers)
+{
+	uint64_t recv_pkts = 0;
+	for (auto& peer : peers) {
+		recv_pkts += peer.conn->GetRecvPackets();
+	}
+	return recv_pkts;
+}
+
+static void RunOnce(uint32_t num_threads, uint16_t port, double& sent_pps, double& recv_pps)
+{
+	sent_pps = 0;
+	recv_pps = 0;
+
+	// the first scheduler of a multi-threaded loop is not handed out to connections
+	auto event_loop = std::make_shared<xop::EventLoop>(num_threads > 1 ? num_threads + 1 : 1);
+	auto udp_demuxer = std::make_shared<UdpDemuxer>(event_loop);
+	if (!udp_demuxer->Init(kLocalIp, port)) {
+		printf("bind %s:%u failed\n", kLocalIp, port);
+		return;
+	}
+
+	sockaddr_in server_addr = {};
+	server_addr.sin_family = AF_INET;
+	server_addr.sin_addr.s_addr = inet_addr(kLocalIp);
+	server_addr.sin_port = htons(port);
+
+	std::vector<RecvPeer> peers(kPeers);
+	for (uint32_t n = 0; n < kPeers; n++) {
+		std::string ufrag = "ufrag" + std::to_string(n);
+		std::string pwd = "benchpassword" + std::to_string(1000000000 + n);
+
+		auto& peer = peers[n];
+		peer.socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+		xop::SocketUtil::SetSendBufSize(peer.socket, 1024 * 1024);
+		xop::SocketUtil::Bind(peer.socket, kLocalIp, 0);
+		peer.conn = std::make_shared<RecvConnection>(event_loop);
+		peer.conn->Init(udp_demuxer);
+		udp_demuxer->AddConnection(ufrag, pwd, peer.conn);
+		peer.stun = BuildBindingRequest(ufrag, pwd, n);
+	}
+
+	// every peer binds before the clock starts, a lost request is sent again
+	for (int retry = 0; retry < 50; retry++) {
+		bool is_bound = true;
+		for (auto& peer : peers) {
+			if (peer.conn->GetRecvPackets() == 0) {
+				is_bound = false;
+				sendto(peer.socket, (const char*)peer.stun.data(), (int)peer.stun.size(), 0,
+					(sockaddr*)&server_addr, sizeof(server_addr));
+			}
+		}
+		if (is_bound) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	std::atomic<bool> is_running(true);
+	std::vector<std::thread> senders;
+	std::vector<uint64_t> sent_pkts(kSenderThreads, 0);
+	uint64_t recv_begin = GetRecvPackets(peers);
+	auto begin = std::chrono::steady_clock::now();
+	for (uint32_t n = 0; n < kSenderThreads; n++) {
+		std::vector<RecvPeer*> sender_peers;
+		for (uint32_t i = n; i < kPeers; i += kSenderThreads) {
+			sender_peers.push_back(&peers[i]);
+		}
+		senders.emplace_back(SendPackets, sender_peers, server_addr, &is_running, &sent_pkts[n]);
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(kDurationMs));
+	is_running = false;
+	for (auto& sender : senders) {
+		sender.join();
+	}
+	double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	// what is still queued in the sockets counts as received
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	uint64_t recv_pkts = GetRecvPackets(peers) - recv_begin;
+
+	uint64_t total_sent = 0;
+	for (uint64_t count : sent_pkts) {
+		total_sent += count;
+	}
+	sent_pps = total_sent / elapsed_s;
+	recv_pps = recv_pkts / elapsed_s;
+
+	for (auto& peer : peers) {
+		peer.conn->Destroy();
+		xop::SocketUtil::Close(peer.socket);
+	}
+	udp_demuxer->Destroy();
+	event_loop->Quit();
+}
+
+void RunUdpRecvBench()
+{
+	const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+
+	// one bind log per peer and run would bury the table
+	spdlog::set_level(spdlog::level::warn);
+
+	printf("threads   sent pkt/s   recv pkt/s   loss   (cpus: %u, peers: %u, senders: %u)\n",
+		std::thread::hardware_concurrency(), kPeers, kSenderThreads);
+	uint16_t port = kLocalPort;
+	for (uint32_t num_threads : thread_counts) {
+		double sent_pps = 0;
+		double recv_pps = 0;
+		RunOnce(num_threads, port++, sent_pps, recv_pps);
+		double loss = sent_pps > 0 ? 100.0 * (1.0 - recv_pps / sent_pps) : 0;
+		printf("%7u %12.0f %12.0f %5.1f%%\n", num_threads, sent_pps, recv_pps, loss);
+	}
+
+	spdlog::set_level(spdlog::level::info);
+}
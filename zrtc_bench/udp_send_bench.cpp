@@ -0,0 +1,160 @@
+#include "bench.h"
+#include "rtc/udp_demuxer.h"
+#include "net/SocketUtil.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#if defined(__linux) || defined(__linux__)
+#include <time.h>
+#endif
+
+// Packets/s through UdpDemuxer::SendBatch with 1 to 8 schedulers. Every scheduler sends
+// full batches of 1200 byte packets from its own socket, as the connections pinned to it do,
+// to a local socket that is never read, so the kernel drops what does not fit.
+// The cpu cost is the process cpu time per Gbit of payload sent, loopback delivery up to the
+// sink's queue runs on the sending cpu and is part of it.
+
+static const char* kLocalIp = "127.0.0.1";
+static const uint16_t kLocalPort = 17000;
+static const uint16_t kSinkPort = 17100;
+static const size_t kPacketSize = 1200;
+static const int kBatchesPerTask = 16;
+static const int kDurationMs = 2000;
+
+struct SendState
+{
+	std::shared_ptr<UdpDemuxer> udp_demuxer;
+	std::shared_ptr<xop::TaskScheduler> task_scheduler;
+	int socket_index = 0;
+	sockaddr_in peer_addr = {};
+	std::chrono::steady_clock::time_point deadline;
+	std::unique_ptr<uint8_t[]> buffer;
+	uint8_t* pkts[RTC_UDP_BATCH_SIZE];
+	size_t sizes[RTC_UDP_BATCH_SIZE];
+	uint64_t sent_pkts = 0;
+	std::atomic<bool> is_done{false};
+};
+
+struct SendResult
+{
+	double pps = 0;
+	double cpu_s_per_gbit = 0;
+};
+
+static double GetProcessCpuSeconds()
+{
+#if defined(__linux) || defined(__linux__)
+	timespec ts = {};
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#elif defined(WIN32) || defined(_WIN32)
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+		return 0;
+	}
+	ULARGE_INTEGER kernel, user;
+	kernel.LowPart = kernel_time.dwLowDateTime;
+	kernel.HighPart = kernel_time.dwHighDateTime;
+	user.LowPart = user_time.dwLowDateTime;
+	user.HighPart = user_time.dwHighDateTime;
+	return (kernel.QuadPart + user.QuadPart) / 1e7;
+#else
+	return 0;
+#endif
+}
+
+// a few batches per task, so the scheduler keeps running its loop in between
+static void SendBatches(SendState* state)
+{
+	for (int n = 0; n < kBatchesPerTask; n++) {
+		int sent = state->udp_demuxer->SendBatch(state->pkts, state->sizes, RTC_UDP_BATCH_SIZE,
+			state->peer_addr, state->socket_index);
+		if (sent > 0) {
+			state->sent_pkts += sent;
+		}
+	}
+
+	if (std::chrono::steady_clock::now() >= state->deadline
+		|| !state->task_scheduler->AddTriggerEvent([state] { SendBatches(state); })) {
+		state->is_done = true;
+	}
+}
+
+static SendResult RunOnce(uint32_t num_threads, bool enable_gso, uint16_t port)
+{
+	SendResult result;
+
+	// the first scheduler of a multi-threaded loop is not handed out to connections
+	auto event_loop = std::make_shared<xop::EventLoop>(num_threads > 1 ? num_threads + 1 : 1);
+	auto udp_demuxer = std::make_shared<UdpDemuxer>(event_loop);
+	if (!udp_demuxer->Init(kLocalIp, port)) {
+		printf("bind %s:%u failed\n", kLocalIp, port);
+		return result;
+	}
+	udp_demuxer->EnableGso(enable_gso);
+
+	SOCKET sink = ::socket(AF_INET, SOCK_DGRAM, 0);
+	xop::SocketUtil::Bind(sink, kLocalIp, kSinkPort);
+
+	sockaddr_in peer_addr = {};
+	peer_addr.sin_family = AF_INET;
+	peer_addr.sin_addr.s_addr = inet_addr(kLocalIp);
+	peer_addr.sin_port = htons(kSinkPort);
+
+	auto task_schedulers = event_loop->GetTaskSchedulers();
+	std::vector<std::unique_ptr<SendState>> states;
+	double cpu_begin = GetProcessCpuSeconds();
+	auto begin = std::chrono::steady_clock::now();
+	for (auto& task_scheduler : task_schedulers) {
+		std::unique_ptr<SendState> state(new SendState);
+		state->udp_demuxer = udp_demuxer;
+		state->task_scheduler = task_scheduler;
+		state->socket_index = udp_demuxer->GetSocketIndex(task_scheduler);
+		state->peer_addr = peer_addr;
+		state->deadline = begin + std::chrono::milliseconds(kDurationMs);
+		state->buffer.reset(new uint8_t[RTC_UDP_BATCH_SIZE * kPacketSize]);
+		memset(state->buffer.get(), 0x5a, RTC_UDP_BATCH_SIZE * kPacketSize);
+		for (size_t n = 0; n < RTC_UDP_BATCH_SIZE; n++) {
+			state->pkts[n] = state->buffer.get() + n * kPacketSize;
+			state->sizes[n] = kPacketSize;
+		}
+
+		SendState* send_state = state.get();
+		task_scheduler->AddTriggerEvent([send_state] { SendBatches(send_state); });
+		states.push_back(std::move(state));
+	}
+
+	uint64_t sent_pkts = 0;
+	for (auto& state : states) {
+		while (!state->is_done) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		sent_pkts += state->sent_pkts;
+	}
+	double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	double cpu_s = GetProcessCpuSeconds() - cpu_begin;
+
+	udp_demuxer->Destroy();
+	event_loop->Quit();
+	xop::SocketUtil::Close(sink);
+
+	double sent_gbit = sent_pkts * kPacketSize * 8 / 1e9;
+	result.pps = sent_pkts / elapsed_s;
+	result.cpu_s_per_gbit = sent_gbit > 0 ? cpu_s / sent_gbit : 0;
+	return result;
+}
+
+void RunUdpSendBench()
+{
+	const uint32_t thread_counts[] = { 1, 2, 4, 8 };
+
+	// cpu s/Gbit is the number of cores kept busy per Gbit/s
+	printf("threads   sendmmsg pkt/s  cpu s/Gbit   gso pkt/s  cpu s/Gbit   (cpus: %u)\n", std::thread::hardware_concurrency());
+	uint16_t port = kLocalPort;
+	for (uint32_t num_threads : thread_counts) {
+		SendResult plain = RunOnce(num_threads, false, port++);
+		SendResult gso = RunOnce(num_threads, true, port++);
+		printf("%7u %16.0f %11.3f %11.0f %11.3f\n", num_threads, plain.pps, plain.cpu_s_per_gbit,
+			gso.pps, gso.cpu_s_per_gbit);
+	}
+}
@@ -0,0 +1,103 @@
+#include "test.h"
+#include "rtc/fec_xor.h"
+#include <cstring>
+#include <vector>
+
+// The fec payload kernels against a byte loop, over every size up to a few vector widths
+// and the packet sizes the encoder sees, with both buffers misaligned by up to 31 bytes.
+
+namespace
+{
+
+static const size_t kMaxSize = 1500;
+static const size_t kMaxOffset = 31;
+// canaries around the destination catch a kernel writing past its size
+static const size_t kGuardSize = 64;
+static const uint8_t kGuardByte = 0xa5;
+
+class Random
+{
+public:
+	uint8_t Next()
+	{
+		seed_ = seed_ * 1103515245 + 12345;
+		return (uint8_t)(seed_ >> 24);
+	}
+
+private:
+	uint32_t seed_ = 1;
+};
+
+void XorReference(uint8_t* dst, const uint8_t* src, size_t size)
+{
+	for (size_t n = 0; n < size; n++) {
+		dst[n] ^= src[n];
+	}
+}
+
+int TestKernel(const FecXorKernel& kernel)
+{
+	int failures = 0;
+	Random random;
+	std::vector<uint8_t> src(kMaxSize + kMaxOffset);
+	std::vector<uint8_t> dst(kGuardSize + kMaxSize + kMaxOffset + kGuardSize);
+	std::vector<uint8_t> expected(dst.size());
+
+	std::vector<size_t> sizes;
+	for (size_t size = 0; size <= 300; size++) {
+		sizes.push_back(size);
+	}
+	sizes.push_back(1024);
+	sizes.push_back(1188);
+	sizes.push_back(1200);
+	sizes.push_back(kMaxSize);
+
+	size_t cases = 0;
+	size_t mismatches = 0;
+	for (size_t size : sizes) {
+		for (size_t src_offset = 0; src_offset <= kMaxOffset; src_offset += 1 + src_offset / 4) {
+			for (size_t dst_offset = 0; dst_offset <= kMaxOffset; dst_offset += 1 + dst_offset / 4) {
+				for (auto& byte : src) {
+					byte = random.Next();
+				}
+				memset(dst.data(), kGuardByte, dst.size());
+				for (size_t n = 0; n < size; n++) {
+					dst[kGuardSize + dst_offset + n] = random.Next();
+				}
+				expected = dst;
+
+				XorReference(&expected[kGuardSize + dst_offset], &src[src_offset], size);
+				kernel.xor_func(&dst[kGuardSize + dst_offset], &src[src_offset], size);
+				if (dst != expected) {
+					if (mismatches++ == 0) {
+						printf("  %s differs: size %zu, src offset %zu, dst offset %zu\n",
+							kernel.name, size, src_offset, dst_offset);
+					}
+				}
+				cases++;
+			}
+		}
+	}
+
+	printf("  %-6s %zu cases, %zu mismatches\n", kernel.name, cases, mismatches);
+	TEST_CHECK(failures, mismatches == 0);
+	return failures;
+}
+
+}
+
+int RunFecXorTest()
+{
+	int failures = 0;
+	FecXorKernel scalar = { "scalar", FecXorScalar };
+	FecXorKernel selected = GetFecXorKernel();
+
+	failures += TestKernel(scalar);
+	if (selected.xor_func != FecXorScalar) {
+		failures += TestKernel(selected);
+	}
+
+	// fec_encoder.cpp takes the kernel once at startup, it has to be stable
+	TEST_CHECK(failures, GetFecXorKernel().xor_func == selected.xor_func);
+	return failures;
+}
@@ -0,0 +1,193 @@
+#include "test.h"
+#include "avcodec/h264_encoder.h"
+#include <algorithm>
+#include <vector>
+
+// H264Encoder::Reconfigure on a 640x360 BGRA pattern that moves every frame:
+// a bitrate drop takes effect within one vbv window (one second) without an idr or a frame
+// the size of one, and a new resolution waits for the gop boundary.
+
+namespace
+{
+
+static const uint32_t kWidth = 640;
+static const uint32_t kHeight = 360;
+static const uint32_t kFramerate = 30;
+
+class Pattern
+{
+public:
+	Pattern(uint32_t width, uint32_t height)
+		: width_(width), height_(height), image_(width * height * 4)
+	{ }
+
+	// a texture scrolling diagonally with some noise, the encoder has to spend bits on every frame
+	const uint8_t* Next()
+	{
+		for (uint32_t y = 0; y < height_; y++) {
+			for (uint32_t x = 0; x < width_; x++) {
+				seed_ = seed_ * 1103515245 + 12345;
+				uint8_t noise = (uint8_t)(seed_ >> 27);
+				uint8_t* pixel = &image_[(y * width_ + x) * 4];
+				pixel[0] = (uint8_t)((x + frame_ * 3) ^ (y + frame_)) + noise;
+				pixel[1] = (uint8_t)((x * y + frame_ * 5) >> 3) + noise;
+				pixel[2] = (uint8_t)(y * 2 + frame_ * 7) + noise;
+				pixel[3] = 255;
+			}
+		}
+		frame_++;
+		return image_.data();
+	}
+
+	uint32_t GetSize() const
+	{ return (uint32_t)image_.size(); }
+
+private:
+	uint32_t width_ = 0;
+	uint32_t height_ = 0;
+	uint32_t frame_ = 0;
+	uint32_t seed_ = 1;
+	std::vector<uint8_t> image_;
+};
+
+struct EncodedFrame
+{
+	size_t size = 0;
+	bool is_keyframe = false;
+	int width = 0;
+};
+
+bool EncodeFrames(ffmpeg::H264Encoder& encoder, Pattern& pattern, uint32_t num_frames, std::vector<EncodedFrame>& frames)
+{
+	for (uint32_t n = 0; n < num_frames; n++) {
+		ffmpeg::AVPacketPtr av_packet = encoder.Encode(pattern.Next(), kWidth, kHeight, pattern.GetSize());
+		if (!av_packet) {
+			return false;
+		}
+
+		EncodedFrame frame;
+		frame.size = av_packet->size;
+		frame.is_keyframe = (av_packet->flags & AV_PKT_FLAG_KEY) != 0;
+		frame.width = encoder.GetAVCodecContext()->width;
+		frames.push_back(frame);
+	}
+	return true;
+}
+
+// bits per second over frames [begin, end)
+uint32_t GetBitrate(const std::vector<EncodedFrame>& frames, size_t begin, size_t end)
+{
+	size_t bytes = 0;
+	for (size_t n = begin; n < end; n++) {
+		bytes += frames[n].size;
+	}
+	return (uint32_t)(bytes * 8 * kFramerate / (end - begin));
+}
+
+int TestBitrateChange()
+{
+	int failures = 0;
+
+	// one gop for the whole run, any idr after the first frame comes from the reconfiguration
+	AVConfig av_config;
+	av_config.video.width = kWidth;
+	av_config.video.height = kHeight;
+	av_config.video.framerate = kFramerate;
+	av_config.video.gop = 1000;
+	av_config.video.bitrate = 1500000;
+
+	ffmpeg::H264Encoder encoder;
+	Pattern pattern(kWidth, kHeight);
+	std::vector<EncodedFrame> frames;
+	TEST_CHECK(failures, encoder.Init(av_config));
+	TEST_CHECK(failures, EncodeFrames(encoder, pattern, 3 * kFramerate, frames));
+	if (failures > 0) {
+		return failures;
+	}
+
+	// 1.5 Mbps -> 500 kbps, the vbv buffer follows: one second of the new bitrate
+	VideoConfig video_config = av_config.video;
+	video_config.bitrate = 500000;
+	size_t change = frames.size();
+	TEST_CHECK(failures, encoder.Reconfigure(video_config));
+	TEST_CHECK(failures, EncodeFrames(encoder, pattern, 3 * kFramerate, frames));
+	if (failures > 0) {
+		return failures;
+	}
+
+	size_t largest_p_frame = 0;
+	for (size_t n = kFramerate; n < change; n++) {
+		largest_p_frame = std::max(largest_p_frame, frames[n].size);
+	}
+
+	size_t largest_frame_after = 0;
+	size_t keyframes_after = 0;
+	for (size_t n = change; n < frames.size(); n++) {
+		largest_frame_after = std::max(largest_frame_after, frames[n].size);
+		keyframes_after += frames[n].is_keyframe ? 1 : 0;
+	}
+
+	uint32_t bitrate_before = GetBitrate(frames, kFramerate, change);
+	uint32_t bitrate_first_window = GetBitrate(frames, change, change + kFramerate);
+	uint32_t bitrate_second_window = GetBitrate(frames, change + kFramerate, change + 2 * kFramerate);
+	printf("  bitrate before %u, first window %u, second window %u, largest frame before %zu after %zu\n",
+		bitrate_before, bitrate_first_window, bitrate_second_window, largest_p_frame, largest_frame_after);
+
+	TEST_CHECK(failures, frames[0].is_keyframe);
+	TEST_CHECK(failures, keyframes_after == 0);
+	TEST_CHECK(failures, largest_frame_after <= largest_p_frame);
+	// x264_encoder_reconfig rescales the fill to the new buffer, so the window ending one vbv
+	// duration after the change is already near the new bitrate, it may still spend what was left
+	// in the buffer. the next one runs at the new bitrate
+	TEST_CHECK(failures, bitrate_first_window < bitrate_before);
+	TEST_CHECK(failures, bitrate_first_window <= video_config.bitrate * 3 / 2);
+	TEST_CHECK(failures, bitrate_first_window >= video_config.bitrate / 2);
+	TEST_CHECK(failures, bitrate_second_window <= video_config.bitrate * 13 / 10);
+	TEST_CHECK(failures, bitrate_second_window >= video_config.bitrate / 2);
+	return failures;
+}
+
+int TestResolutionChange()
+{
+	int failures = 0;
+
+	AVConfig av_config;
+	av_config.video.width = kWidth;
+	av_config.video.height = kHeight;
+	av_config.video.framerate = kFramerate;
+	av_config.video.gop = kFramerate;
+	av_config.video.bitrate = 1000000;
+
+	ffmpeg::H264Encoder encoder;
+	Pattern pattern(kWidth, kHeight);
+	std::vector<EncodedFrame> frames;
+	TEST_CHECK(failures, encoder.Init(av_config));
+	TEST_CHECK(failures, EncodeFrames(encoder, pattern, 10, frames));
+
+	VideoConfig video_config = av_config.video;
+	video_config.width = kWidth / 2;
+	video_config.height = kHeight / 2;
+	TEST_CHECK(failures, encoder.Reconfigure(video_config));
+	TEST_CHECK(failures, EncodeFrames(encoder, pattern, 2 * kFramerate - 10, frames));
+	if (failures > 0) {
+		return failures;
+	}
+
+	// the rest of the first gop keeps the old size, the second starts with an idr at the new one
+	for (size_t n = 1; n < kFramerate; n++) {
+		TEST_CHECK(failures, !frames[n].is_keyframe && frames[n].width == (int)kWidth);
+	}
+	TEST_CHECK(failures, frames[kFramerate].is_keyframe);
+	TEST_CHECK(failures, frames[kFramerate].width == (int)kWidth / 2);
+	for (size_t n = kFramerate + 1; n < frames.size(); n++) {
+		TEST_CHECK(failures, !frames[n].is_keyframe && frames[n].width == (int)kWidth / 2);
+	}
+	return failures;
+}
+
+}
+
+int RunH264EncoderTest()
+{
+	return TestBitrateChange() + TestResolutionChange();
+}
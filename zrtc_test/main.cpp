@@ -0,0 +1,39 @@
+#include "test.h"
+#include <cstdio>
+#include <cstring>
+
+struct Test
+{
+	const char* name;
+	int (*run)();
+};
+
+static const Test kTests[] = {
+	{ "rtp_pacer", RunRtpPacerTest },
+	{ "h264_encoder", RunH264EncoderTest },
+	{ "fec_xor", RunFecXorTest },
+	{ "packet_pool", RunPacketPoolTest },
+};
+
+// zrtc_test [name ...], no name runs every test, exits with the number of failed tests
+int main(int argc, char** argv)
+{
+	int failed_tests = 0;
+	for (auto& test : kTests) {
+		bool is_selected = argc < 2;
+		for (int n = 1; n < argc; n++) {
+			if (strcmp(argv[n], test.name) == 0) {
+				is_selected = true;
+			}
+		}
+
+		if (is_selected) {
+			printf("== %s\n", test.name);
+			int failures = test.run();
+			printf("== %s %s\n", test.name, failures == 0 ? "passed" : "FAILED");
+			failed_tests += failures > 0 ? 1 : 0;
+		}
+	}
+
+	return failed_tests;
+}
@@ -0,0 +1,226 @@
+#include "test.h"
+#include "rtc/h264_rtp_source.h"
+#include "rtc/gop_cache.h"
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Steady state packetization the way RtcServer runs it: a shared H264RtpSource with fec
+// packetizes each frame into one RtpFrame, the gop cache keeps it, and each viewer's own
+// H264RtpSource stamps its copy with rtx history and fec. The viewer hands its packets on
+// in a frame of its own, dropped on a worker thread as a scheduler would.
+// Once the warm up has filled the rtx history rings (the test outruns their age limit),
+// no frame takes a heap allocation or a new slab.
+
+// counts every operator new of the test binary, only the deltas below are checked
+static std::atomic<uint64_t> s_heap_allocs(0);
+
+void* operator new(size_t size)
+{
+	s_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(size > 0 ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+namespace
+{
+
+static const uint32_t kViewers = 4;
+static const uint32_t kGop = 30;
+static const uint32_t kWarmUpFrames = 20 * kGop;
+static const uint32_t kFrames = 10 * kGop;
+static const uint32_t kKeyFrameSize = 60000;
+static const uint32_t kFrameSize = 6000;
+
+struct Counters
+{
+	uint64_t heap_allocs = 0;
+	xop::PacketPool::Stats pool;
+};
+
+Counters GetCounters()
+{
+	Counters counters;
+	counters.heap_allocs = s_heap_allocs.load(std::memory_order_relaxed);
+	counters.pool = xop::PacketPool::GetStats();
+	return counters;
+}
+
+// drops a frame on another thread, with no allocation on the way
+class Releaser
+{
+public:
+	Releaser()
+		: thread_([this] { Run(); })
+	{ }
+
+	~Releaser()
+	{
+		is_running_ = false;
+		thread_.join();
+	}
+
+	void Release(RtpFramePtr& frame)
+	{
+		frame_ = std::move(frame);
+		is_pending_.store(true, std::memory_order_release);
+		while (is_pending_.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+	}
+
+private:
+	void Run()
+	{
+		while (is_running_) {
+			if (is_pending_.load(std::memory_order_acquire)) {
+				frame_.reset();
+				is_pending_.store(false, std::memory_order_release);
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	RtpFramePtr frame_;
+	std::atomic<bool> is_pending_{false};
+	std::atomic<bool> is_running_{true};
+	std::thread thread_;
+};
+
+// annex-b nal units as the encoder thread delivers them, sps and pps before every idr
+class FrameSource
+{
+public:
+	FrameSource()
+		: frame_(4 + kKeyFrameSize)
+	{
+		uint8_t sps[] = { 0, 0, 0, 1, 0x67, 0x42, 0xc0, 0x1f, 0x8c, 0x8d, 0x40, 0x50, 0x1e, 0x90, 0x0f, 0x08, 0x84, 0x6a };
+		uint8_t pps[] = { 0, 0, 0, 1, 0x68, 0xce, 0x3c, 0x80 };
+		sps_.assign(sps, sps + sizeof(sps));
+		pps_.assign(pps, pps + sizeof(pps));
+
+		for (size_t n = 0; n < frame_.size(); n++) {
+			frame_[n] = (uint8_t)(n * 7 + 1);
+		}
+		frame_[0] = 0;
+		frame_[1] = 0;
+		frame_[2] = 0;
+		frame_[3] = 1;
+	}
+
+	void Input(uint32_t frame, H264RtpSource& source)
+	{
+		if (frame % kGop == 0) {
+			source.InputFrame(sps_.data(), sps_.size());
+			source.InputFrame(pps_.data(), pps_.size());
+			frame_[4] = 0x65;
+			source.InputFrame(frame_.data(), 4 + kKeyFrameSize);
+		}
+		else {
+			frame_[4] = 0x41;
+			source.InputFrame(frame_.data(), 4 + kFrameSize);
+		}
+	}
+
+private:
+	std::vector<uint8_t> sps_;
+	std::vector<uint8_t> pps_;
+	std::vector<uint8_t> frame_;
+};
+
+}
+
+int RunPacketPoolTest()
+{
+	int failures = 0;
+	Releaser releaser;
+	FrameSource frame_source;
+	GopCache gop_cache;
+	uint64_t shared_packets = 0;
+	uint64_t viewer_packets = 0;
+	uint64_t fec_packets = 0;
+
+	std::vector<std::shared_ptr<H264RtpSource>> viewers;
+	for (uint32_t n = 0; n < kViewers; n++) {
+		auto viewer = std::make_shared<H264RtpSource>(1000 + n, RTC_MEDIA_CODEC_H264);
+		viewer->SetRtx(2000 + n, RTC_MEDIA_CODEC_RTX);
+		viewer->SetFec(3000 + n, RTC_MEDIA_CODEC_FEC);
+		viewer->SetExtension(RTP_EXTENSION_TWCC);
+		viewer->SetSendPacketCallback([&](std::vector<RtpPacketPtr>& rtp_pkts) {
+			for (auto& rtp_pkt : rtp_pkts) {
+				fec_packets += rtp_pkt->is_fec_;
+			}
+			viewer_packets += rtp_pkts.size();
+
+			// RtcConnection::OnSendRtpPackets
+			auto frame = RtpFrame::Create();
+			frame->packets.swap(rtp_pkts);
+			releaser.Release(frame);
+		});
+		viewers.push_back(viewer);
+	}
+
+	// RtcServer::Init, the fec is sized for 10% loss
+	H264RtpSource video_source(1, RTC_MEDIA_CODEC_H264);
+	video_source.SetFec(2, RTC_MEDIA_CODEC_FEC);
+	video_source.SetExtension(RTP_EXTENSION_TWCC);
+	video_source.UpdateQoS(50, 10, 0);
+	video_source.SetSendPacketCallback([&](std::vector<RtpPacketPtr>& rtp_pkts) {
+		auto frame = RtpFrame::Create();
+		frame->packets.swap(rtp_pkts);
+		gop_cache.InputFrame(frame, frame->packets.front()->frame_type == RTC_H264_FRAME_TYPE_IDR);
+		shared_packets += frame->packets.size();
+
+		// RtcConnection::SendVideoPackets, on each viewer's scheduler
+		for (auto& viewer : viewers) {
+			viewer->InputRtpPackets(frame->packets);
+		}
+	});
+
+	for (uint32_t frame = 0; frame < kWarmUpFrames; frame++) {
+		frame_source.Input(frame, video_source);
+	}
+
+	shared_packets = 0;
+	viewer_packets = 0;
+	fec_packets = 0;
+	Counters before = GetCounters();
+	for (uint32_t frame = kWarmUpFrames; frame < kWarmUpFrames + kFrames; frame++) {
+		frame_source.Input(frame, video_source);
+	}
+	Counters after = GetCounters();
+
+	uint64_t heap_allocs = after.heap_allocs - before.heap_allocs;
+	uint64_t pool_allocs = after.pool.alloc_count - before.pool.alloc_count;
+	uint64_t new_slabs = after.pool.slab_count - before.pool.slab_count;
+	printf("  %u frames, %u viewers: %llu shared packets, %llu viewer packets (%llu fec)\n",
+		kFrames, kViewers, (unsigned long long)shared_packets, (unsigned long long)viewer_packets,
+		(unsigned long long)fec_packets);
+	printf("  heap allocations %llu, pool alloc %llu, new slabs %llu, slab bytes %llu\n",
+		(unsigned long long)heap_allocs, (unsigned long long)pool_allocs,
+		(unsigned long long)new_slabs, (unsigned long long)after.pool.slab_bytes);
+
+	TEST_CHECK(failures, shared_packets > 0);
+	TEST_CHECK(failures, fec_packets > 0);
+	TEST_CHECK(failures, viewer_packets == shared_packets * kViewers);
+	TEST_CHECK(failures, pool_allocs == shared_packets * (kViewers + 1));
+	TEST_CHECK(failures, heap_allocs == 0);
+	TEST_CHECK(failures, new_slabs == 0);
+	return failures;
+}
@@ -0,0 +1,168 @@
+#include "test.h"
+#include "rtc/rtp_pacer.h"
+#include <algorithm>
+#include <vector>
+
+// A 6 s trace of one connection replayed on a simulated 5 Mbps bottleneck, once handed to the
+// link as it is produced and once through RtpPacer on its 5 ms timer at the connection's pacing rate:
+// 1.5 Mbps video at 30 fps with a 200 KB idr every second, one fec packet per frame,
+// a retransmission every 100 ms and 20 ms audio frames.
+
+namespace
+{
+
+static const int64_t  kStartUs = 1000000; // the pacer takes time 0 as not started
+static const int64_t  kTraceUs = 6000000;
+static const int64_t  kDrainUs = 2000000;
+static const int64_t  kLinkBitrate = 5000000;
+static const uint32_t kTargetBitrate = 1500000;
+static const uint32_t kPacketSize = 1200;
+static const uint32_t kKeyFrameSize = 200000;
+static const uint32_t kFrameSize = 6000;
+static const uint32_t kAudioSize = 160;
+static const int64_t  kFrameIntervalUs = 1000000 / 30;
+
+struct TracePacket
+{
+	int64_t time_us = 0;
+	RtpPacketPriority priority = RTP_PRIORITY_VIDEO;
+	uint32_t size = 0;
+};
+
+struct LinkStats
+{
+	// waiting in the bottleneck queue
+	int64_t max_link_delay_us = 0;
+	// from being produced to leaving the link
+	int64_t max_delay_us[RTP_PRIORITY_MAX] = {};
+	size_t packets = 0;
+};
+
+// fifo drained at kLinkBitrate
+class Link
+{
+public:
+	void Send(int64_t now_us, const TracePacket& pkt, LinkStats& stats)
+	{
+		int64_t start_us = std::max(now_us, free_time_us_);
+		free_time_us_ = start_us + (int64_t)pkt.size * 8 * 1000000 / kLinkBitrate;
+		stats.max_link_delay_us = std::max(stats.max_link_delay_us, start_us - now_us);
+		stats.max_delay_us[pkt.priority] = std::max(stats.max_delay_us[pkt.priority], free_time_us_ - pkt.time_us);
+		stats.packets++;
+	}
+
+private:
+	int64_t free_time_us_ = 0;
+};
+
+void AddPackets(std::vector<TracePacket>& trace, int64_t time_us, RtpPacketPriority priority,
+	uint32_t bytes, uint32_t packet_size)
+{
+	while (bytes > 0) {
+		TracePacket pkt;
+		pkt.time_us = time_us;
+		pkt.priority = priority;
+		pkt.size = std::min(bytes, packet_size);
+		trace.push_back(pkt);
+		bytes -= pkt.size;
+	}
+}
+
+std::vector<TracePacket> BuildTrace()
+{
+	std::vector<TracePacket> trace;
+	for (int64_t time_us = 0; time_us < kTraceUs; time_us += 1000) {
+		if (time_us % 20000 == 0) {
+			AddPackets(trace, kStartUs + time_us, RTP_PRIORITY_AUDIO, kAudioSize, kAudioSize);
+		}
+		if (time_us % 100000 == 50000) {
+			AddPackets(trace, kStartUs + time_us, RTP_PRIORITY_RTX, kPacketSize, kPacketSize);
+		}
+	}
+
+	for (int64_t frame = 0; frame * kFrameIntervalUs < kTraceUs; frame++) {
+		int64_t time_us = kStartUs + frame * kFrameIntervalUs;
+		AddPackets(trace, time_us, RTP_PRIORITY_VIDEO, frame % 30 == 0 ? kKeyFrameSize : kFrameSize, kPacketSize);
+		AddPackets(trace, time_us, RTP_PRIORITY_FEC, kPacketSize, kPacketSize);
+	}
+
+	std::stable_sort(trace.begin(), trace.end(), [](const TracePacket& a, const TracePacket& b) {
+		return a.time_us < b.time_us;
+	});
+	return trace;
+}
+
+void PrintStats(const char* mode, const LinkStats& stats)
+{
+	printf("  %-8s %10.1f %9.1f %8.1f %9.1f %8.1f\n", mode, stats.max_link_delay_us / 1000.0,
+		stats.max_delay_us[RTP_PRIORITY_AUDIO] / 1000.0, stats.max_delay_us[RTP_PRIORITY_RTX] / 1000.0,
+		stats.max_delay_us[RTP_PRIORITY_VIDEO] / 1000.0, stats.max_delay_us[RTP_PRIORITY_FEC] / 1000.0);
+}
+
+}
+
+int RunRtpPacerTest()
+{
+	int failures = 0;
+	std::vector<TracePacket> trace = BuildTrace();
+
+	// line rate: every packet reaches the link when it is produced
+	LinkStats unpaced;
+	Link unpaced_link;
+	for (auto& pkt : trace) {
+		unpaced_link.Send(pkt.time_us, pkt, unpaced);
+	}
+
+	// paced: the trace index travels in the rtp timestamp
+	LinkStats paced;
+	Link paced_link;
+	RtpPacer pacer;
+	uint32_t pacing_rate = static_cast<uint32_t>(kTargetBitrate * RTC_PACER_PACING_FACTOR);
+	pacer.SetPacingRate(pacing_rate);
+
+	size_t next_pkt = 0;
+	bool is_priority_ordered = true;
+	for (int64_t now_us = kStartUs; now_us < kStartUs + kTraceUs + kDrainUs; now_us += RTC_PACER_INTERVAL_MS * 1000) {
+		for (; next_pkt < trace.size() && trace[next_pkt].time_us <= now_us; next_pkt++) {
+			const TracePacket& pkt = trace[next_pkt];
+			RtpPacketPtr rtp_pkt = RtpPacket::Create();
+			rtp_pkt->timestamp = (uint32_t)next_pkt;
+			rtp_pkt->data_size = pkt.size;
+			pacer.EnqueuePacket(rtp_pkt, pkt.priority, pkt.time_us);
+		}
+
+		std::vector<RtpPacketPtr> rtp_pkts;
+		pacer.Process(rtp_pkts, now_us);
+
+		int last_priority = RTP_PRIORITY_AUDIO;
+		for (auto& rtp_pkt : rtp_pkts) {
+			const TracePacket& pkt = trace[rtp_pkt->timestamp];
+			is_priority_ordered = is_priority_ordered && pkt.priority >= last_priority;
+			last_priority = pkt.priority;
+			paced_link.Send(now_us, pkt, paced);
+		}
+	}
+
+	printf("  5 Mbps link, pacing rate %u bps, peak delay in ms\n", pacing_rate);
+	printf("  %-8s %10s %9s %8s %9s %8s\n", "mode", "link queue", "audio", "rtx", "video", "fec");
+	PrintStats("unpaced", unpaced);
+	PrintStats("paced", paced);
+
+	TEST_CHECK(failures, paced.packets == trace.size());
+	TEST_CHECK(failures, is_priority_ordered);
+
+	// a 200 KB idr at line rate queues 320 ms in front of the link
+	TEST_CHECK(failures, unpaced.max_link_delay_us > 300 * 1000);
+	// paced below the link rate, the link queue holds at most one burst budget and a packet
+	TEST_CHECK(failures, paced.max_link_delay_us <= 2 * RTC_PACER_BURST_MS * 1000);
+
+	// audio and retransmissions wait one timer tick and that queue, never behind the idr
+	int64_t max_urgent_delay_us = (RTC_PACER_INTERVAL_MS + 2 * RTC_PACER_BURST_MS) * 1000;
+	TEST_CHECK(failures, paced.max_delay_us[RTP_PRIORITY_AUDIO] <= max_urgent_delay_us);
+	TEST_CHECK(failures, paced.max_delay_us[RTP_PRIORITY_RTX] <= max_urgent_delay_us);
+	TEST_CHECK(failures, paced.max_delay_us[RTP_PRIORITY_AUDIO] * 4 < unpaced.max_delay_us[RTP_PRIORITY_AUDIO]);
+
+	// the video backlog of one gop is gone before the next idr
+	TEST_CHECK(failures, paced.max_delay_us[RTP_PRIORITY_VIDEO] < 30 * kFrameIntervalUs);
+	return failures;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdio>
+
+// Each test returns the number of failed checks and prints what it measured.
+int RunRtpPacerTest();
+int RunH264EncoderTest();
+int RunFecXorTest();
+int RunPacketPoolTest();
+
+#define TEST_CHECK(failures, condition) \
+	do { \
+		if (!(condition)) { \
+			printf("  failed %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)